@@ -0,0 +1,122 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "symbol_table.hh"
+
+// Measures how interning scales with threads and with the number of distinct symbols. Each run
+// makes up a corpus of names shaped like those of class files, fresh for the run since the table
+// is process-wide, and has every thread intern all of it starting at a different offset, as parser
+// threads intern the same names from different classes at once. The first thread to reach a name
+// inserts it and the others find it.
+//
+// Usage: symbol_table_bench [max threads] [symbol counts...]
+// Defaults to doubling up to the hardware threads, with 100000 and 1000000 symbols.
+
+static std::vector<std::string> make_corpus(size_t run, size_t symbols)
+{
+    static constexpr const char* packages[] = {"java/lang/", "java/util/", "com/example/app/",
+        "org/apache/commons/io/", "kotlin/collections/"};
+    std::vector<std::string> corpus;
+    corpus.reserve(symbols);
+    for (size_t idx = 0; idx < symbols; idx++)
+    {
+        corpus.push_back(std::string{packages[idx % std::size(packages)]} + "Run" +
+            std::to_string(run) + "$Symbol" + std::to_string(idx));
+    }
+
+    return corpus;
+}
+
+// Returns the interns per second of `threads` threads each interning the whole corpus.
+static double run_threads(const std::vector<std::string>& corpus, size_t threads)
+{
+    symbol_table& symbols = symbol_table::instance();
+    std::vector<std::thread> workers;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t thread = 0; thread < threads; thread++)
+    {
+        workers.emplace_back([&, thread]()
+        {
+            const size_t offset = corpus.size() * thread / threads;
+            symbol_id checksum = 0;
+            for (size_t idx = 0; idx < corpus.size(); idx++)
+            {
+                checksum ^= symbols.intern(corpus[(offset + idx) % corpus.size()]);
+            }
+
+            // Keeps the loop from being optimized away.
+            if (checksum == NO_SYMBOL)
+            {
+                std::abort();
+            }
+        });
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(corpus.size() * threads) / elapsed.count();
+}
+
+int main(int argc, char** argv)
+{
+    const size_t max_threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10)
+        : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> symbol_counts;
+    for (int arg = 2; arg < argc; arg++)
+    {
+        symbol_counts.push_back(std::strtoul(argv[arg], nullptr, 10));
+    }
+
+    if (symbol_counts.empty())
+    {
+        symbol_counts = {100000, 1000000};
+    }
+
+    std::printf("%10s %8s %14s %10s %12s\n", "symbols", "threads", "interns/s", "speedup",
+        "efficiency");
+    size_t run = 0;
+    for (const size_t symbol_count : symbol_counts)
+    {
+        double single_thread_rate = 0;
+        for (size_t threads = 1; threads <= max_threads; threads *= 2)
+        {
+            const double rate = run_threads(make_corpus(run++, symbol_count), threads);
+            single_thread_rate = threads == 1 ? rate : single_thread_rate;
+            const double speedup = rate / single_thread_rate;
+            std::printf("%10zu %8zu %14.0f %9.2fx %11.0f%%\n", symbol_count, threads, rate,
+                speedup, 100 * speedup / threads);
+        }
+    }
+
+    std::printf("%zu symbols interned\n", symbol_table::instance().size());
+    return 0;
+}
@@ -0,0 +1,80 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <cstdint>
+#include <variant>
+
+#include "api_rules.hh"
+#include "find_api_calls.hh"
+#include "invalid_class_format_exception.hh"
+#include "java_class.hh"
+#include "reflection.hh"
+
+// libFuzzer entry point over the in-memory parse and scan path, from the byte prefilter through
+// the receiver type and argument origin passes. Memory and time are bounded by running it with
+// `-malloc_limit_mb`, `-rss_limit_mb` and `-timeout`, as `make fuzz-run` does.
+
+static const api_rule_set& get_rules()
+{
+    static api_rule_set rules;
+    static const bool built = []
+    {
+        for (const char* rule : {"java/lang/Runtime", "java/net/*", "java/util/List",
+            "java/util/ArrayList", "java/io/File.<init>(Ljava/lang/String;)V",
+            "java/lang/System.out:*"})
+        {
+            rules.add_rule(rule);
+        }
+
+        rules.build_prefilter(get_reflective_lookup_names());
+        return true;
+    }();
+    static_cast<void>(built);
+    return rules;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const api_rule_set& rules = get_rules();
+    if (rules.may_match_class_bytes(data, size))
+    {
+        const auto clazz = java_class::try_parse_class_bytes(data, size);
+        if (const auto* parsed = std::get_if<java_class>(&clazz))
+        {
+            // Classes without line numbers for a matching call are rejected by throwing.
+            try
+            {
+                find_api_calls(*parsed, rules, true);
+                api_use_counts counts;
+                count_api_uses(*parsed, rules, counts);
+                // As `--exists` runs it, past the constant pool filter.
+                const compiled_api_rules matching_refs = rules.compile(
+                    parsed->get_class_constant_pool(), parsed->get_class_member_refs());
+                if (may_find_api_uses(*parsed, rules, matching_refs))
+                {
+                    find_first_api_use(*parsed, rules, matching_refs);
+                }
+            }
+            catch (const invalid_class_format&)
+            {
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+// Runs the fuzz target once over each file given, for compilers without libFuzzer and to replay
+// the corpus as a regression test.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+int main(int argc, char** argv)
+{
+    for (int arg = 1; arg < argc; arg++)
+    {
+        std::ifstream file{argv[arg], std::ios::binary};
+        if (!file)
+        {
+            std::fprintf(stderr, "Failed to open %s\n", argv[arg]);
+            return 1;
+        }
+
+        const std::vector<uint8_t> input{std::istreambuf_iterator<char>{file},
+            std::istreambuf_iterator<char>{}};
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+
+    std::printf("Ran %d inputs\n", argc - 1);
+    return 0;
+}
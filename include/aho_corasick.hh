@@ -0,0 +1,74 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Finds whether a buffer contains any of a set of byte strings in a single pass over it, however
+// many strings there are. The strings are compiled into an Aho-Corasick automaton whose goto and
+// failure links are folded into one transition table, so each byte costs a single table lookup.
+class aho_corasick
+{
+    // Set in a transition leading to a state where some pattern ends.
+    static constexpr uint32_t MATCH_BIT = 0x80000000;
+
+    // Bytes found in no pattern all share class 0, so a state's row only has one entry per
+    // distinct byte of the patterns.
+    std::array<uint16_t, 256> byte_classes{};
+    uint32_t class_count = 1;
+    // The transitions of state `s` are `transitions[s * class_count]` onwards.
+    std::vector<uint32_t> transitions;
+    bool matches_everything = false;
+
+public:
+    aho_corasick() = default;
+    explicit aho_corasick(const std::vector<std::string_view>& patterns);
+
+    // Returns whether any pattern occurs in `data`, stopping at the first one found.
+    bool contains_any(const uint8_t* data, size_t length) const
+    {
+        if (matches_everything)
+        {
+            return true;
+        }
+
+        uint32_t state = 0;
+        for (size_t i = 0; i < length; i++)
+        {
+            state = transitions[state * class_count + byte_classes[data[i]]];
+            if (state & MATCH_BIT)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // The size of the transition table, in bytes.
+    size_t table_size() const
+    {
+        return transitions.size() * sizeof(uint32_t);
+    }
+};
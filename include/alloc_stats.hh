@@ -0,0 +1,67 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "scan_stats.hh"
+
+struct alloc_counters
+{
+    uint64_t allocations;
+    uint64_t bytes;
+    // Highest number of live bytes observed, relative to the live bytes when counting started.
+    uint64_t peak_live_bytes;
+};
+
+// Counts every global `operator new` when built with `ALLOC_STATS=1`. The replacement operators
+// are always linked into such builds but only account once `enable` has been called, so the
+// counting overhead is a single branch otherwise.
+class alloc_stats
+{
+    struct class_record
+    {
+        std::string name;
+        alloc_counters counters;
+    };
+
+    std::vector<class_record> classes;
+
+    void print_sites(std::ostream& out) const;
+
+public:
+    static alloc_stats& instance();
+
+    // False when the replacement allocation operators were not compiled in.
+    static bool is_available();
+
+    // Starts counting. Recording call sites additionally unwinds a few frames per allocation.
+    void enable(bool track_sites);
+    bool is_enabled() const;
+
+    // Starts a per-class measurement window; `end_class` closes it and records the result.
+    void begin_class();
+    void end_class(const std::string& name);
+
+    void print_summary(std::ostream& out) const;
+};
@@ -35,5 +35,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_annotation_default_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_annotation_default_attribute(class_reader& file,
     const constant_pool& cp);
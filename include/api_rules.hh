@@ -0,0 +1,177 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aho_corasick.hh"
+#include "constant_pool.hh"
+#include "member_ref_table.hh"
+#include "symbol_table.hh"
+
+class rule_pack;
+
+enum class rule_severity : uint8_t
+{
+    // Rules given on the command line carry no severity.
+    none, low, medium, high, critical
+};
+
+// The pieces of a rule in internal form, viewing the rule string. A rule names either every member
+// of a class, e.g. `java/io/File`, every class of a package and its subpackages, e.g. `java/net/*`,
+// one method, e.g. `java/io/File.<init>(Ljava/lang/String;)V`, or one field, e.g.
+// `java/lang/System.out:Ljava/io/PrintStream;` or, whatever its type, `java/lang/System.out:*`.
+struct api_rule_parts
+{
+    // For package rules, the package followed by a `/`.
+    std::string_view owner;
+    bool is_package;
+    // Empty unless the rule names a member.
+    std::string_view name;
+    bool is_field;
+    // Empty for field rules matching any type.
+    std::string_view descriptor;
+};
+
+// Converts a rule to internal form: `java.io.File` becomes `java/io/File`, and spaces are dropped.
+std::string normalize_api_rule(std::string_view rule);
+
+// Splits a rule in internal form. Returns nothing if it is malformed.
+std::optional<api_rule_parts> split_api_rule(std::string_view rule);
+
+const char* get_rule_severity_name(rule_severity severity);
+std::optional<rule_severity> parse_rule_severity(std::string_view name);
+
+// One rule matching a call site. The category views storage owned by the rule set.
+struct rule_match
+{
+    std::string_view category;
+    rule_severity severity;
+};
+
+// The rules matching each member reference, Class, MethodType and MethodHandle entry of one class,
+// indexed by constant pool index.
+class compiled_api_rules
+{
+    // The matches of entry `i` are `matches[match_offsets[i]]` up to `matches[match_offsets[i + 1]]`.
+    std::vector<uint32_t> match_offsets;
+    std::vector<rule_match> matches;
+    // Whether any field or method reference matched, and whether any Class, MethodType or
+    // MethodHandle entry did.
+    bool matches_members = false;
+    bool matches_types = false;
+
+    friend class api_rule_set;
+
+public:
+    bool is_match(constant_pool_entry_id index) const
+    {
+        return static_cast<size_t>(index) + 1 < match_offsets.size() &&
+            match_offsets[index] != match_offsets[index + 1];
+    }
+
+    std::vector<rule_match> get_matches(constant_pool_entry_id index) const;
+
+    // Returns whether no reference of the class matched, in which case none of its code needs to
+    // be looked at.
+    bool empty() const
+    {
+        return matches.empty();
+    }
+
+    bool has_member_matches() const
+    {
+        return matches_members;
+    }
+
+    bool has_type_matches() const
+    {
+        return matches_types;
+    }
+};
+
+// A rule given on the command line, interned once up front.
+struct api_rule
+{
+    symbol_id owner;
+    bool is_package;
+    // Only set for rules naming a member.
+    std::optional<symbol_id> name;
+    bool is_field;
+    std::optional<symbol_id> descriptor;
+};
+
+// The rules of a scan: those given with `-s` and those of a precompiled rule pack. For each class
+// they are compiled down to the rules matching each of its constant pool indices, so matching an
+// instruction is a single lookup.
+class api_rule_set
+{
+    std::vector<api_rule> rules;
+    std::unique_ptr<const rule_pack> pack;
+    // Searches for the owners of every rule.
+    aho_corasick owner_search;
+    bool has_owner_search = false;
+
+    bool matches_class_rule(const api_rule& rule, std::string_view class_name) const;
+    void match_member(const resolved_member_ref& member_ref, std::vector<rule_match>& out) const;
+    void match_class(std::string_view class_name, std::vector<rule_match>& out) const;
+
+public:
+    api_rule_set();
+    ~api_rule_set();
+
+    // Adds a rule in internal form. Returns false if it is malformed.
+    bool add_rule(std::string_view rule);
+
+    void set_rule_pack(std::unique_ptr<const rule_pack> rules_pack);
+
+    // Builds the search `may_match_class_bytes` does from the rules added so far. Classes containing
+    // any of `extra_names` are let through as well.
+    void build_prefilter(const std::vector<std::string_view>& extra_names = {});
+
+    // Returns false if the raw classfile `data` cannot refer to anything the rules match, because
+    // it doesn't contain the name of any class or package they cover. The Utf8 entries naming a
+    // class, or a type with it, hold its name as is, so this rules out most classes without
+    // parsing them. Always true until `build_prefilter` is called.
+    bool may_match_class_bytes(const uint8_t* data, size_t size) const
+    {
+        return !has_owner_search || owner_search.contains_any(data, size);
+    }
+
+    compiled_api_rules compile(const constant_pool& cp, const member_ref_table& member_refs) const;
+
+    // Returns the rules matching a class, or a member of it, that a reflective lookup resolves to.
+    // The member's descriptor isn't known, so rules naming it match whatever their descriptor.
+    // `name` is empty for the class itself.
+    std::vector<rule_match> match_reflective_target(std::string_view owner, std::string_view name,
+        bool is_field) const;
+
+    // Returns whether any rule covers `class_name`, one of its members or its package.
+    bool has_owner_rules(std::string_view class_name) const;
+
+    // Returns the rules matching the method `owner.name` with `descriptor`, called on a receiver of
+    // the class `owner` through a reference to one of its superclasses or interfaces.
+    std::vector<rule_match> match_receiver_call(std::string_view owner, std::string_view name,
+        std::string_view descriptor) const;
+};
@@ -0,0 +1,51 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "code_attribute.hh"
+#include "java_class.hh"
+#include "method_info.hh"
+
+// Where an argument of a call comes from, as far as the calling method shows.
+enum class argument_origin : uint8_t
+{
+    // Computed, read from a field or array, or reaching the call from several places.
+    unknown,
+    // A literal, pushed by `ldc`, `bipush`, `iconst_0`, `aconst_null` and the like.
+    constant,
+    // A parameter of the calling method, as passed in.
+    parameter,
+    // What another call returned.
+    call_result
+};
+
+const char* get_argument_origin_name(argument_origin origin);
+
+// Labels where each argument of the calls at `call_pcs`, given in pc order, comes from, in a single
+// pass over the method's bytecode. Values are tracked through the operand stack and locals as
+// `find_reflective_targets` does, so those meeting at a branch target are unknown unless they're in
+// a local that is only ever defined once, parameters being defined on entry. Returns one entry per
+// pc of `call_pcs` with the origin of each parameter of the called method, the receiver left out;
+// calls past code the pass can't follow are left without any.
+std::vector<std::vector<argument_origin>> find_argument_origins(const java_class& clazz,
+    const method_info& method, const code_attribute& code, const std::vector<uint16_t>& call_pcs);
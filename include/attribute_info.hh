@@ -19,10 +19,10 @@
 
 #pragma once
 
-#include <fstream>
 #include <memory>
 #include <vector>
 
+#include "class_reader.hh"
 #include "constant_pool.hh"
 
 enum class attribute_info_type : uint8_t
@@ -43,6 +43,6 @@ public:
 
 using entry_attributes = std::vector<std::unique_ptr<attribute_info>>;
 
-entry_attributes parse_attributes(std::ifstream& file, const constant_pool& cp);
-void skip_element_value_field(std::ifstream& file);
-void skip_annotations(std::ifstream& file);
+entry_attributes parse_attributes(class_reader& file, const constant_pool& cp);
+void skip_element_value_field(class_reader& file, size_t depth = 0);
+void skip_annotations(class_reader& file);
@@ -53,5 +53,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_bootstrap_methods_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_bootstrap_methods_attribute(class_reader& file,
 const constant_pool& cp);
@@ -20,6 +20,12 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 constexpr size_t TOTAL_BYTECODE_INSTRUCTIONS = 205;
 
@@ -46,56 +52,416 @@ enum class bytecode_tag : uint8_t
     GOTO_W, JSR_W, BREAKPOINT, IMPDEP1, IMPDEP2
 };
 
-// These are all required to be the same size because in other parts of the code we assume indices
-// for every table are commutative. e.g. See `find_instructions_cb`.
+// The descriptor table below is indexed by `bytecode_tag`, so it must cover every tag.
 static_assert(static_cast<size_t>(bytecode_tag::IMPDEP2) + 1 == TOTAL_BYTECODE_INSTRUCTIONS,
     "Bytecode tables differ!");
 
-constexpr std::array<const char* const, TOTAL_BYTECODE_INSTRUCTIONS> instruction_names =
+// How the bytes following an opcode are interpreted.
+enum class operand_kind : uint8_t
 {
-    "nop", "aconst_null", "iconst_m1", "iconst_0", "iconst_1",
-    "iconst_2", "iconst_3", "iconst_4", "iconst_5", "lconst_0", "lconst_1", "fconst_0", "fconst_1",
-    "fconst_2", "dconst_0", "dconst_1", "bipush", "sipush", "ldc", "ldc_w", "ldc2_w",
-    "iload", "lload", "fload", "dload", "aload", "iload_0", "iload_1", "iload_2", "iload_3",
-    "lload_0", "lload_1", "lload_2", "lload_3", "fload_0", "fload_1", "fload_2", "fload_3",
-    "dload_0", "dload_1", "dload_2", "dload_3", "aload_0", "aload_1", "aload_2", "aload_3",
-    "iaload", "laload", "faload", "daload", "aaload", "baload", "caload", "saload", "istore",
-    "lstore", "fstore", "dstore", "astore", "istore_0", "istore_1", "istore_2", "istore_3",
-    "lstore_0", "lstore_1", "lstore_2", "lstore_3", "fstore_0", "fstore_1", "fstore_2", "fstore_3",
-    "dstore_0", "dstore_1", "dstore_2", "dstore_3", "astore_0", "astore_1", "astore_2", "astore_3",
-    "iastore", "lastore", "fastore", "dastore", "aastore", "bastore", "castore", "sastore", "pop",
-    "pop2", "dup", "dup_x1", "dup_x2", "dup2", "dup2_x1", "dup2_x2", "swap", "iadd", "ladd",
-    "fadd", "dadd", "isub", "lsub", "fsub", "dsub", "imul", "lmul", "fmul", "dmul", "idiv", "ldiv",
-    "fdiv", "ddiv", "irem", "lrem", "frem", "drem", "ineg", "lneg", "fneg", "dneg", "ishl", "lshl",
-    "ishr", "lshr", "iushr", "lushr", "iand", "land", "ior", "lor", "ixor", "lxor", "iinc", "i2l",
-    "i2f", "i2d", "l2i", "l2f", "l2d", "f2i", "f2l", "f2d", "d2i", "d2l", "d2f", "i2b", "i2c",
-    "i2s", "lcmp", "fcmpl", "fcmpg", "dcmpl", "dcmpg", "ifeq", "ifne", "iflt", "ifge", "ifgt",
-    "ifle", "if_icmpeq", "if_icmpne", "if_icmplt", "if_icmpge", "if_icmpgt", "if_icmple",
-    "if_acmpeq", "if_acmpne", "goto", "jsr", "ret", "tableswitch", "lookupswitch", "ireturn",
-    "lreturn", "freturn", "dreturn", "areturn", "return", "getstatic", "putstatic", "getfield",
-    "putfield", "invokevirtual", "invokespecial", "invokestatic", "invokeinterface",
-    "invokedynamic", "new", "newarray", "anewarray", "arraylength", "athrow", "checkcast",
-    "instanceof", "monitorenter", "monitorexit", "wide", "multianewarray", "ifnull", "ifnonnull",
-    "goto_w", "jsr_w", "breakpoint", "impdep1", "impdep2"
+    // An index into the constant pool.
+    cp_index_u1, cp_index_u2,
+    // A jump relative to the address of the opcode.
+    branch_s2, branch_s4,
+    // An index into the local variable array.
+    local_u1,
+    // A constant, an array type or a count.
+    immediate_s1, immediate_s2, immediate_u1,
+    // Bytes that must be zero.
+    zero_u1,
+    // The padding and jump table of `tableswitch`/`lookupswitch`.
+    padded_switch,
+    // The widened instruction that follows `wide`.
+    wide_prefix
 };
 
-constexpr std::array<size_t, TOTAL_BYTECODE_INSTRUCTIONS> instruction_sizes =
+constexpr size_t get_operand_size(operand_kind kind)
 {
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 3, 2, 3, 3, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3,
-    3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 0, 0, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3, 5, 5, 3, 2, 3, 1, 1,
-    3, 3, 1, 1, 1, 4, 3, 3, 5, 5, 1, 1, 1
+    switch (kind)
+    {
+        case operand_kind::cp_index_u1:
+        case operand_kind::local_u1:
+        case operand_kind::immediate_s1:
+        case operand_kind::immediate_u1:
+        case operand_kind::zero_u1:
+            return 1;
+        case operand_kind::cp_index_u2:
+        case operand_kind::branch_s2:
+        case operand_kind::immediate_s2:
+            return 2;
+        case operand_kind::branch_s4:
+            return 4;
+        default:
+            // Variable-length operands.
+            return 0;
+    }
+}
+
+// Stack effects depend on a descriptor for field accesses and invokes, and on the operands for
+// `multianewarray` and `wide`.
+constexpr int8_t VARIABLE_STACK_EFFECT = -1;
+
+constexpr size_t MAX_INSTRUCTION_OPERANDS = 3;
+
+struct opcode_descriptor
+{
+    const char* name;
+    // The length of the instruction including the opcode, or 0 if it is variable.
+    uint8_t size;
+    std::array<operand_kind, MAX_INSTRUCTION_OPERANDS> operands;
+    uint8_t operand_count;
+    // The number of operand stack slots popped and pushed; `long` and `double` take two slots.
+    int8_t stack_pops;
+    int8_t stack_pushes;
+
+    constexpr opcode_descriptor(const char* name, uint8_t size,
+        std::initializer_list<operand_kind> kinds, int8_t stack_pops, int8_t stack_pushes) :
+            name{name},
+            size{size},
+            operands{},
+            operand_count{static_cast<uint8_t>(kinds.size())},
+            stack_pops{stack_pops},
+            stack_pushes{stack_pushes}
+    {
+        size_t idx = 0;
+        for (const operand_kind kind : kinds)
+        {
+            operands[idx++] = kind;
+        }
+    }
+};
+
+constexpr std::array<opcode_descriptor, TOTAL_BYTECODE_INSTRUCTIONS> opcode_descriptors =
+{
+    opcode_descriptor{"nop", 1, {}, 0, 0},
+    opcode_descriptor{"aconst_null", 1, {}, 0, 1},
+    opcode_descriptor{"iconst_m1", 1, {}, 0, 1},
+    opcode_descriptor{"iconst_0", 1, {}, 0, 1},
+    opcode_descriptor{"iconst_1", 1, {}, 0, 1},
+    opcode_descriptor{"iconst_2", 1, {}, 0, 1},
+    opcode_descriptor{"iconst_3", 1, {}, 0, 1},
+    opcode_descriptor{"iconst_4", 1, {}, 0, 1},
+    opcode_descriptor{"iconst_5", 1, {}, 0, 1},
+    opcode_descriptor{"lconst_0", 1, {}, 0, 2},
+    opcode_descriptor{"lconst_1", 1, {}, 0, 2},
+    opcode_descriptor{"fconst_0", 1, {}, 0, 1},
+    opcode_descriptor{"fconst_1", 1, {}, 0, 1},
+    opcode_descriptor{"fconst_2", 1, {}, 0, 1},
+    opcode_descriptor{"dconst_0", 1, {}, 0, 2},
+    opcode_descriptor{"dconst_1", 1, {}, 0, 2},
+    opcode_descriptor{"bipush", 2, {operand_kind::immediate_s1}, 0, 1},
+    opcode_descriptor{"sipush", 3, {operand_kind::immediate_s2}, 0, 1},
+    opcode_descriptor{"ldc", 2, {operand_kind::cp_index_u1}, 0, 1},
+    opcode_descriptor{"ldc_w", 3, {operand_kind::cp_index_u2}, 0, 1},
+    opcode_descriptor{"ldc2_w", 3, {operand_kind::cp_index_u2}, 0, 2},
+    opcode_descriptor{"iload", 2, {operand_kind::local_u1}, 0, 1},
+    opcode_descriptor{"lload", 2, {operand_kind::local_u1}, 0, 2},
+    opcode_descriptor{"fload", 2, {operand_kind::local_u1}, 0, 1},
+    opcode_descriptor{"dload", 2, {operand_kind::local_u1}, 0, 2},
+    opcode_descriptor{"aload", 2, {operand_kind::local_u1}, 0, 1},
+    opcode_descriptor{"iload_0", 1, {}, 0, 1},
+    opcode_descriptor{"iload_1", 1, {}, 0, 1},
+    opcode_descriptor{"iload_2", 1, {}, 0, 1},
+    opcode_descriptor{"iload_3", 1, {}, 0, 1},
+    opcode_descriptor{"lload_0", 1, {}, 0, 2},
+    opcode_descriptor{"lload_1", 1, {}, 0, 2},
+    opcode_descriptor{"lload_2", 1, {}, 0, 2},
+    opcode_descriptor{"lload_3", 1, {}, 0, 2},
+    opcode_descriptor{"fload_0", 1, {}, 0, 1},
+    opcode_descriptor{"fload_1", 1, {}, 0, 1},
+    opcode_descriptor{"fload_2", 1, {}, 0, 1},
+    opcode_descriptor{"fload_3", 1, {}, 0, 1},
+    opcode_descriptor{"dload_0", 1, {}, 0, 2},
+    opcode_descriptor{"dload_1", 1, {}, 0, 2},
+    opcode_descriptor{"dload_2", 1, {}, 0, 2},
+    opcode_descriptor{"dload_3", 1, {}, 0, 2},
+    opcode_descriptor{"aload_0", 1, {}, 0, 1},
+    opcode_descriptor{"aload_1", 1, {}, 0, 1},
+    opcode_descriptor{"aload_2", 1, {}, 0, 1},
+    opcode_descriptor{"aload_3", 1, {}, 0, 1},
+    opcode_descriptor{"iaload", 1, {}, 2, 1},
+    opcode_descriptor{"laload", 1, {}, 2, 2},
+    opcode_descriptor{"faload", 1, {}, 2, 1},
+    opcode_descriptor{"daload", 1, {}, 2, 2},
+    opcode_descriptor{"aaload", 1, {}, 2, 1},
+    opcode_descriptor{"baload", 1, {}, 2, 1},
+    opcode_descriptor{"caload", 1, {}, 2, 1},
+    opcode_descriptor{"saload", 1, {}, 2, 1},
+    opcode_descriptor{"istore", 2, {operand_kind::local_u1}, 1, 0},
+    opcode_descriptor{"lstore", 2, {operand_kind::local_u1}, 2, 0},
+    opcode_descriptor{"fstore", 2, {operand_kind::local_u1}, 1, 0},
+    opcode_descriptor{"dstore", 2, {operand_kind::local_u1}, 2, 0},
+    opcode_descriptor{"astore", 2, {operand_kind::local_u1}, 1, 0},
+    opcode_descriptor{"istore_0", 1, {}, 1, 0},
+    opcode_descriptor{"istore_1", 1, {}, 1, 0},
+    opcode_descriptor{"istore_2", 1, {}, 1, 0},
+    opcode_descriptor{"istore_3", 1, {}, 1, 0},
+    opcode_descriptor{"lstore_0", 1, {}, 2, 0},
+    opcode_descriptor{"lstore_1", 1, {}, 2, 0},
+    opcode_descriptor{"lstore_2", 1, {}, 2, 0},
+    opcode_descriptor{"lstore_3", 1, {}, 2, 0},
+    opcode_descriptor{"fstore_0", 1, {}, 1, 0},
+    opcode_descriptor{"fstore_1", 1, {}, 1, 0},
+    opcode_descriptor{"fstore_2", 1, {}, 1, 0},
+    opcode_descriptor{"fstore_3", 1, {}, 1, 0},
+    opcode_descriptor{"dstore_0", 1, {}, 2, 0},
+    opcode_descriptor{"dstore_1", 1, {}, 2, 0},
+    opcode_descriptor{"dstore_2", 1, {}, 2, 0},
+    opcode_descriptor{"dstore_3", 1, {}, 2, 0},
+    opcode_descriptor{"astore_0", 1, {}, 1, 0},
+    opcode_descriptor{"astore_1", 1, {}, 1, 0},
+    opcode_descriptor{"astore_2", 1, {}, 1, 0},
+    opcode_descriptor{"astore_3", 1, {}, 1, 0},
+    opcode_descriptor{"iastore", 1, {}, 3, 0},
+    opcode_descriptor{"lastore", 1, {}, 4, 0},
+    opcode_descriptor{"fastore", 1, {}, 3, 0},
+    opcode_descriptor{"dastore", 1, {}, 4, 0},
+    opcode_descriptor{"aastore", 1, {}, 3, 0},
+    opcode_descriptor{"bastore", 1, {}, 3, 0},
+    opcode_descriptor{"castore", 1, {}, 3, 0},
+    opcode_descriptor{"sastore", 1, {}, 3, 0},
+    opcode_descriptor{"pop", 1, {}, 1, 0},
+    opcode_descriptor{"pop2", 1, {}, 2, 0},
+    opcode_descriptor{"dup", 1, {}, 1, 2},
+    opcode_descriptor{"dup_x1", 1, {}, 2, 3},
+    opcode_descriptor{"dup_x2", 1, {}, 3, 4},
+    opcode_descriptor{"dup2", 1, {}, 2, 4},
+    opcode_descriptor{"dup2_x1", 1, {}, 3, 5},
+    opcode_descriptor{"dup2_x2", 1, {}, 4, 6},
+    opcode_descriptor{"swap", 1, {}, 2, 2},
+    opcode_descriptor{"iadd", 1, {}, 2, 1},
+    opcode_descriptor{"ladd", 1, {}, 4, 2},
+    opcode_descriptor{"fadd", 1, {}, 2, 1},
+    opcode_descriptor{"dadd", 1, {}, 4, 2},
+    opcode_descriptor{"isub", 1, {}, 2, 1},
+    opcode_descriptor{"lsub", 1, {}, 4, 2},
+    opcode_descriptor{"fsub", 1, {}, 2, 1},
+    opcode_descriptor{"dsub", 1, {}, 4, 2},
+    opcode_descriptor{"imul", 1, {}, 2, 1},
+    opcode_descriptor{"lmul", 1, {}, 4, 2},
+    opcode_descriptor{"fmul", 1, {}, 2, 1},
+    opcode_descriptor{"dmul", 1, {}, 4, 2},
+    opcode_descriptor{"idiv", 1, {}, 2, 1},
+    opcode_descriptor{"ldiv", 1, {}, 4, 2},
+    opcode_descriptor{"fdiv", 1, {}, 2, 1},
+    opcode_descriptor{"ddiv", 1, {}, 4, 2},
+    opcode_descriptor{"irem", 1, {}, 2, 1},
+    opcode_descriptor{"lrem", 1, {}, 4, 2},
+    opcode_descriptor{"frem", 1, {}, 2, 1},
+    opcode_descriptor{"drem", 1, {}, 4, 2},
+    opcode_descriptor{"ineg", 1, {}, 1, 1},
+    opcode_descriptor{"lneg", 1, {}, 2, 2},
+    opcode_descriptor{"fneg", 1, {}, 1, 1},
+    opcode_descriptor{"dneg", 1, {}, 2, 2},
+    opcode_descriptor{"ishl", 1, {}, 2, 1},
+    opcode_descriptor{"lshl", 1, {}, 3, 2},
+    opcode_descriptor{"ishr", 1, {}, 2, 1},
+    opcode_descriptor{"lshr", 1, {}, 3, 2},
+    opcode_descriptor{"iushr", 1, {}, 2, 1},
+    opcode_descriptor{"lushr", 1, {}, 3, 2},
+    opcode_descriptor{"iand", 1, {}, 2, 1},
+    opcode_descriptor{"land", 1, {}, 4, 2},
+    opcode_descriptor{"ior", 1, {}, 2, 1},
+    opcode_descriptor{"lor", 1, {}, 4, 2},
+    opcode_descriptor{"ixor", 1, {}, 2, 1},
+    opcode_descriptor{"lxor", 1, {}, 4, 2},
+    opcode_descriptor{"iinc", 3, {operand_kind::local_u1, operand_kind::immediate_s1}, 0, 0},
+    opcode_descriptor{"i2l", 1, {}, 1, 2},
+    opcode_descriptor{"i2f", 1, {}, 1, 1},
+    opcode_descriptor{"i2d", 1, {}, 1, 2},
+    opcode_descriptor{"l2i", 1, {}, 2, 1},
+    opcode_descriptor{"l2f", 1, {}, 2, 1},
+    opcode_descriptor{"l2d", 1, {}, 2, 2},
+    opcode_descriptor{"f2i", 1, {}, 1, 1},
+    opcode_descriptor{"f2l", 1, {}, 1, 2},
+    opcode_descriptor{"f2d", 1, {}, 1, 2},
+    opcode_descriptor{"d2i", 1, {}, 2, 1},
+    opcode_descriptor{"d2l", 1, {}, 2, 2},
+    opcode_descriptor{"d2f", 1, {}, 2, 1},
+    opcode_descriptor{"i2b", 1, {}, 1, 1},
+    opcode_descriptor{"i2c", 1, {}, 1, 1},
+    opcode_descriptor{"i2s", 1, {}, 1, 1},
+    opcode_descriptor{"lcmp", 1, {}, 4, 1},
+    opcode_descriptor{"fcmpl", 1, {}, 2, 1},
+    opcode_descriptor{"fcmpg", 1, {}, 2, 1},
+    opcode_descriptor{"dcmpl", 1, {}, 4, 1},
+    opcode_descriptor{"dcmpg", 1, {}, 4, 1},
+    opcode_descriptor{"ifeq", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"ifne", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"iflt", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"ifge", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"ifgt", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"ifle", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"if_icmpeq", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"if_icmpne", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"if_icmplt", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"if_icmpge", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"if_icmpgt", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"if_icmple", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"if_acmpeq", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"if_acmpne", 3, {operand_kind::branch_s2}, 2, 0},
+    opcode_descriptor{"goto", 3, {operand_kind::branch_s2}, 0, 0},
+    opcode_descriptor{"jsr", 3, {operand_kind::branch_s2}, 0, 1},
+    opcode_descriptor{"ret", 2, {operand_kind::local_u1}, 0, 0},
+    opcode_descriptor{"tableswitch", 0, {operand_kind::padded_switch}, 1, 0},
+    opcode_descriptor{"lookupswitch", 0, {operand_kind::padded_switch}, 1, 0},
+    opcode_descriptor{"ireturn", 1, {}, 1, 0},
+    opcode_descriptor{"lreturn", 1, {}, 2, 0},
+    opcode_descriptor{"freturn", 1, {}, 1, 0},
+    opcode_descriptor{"dreturn", 1, {}, 2, 0},
+    opcode_descriptor{"areturn", 1, {}, 1, 0},
+    opcode_descriptor{"return", 1, {}, 0, 0},
+    opcode_descriptor{"getstatic", 3, {operand_kind::cp_index_u2},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"putstatic", 3, {operand_kind::cp_index_u2},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"getfield", 3, {operand_kind::cp_index_u2},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"putfield", 3, {operand_kind::cp_index_u2},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"invokevirtual", 3, {operand_kind::cp_index_u2},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"invokespecial", 3, {operand_kind::cp_index_u2},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"invokestatic", 3, {operand_kind::cp_index_u2},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"invokeinterface", 5, {operand_kind::cp_index_u2,
+        operand_kind::immediate_u1, operand_kind::zero_u1},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"invokedynamic", 5, {operand_kind::cp_index_u2,
+        operand_kind::zero_u1, operand_kind::zero_u1},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"new", 3, {operand_kind::cp_index_u2}, 0, 1},
+    opcode_descriptor{"newarray", 2, {operand_kind::immediate_u1}, 1, 1},
+    opcode_descriptor{"anewarray", 3, {operand_kind::cp_index_u2}, 1, 1},
+    opcode_descriptor{"arraylength", 1, {}, 1, 1},
+    opcode_descriptor{"athrow", 1, {}, 1, 0},
+    opcode_descriptor{"checkcast", 3, {operand_kind::cp_index_u2}, 1, 1},
+    opcode_descriptor{"instanceof", 3, {operand_kind::cp_index_u2}, 1, 1},
+    opcode_descriptor{"monitorenter", 1, {}, 1, 0},
+    opcode_descriptor{"monitorexit", 1, {}, 1, 0},
+    opcode_descriptor{"wide", 0, {operand_kind::wide_prefix},
+        VARIABLE_STACK_EFFECT, VARIABLE_STACK_EFFECT},
+    opcode_descriptor{"multianewarray", 4, {operand_kind::cp_index_u2, operand_kind::immediate_u1},
+        VARIABLE_STACK_EFFECT, 1},
+    opcode_descriptor{"ifnull", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"ifnonnull", 3, {operand_kind::branch_s2}, 1, 0},
+    opcode_descriptor{"goto_w", 5, {operand_kind::branch_s4}, 0, 0},
+    opcode_descriptor{"jsr_w", 5, {operand_kind::branch_s4}, 0, 1},
+    opcode_descriptor{"breakpoint", 1, {}, 0, 0},
+    opcode_descriptor{"impdep1", 1, {}, 0, 0},
+    opcode_descriptor{"impdep2", 1, {}, 0, 0},
 };
 
+constexpr const opcode_descriptor& get_opcode_descriptor(bytecode_tag instr)
+{
+    return opcode_descriptors[static_cast<size_t>(instr)];
+}
+
 constexpr size_t get_instruction_size(bytecode_tag instr)
 {
-    return instruction_sizes[static_cast<size_t>(instr)];
+    return get_opcode_descriptor(instr).size;
 }
 
-constexpr const char* const get_instruction_name(bytecode_tag instr)
+constexpr const char* get_instruction_name(bytecode_tag instr)
 {
-    return instruction_names[static_cast<size_t>(instr)];
+    return get_opcode_descriptor(instr).name;
 }
+
+// Every operand has a fixed size and offset unless the instruction is variable-length.
+constexpr bool has_fixed_operands(bytecode_tag instr)
+{
+    return get_instruction_size(instr) != 0;
+}
+
+constexpr size_t get_operand_offset(bytecode_tag instr, size_t operand_idx)
+{
+    size_t offset = 1;
+    for (size_t idx = 0; idx < operand_idx; idx++)
+    {
+        offset += get_operand_size(get_opcode_descriptor(instr).operands[idx]);
+    }
+
+    return offset;
+}
+
+constexpr bool opcode_sizes_match_operands()
+{
+    for (size_t opcode = 0; opcode < TOTAL_BYTECODE_INSTRUCTIONS; opcode++)
+    {
+        const auto instr = static_cast<bytecode_tag>(opcode);
+        const opcode_descriptor& descriptor = get_opcode_descriptor(instr);
+        if (descriptor.size && descriptor.size != get_operand_offset(instr, descriptor.operand_count))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static_assert(opcode_sizes_match_operands(), "Opcode sizes disagree with their operands!");
+
+// The type an operand decodes to. Constant pool and local indices are widened so that the narrow
+// and wide forms of an instruction decode alike.
+template <operand_kind kind>
+struct operand_type;
+
+template <> struct operand_type<operand_kind::cp_index_u1> { using type = uint16_t; };
+template <> struct operand_type<operand_kind::cp_index_u2> { using type = uint16_t; };
+template <> struct operand_type<operand_kind::branch_s2> { using type = int32_t; };
+template <> struct operand_type<operand_kind::branch_s4> { using type = int32_t; };
+template <> struct operand_type<operand_kind::local_u1> { using type = uint16_t; };
+template <> struct operand_type<operand_kind::immediate_s1> { using type = int32_t; };
+template <> struct operand_type<operand_kind::immediate_s2> { using type = int32_t; };
+template <> struct operand_type<operand_kind::immediate_u1> { using type = uint8_t; };
+template <> struct operand_type<operand_kind::zero_u1> { using type = uint8_t; };
+
+template <operand_kind kind>
+constexpr typename operand_type<kind>::type decode_operand(const uint8_t* operand)
+{
+    using result_type = typename operand_type<kind>::type;
+    constexpr size_t operand_size = get_operand_size(kind);
+    static_assert(operand_size != 0, "Variable-length operands can't be decoded statically.");
+    // Operands are big-endian and signed ones are sign-extended from their encoded width.
+    if constexpr (operand_size == 1)
+    {
+        return std::is_signed_v<result_type>
+            ? static_cast<result_type>(static_cast<int8_t>(operand[0]))
+            : static_cast<result_type>(operand[0]);
+    }
+    else if constexpr (operand_size == 2)
+    {
+        const uint16_t bits = static_cast<uint16_t>(operand[0] << 8 | operand[1]);
+        return std::is_signed_v<result_type>
+            ? static_cast<result_type>(static_cast<int16_t>(bits))
+            : static_cast<result_type>(bits);
+    }
+    else
+    {
+        return static_cast<result_type>(static_cast<uint32_t>(operand[0]) << 24 |
+            operand[1] << 16 | operand[2] << 8 | operand[3]);
+    }
+}
+
+template <bytecode_tag instr,
+    typename = std::make_index_sequence<get_opcode_descriptor(instr).operand_count>>
+struct instruction_operands;
+
+// Decodes the operands of `instr` into a tuple, one element per operand. The layout is known at
+// compile time, so decoding is a fixed sequence of loads with no branching on the instruction.
+template <bytecode_tag instr, size_t... operand_idx>
+struct instruction_operands<instr, std::index_sequence<operand_idx...>>
+{
+    static_assert(has_fixed_operands(instr), "Variable-length instructions can't be decoded "
+        "statically.");
+
+    using type = std::tuple<
+        typename operand_type<get_opcode_descriptor(instr).operands[operand_idx]>::type...>;
+
+    static type decode(const uint8_t* instruction)
+    {
+        return type{decode_operand<get_opcode_descriptor(instr).operands[operand_idx]>(
+            instruction + get_operand_offset(instr, operand_idx))...};
+    }
+};
@@ -0,0 +1,428 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "bytecode.hh"
+#include "code_attribute.hh"
+#include "constant_pool.hh"
+#include "java_class.hh"
+#include "member_ref_table.hh"
+#include "method_info.hh"
+
+// Helpers shared by the analyses that step through a method's instructions in pc order, tracking
+// an abstract value per operand stack slot and local.
+
+// Operands in bytecode are big-endian and not necessarily aligned.
+inline uint16_t read_u2_operand(const uint8_t* operand)
+{
+    return static_cast<uint16_t>(operand[0] << 8 | operand[1]);
+}
+
+inline int32_t read_s4_operand(const uint8_t* operand)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(operand[0]) << 24 | operand[1] << 16 |
+        operand[2] << 8 | operand[3]);
+}
+
+// The number of stack slots a value of the type whose descriptor starts with `type` takes.
+inline uint32_t get_type_slots(char type)
+{
+    return type == 'J' || type == 'D' ? 2 : 1;
+}
+
+struct method_slots
+{
+    uint32_t arguments;
+    uint32_t result;
+};
+
+// Returns the stack slots taken by the arguments and the result of a method descriptor, and adds
+// the offset of each parameter among the argument slots to `parameter_offsets` if given. Returns
+// nothing if the descriptor is malformed.
+std::optional<method_slots> get_method_slots(std::string_view descriptor,
+    std::vector<uint32_t>* parameter_offsets);
+
+// The method an invoke calls: the member reference the instruction refers to, unless it is
+// `invokedynamic`, and the method's descriptor.
+struct invoke_target
+{
+    const resolved_member_ref* member_ref;
+    std::string_view descriptor;
+};
+
+// Follows the constant pool index of an invoke to the method it calls. Returns nothing if it
+// doesn't refer to a method, or to a call site for `invokedynamic`.
+std::optional<invoke_target> resolve_invoke(const java_class& clazz, bytecode_tag instr,
+    constant_pool_entry_id cp_index);
+
+// A load, store or `iinc`, with the short forms such as `aload_0` and the widened forms turned into
+// the form taking the local as an operand.
+struct local_access
+{
+    bytecode_tag instruction;
+    uint32_t local;
+
+    bool is_store() const
+    {
+        return (instruction >= bytecode_tag::ISTORE && instruction <= bytecode_tag::ASTORE) ||
+            instruction == bytecode_tag::IINC;
+    }
+
+    bool is_wide_value() const
+    {
+        return instruction == bytecode_tag::LLOAD || instruction == bytecode_tag::DLOAD ||
+            instruction == bytecode_tag::LSTORE || instruction == bytecode_tag::DSTORE;
+    }
+};
+
+// Decodes the instruction at `pc`, which must be listed by the method's instruction index, if it
+// accesses a local.
+std::optional<local_access> decode_local_access(const uint8_t* bytecode, uint16_t pc);
+
+// Returns whether execution can continue with the instruction following the one at `pc`.
+bool can_fall_through(const uint8_t* bytecode, uint16_t pc);
+
+// Calls `cb(target)` with every pc the instruction at `pc` can branch to, which must be listed by
+// the method's instruction index. Targets are not checked against the code length.
+template <typename callback>
+void for_each_branch_target(const uint8_t* bytecode, uint16_t pc, callback&& cb)
+{
+    const auto instr = static_cast<bytecode_tag>(bytecode[pc]);
+    if ((instr >= bytecode_tag::IFEQ && instr <= bytecode_tag::JSR) ||
+        instr == bytecode_tag::IFNULL || instr == bytecode_tag::IFNONNULL)
+    {
+        cb(int64_t{pc} + static_cast<int16_t>(read_u2_operand(&bytecode[pc + 1])));
+    }
+    else if (instr == bytecode_tag::GOTO_W || instr == bytecode_tag::JSR_W)
+    {
+        cb(int64_t{pc} + read_s4_operand(&bytecode[pc + 1]));
+    }
+    else if (instr == bytecode_tag::TABLESWITCH || instr == bytecode_tag::LOOKUPSWITCH)
+    {
+        // The index checked that the jump table lies within the bytecode.
+        const uint32_t operands = (pc + 4u) & ~3u;
+        cb(int64_t{pc} + read_s4_operand(&bytecode[operands]));
+        if (instr == bytecode_tag::LOOKUPSWITCH)
+        {
+            const int32_t npairs = read_s4_operand(&bytecode[operands + 4]);
+            for (int32_t idx = 0; idx < npairs; idx++)
+            {
+                cb(int64_t{pc} + read_s4_operand(&bytecode[operands + 12 + 8 * idx]));
+            }
+        }
+        else
+        {
+            const int64_t entries = int64_t{read_s4_operand(&bytecode[operands + 8])} -
+                read_s4_operand(&bytecode[operands + 4]) + 1;
+            for (int64_t idx = 0; idx < entries; idx++)
+            {
+                cb(int64_t{pc} + read_s4_operand(&bytecode[operands + 12 + 4 * idx]));
+            }
+        }
+    }
+}
+
+// An operand stack of abstract values, where a default constructed `value` is one nothing is
+// known of. Only the slots pushed since the last call to `forget` are stored; those below are
+// merely counted, so forgetting the stack at each join takes time proportional to what was pushed
+// since the previous one.
+template <typename value>
+class abstract_stack
+{
+    std::vector<value> slots;
+    size_t unknown_depth = 0;
+
+public:
+    size_t depth() const
+    {
+        return unknown_depth + slots.size();
+    }
+
+    // The top `count` slots, deepest first, or nullptr if any of them isn't stored.
+    const value* top(size_t count) const
+    {
+        return count <= slots.size() ? slots.data() + slots.size() - count : nullptr;
+    }
+
+    void push(const value& slot)
+    {
+        slots.push_back(slot);
+    }
+
+    void push_unknown(size_t count)
+    {
+        slots.resize(slots.size() + count);
+    }
+
+    void pop(size_t count)
+    {
+        if (count <= slots.size())
+        {
+            slots.resize(slots.size() - count);
+            return;
+        }
+
+        // Malformed code can underflow the stack, which is then left empty.
+        unknown_depth -= std::min(unknown_depth, count - slots.size());
+        slots.clear();
+    }
+
+    value pop_value()
+    {
+        const value slot = slots.empty() ? value{} : slots.back();
+        pop(1);
+        return slot;
+    }
+
+    // Rearranges the top `pops` slots, numbered from the deepest, into `order`, as the `dup` and
+    // `swap` instructions do.
+    void permute(size_t pops, std::initializer_list<size_t> order)
+    {
+        if (depth() < pops)
+        {
+            pop(pops);
+            push_unknown(order.size());
+            return;
+        }
+
+        if (slots.size() < pops)
+        {
+            const size_t missing = pops - slots.size();
+            unknown_depth -= missing;
+            slots.insert(slots.begin(), missing, value{});
+        }
+
+        value popped[4];
+        std::copy(slots.end() - pops, slots.end(), popped);
+        slots.resize(slots.size() - pops);
+        for (const size_t idx : order)
+        {
+            slots.push_back(popped[idx]);
+        }
+    }
+
+    // Forgets every slot, leaving `new_depth` unknown ones.
+    void forget(size_t new_depth)
+    {
+        unknown_depth = new_depth;
+        slots.clear();
+    }
+
+    void assign(std::vector<value> new_slots)
+    {
+        unknown_depth = 0;
+        slots = std::move(new_slots);
+    }
+};
+
+// Steps through `dup`, `dup_x1`, `dup_x2`, `dup2`, `dup2_x1`, `dup2_x2` and `swap`. Returns false
+// if `instr` is none of them.
+template <typename value>
+bool step_stack_permutation(abstract_stack<value>& stack, bytecode_tag instr)
+{
+    switch (instr)
+    {
+        case bytecode_tag::DUP:
+            stack.permute(1, {0, 0});
+            return true;
+        case bytecode_tag::DUP_X1:
+            stack.permute(2, {1, 0, 1});
+            return true;
+        case bytecode_tag::DUP_X2:
+            stack.permute(3, {2, 0, 1, 2});
+            return true;
+        case bytecode_tag::DUP2:
+            stack.permute(2, {0, 1, 0, 1});
+            return true;
+        case bytecode_tag::DUP2_X1:
+            stack.permute(3, {1, 2, 0, 1, 2});
+            return true;
+        case bytecode_tag::DUP2_X2:
+            stack.permute(4, {2, 3, 0, 1, 2, 3});
+            return true;
+        case bytecode_tag::SWAP:
+            stack.permute(2, {1, 0});
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The operand stack and locals of a method stepped through in pc order, in a single pass, and the
+// joins where paths meet: branch targets, including those of backward branches, and exception
+// handlers. A local defined at most once holds the same value wherever it can be read, so it keeps
+// its value across joins; the receiver and parameters count as defined on entry. Every other local
+// and every stack slot is forgotten at a join, save for the stack depth.
+template <typename value>
+class abstract_frame
+{
+    static constexpr int32_t NO_JOIN = -1;
+    // Marks the target of a backward branch, whose stack depth on entry isn't known yet.
+    static constexpr int32_t LOOP_HEAD = -2;
+
+    std::vector<value> locals;
+    // How often each local is defined.
+    std::vector<uint32_t> definition_counts;
+    // The locals defined more than once which were stored to since the last join.
+    std::vector<uint32_t> reassigned_locals;
+    // For each pc, the stack depth on entry if it is a forward branch target or exception handler,
+    // or `LOOP_HEAD` if it is only known to be a backward branch target.
+    std::vector<int32_t> join_depths;
+    // The locals holding each parameter on entry.
+    std::vector<uint32_t> parameter_locals;
+    bool malformed_descriptor = false;
+
+    void count_definition(uint32_t local)
+    {
+        if (definition_counts.size() <= local)
+        {
+            definition_counts.resize(local + 1);
+        }
+
+        definition_counts[local]++;
+    }
+
+public:
+    abstract_stack<value> stack;
+
+    // Counts the definitions of each local of `method` and marks its joins, before stepping through
+    // `code`, its `Code` attribute.
+    abstract_frame(const method_info& method, const code_attribute& code) :
+        join_depths(code.get_code_length(), NO_JOIN)
+    {
+        std::vector<uint32_t> parameter_offsets;
+        malformed_descriptor = !get_method_slots(method.get_descriptor(), &parameter_offsets);
+        const bool is_static = (static_cast<uint16_t>(method.get_access_flags()) &
+            static_cast<uint16_t>(method_access_flags::Static)) != 0;
+        if (!is_static)
+        {
+            count_definition(0);
+        }
+
+        for (const uint32_t offset : parameter_offsets)
+        {
+            parameter_locals.push_back(offset + (is_static ? 0 : 1));
+            count_definition(parameter_locals.back());
+        }
+
+        const uint8_t* bytecode = code.get_bytecode();
+        for (const uint16_t pc : code.get_instruction_index())
+        {
+            if (const auto access = decode_local_access(bytecode, pc); access && access->is_store())
+            {
+                count_definition(access->local);
+                if (access->is_wide_value())
+                {
+                    count_definition(access->local + 1);
+                }
+            }
+
+            // The first instruction of a loop is reached again with whatever its body leaves in
+            // the locals, which isn't known until the body has been stepped through, so it is a
+            // join too.
+            for_each_branch_target(bytecode, pc, [&](int64_t target)
+            {
+                if (target >= 0 && target <= pc && join_depths[target] == NO_JOIN)
+                {
+                    join_depths[target] = LOOP_HEAD;
+                }
+            });
+        }
+
+        // Handlers are entered with only the thrown exception on the stack.
+        for (const exception_table_entry& entry : code.get_exception_table())
+        {
+            if (entry.handler_pc < join_depths.size())
+            {
+                join_depths[entry.handler_pc] = 1;
+            }
+        }
+    }
+
+    // Whether the method's own descriptor can't be parsed, leaving its parameters unknown.
+    bool has_malformed_descriptor() const
+    {
+        return malformed_descriptor;
+    }
+
+    const std::vector<uint32_t>& get_parameter_locals() const
+    {
+        return parameter_locals;
+    }
+
+    value get_local(uint32_t local) const
+    {
+        return local < locals.size() ? locals[local] : value{};
+    }
+
+    void store_local(uint32_t local, const value& stored, bool is_wide_value)
+    {
+        if (locals.size() < local + 2)
+        {
+            locals.resize(local + 2);
+        }
+
+        locals[local] = stored;
+        if (is_wide_value)
+        {
+            locals[local + 1] = value{};
+        }
+
+        if (local < definition_counts.size() && definition_counts[local] > 1)
+        {
+            reassigned_locals.push_back(local);
+        }
+    }
+
+    // Records that the instruction at `pc` may branch to `target` with `depth` stack slots.
+    // Backward branch targets were already marked before the pass.
+    void add_branch(uint16_t pc, int64_t target, size_t depth)
+    {
+        if (target > pc && target < static_cast<int64_t>(join_depths.size()))
+        {
+            join_depths[target] = static_cast<int32_t>(depth);
+        }
+    }
+
+    // Called before stepping through the instruction at `pc`, with whether the previous one can
+    // fall through to it. Forgets what isn't the same on every path reaching it.
+    void enter_instruction(uint16_t pc, bool falls_through)
+    {
+        if (falls_through && join_depths[pc] == NO_JOIN)
+        {
+            return;
+        }
+
+        for (const uint32_t local : reassigned_locals)
+        {
+            locals[local] = value{};
+        }
+
+        reassigned_locals.clear();
+        stack.forget(falls_through ? stack.depth() : std::max(join_depths[pc], 0));
+    }
+};
@@ -0,0 +1,141 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "byte_order.hh"
+
+// Describes why a classfile was rejected and the byte offset at which parsing gave up.
+struct class_parse_error
+{
+    const char* message;
+    size_t offset;
+};
+
+template <typename T>
+using parse_result = std::variant<T, class_parse_error>;
+
+// A bounds-checked cursor over an in-memory classfile. Parsers only ever see this, so a class can
+// be parsed from a file that was read up front, a mapped archive member or a fuzzer's buffer alike.
+//
+// Errors are sticky rather than thrown: the first `fail` is recorded and every later read fails
+// without consuming anything, so the parsers unwind through their ordinary control flow (reading
+// zeros) and the caller checks `get_error` once at the end.
+class class_reader
+{
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    std::optional<class_parse_error> error;
+
+public:
+    explicit class_reader(const uint8_t* data, size_t size) :
+        data{data},
+        size{size}
+    {}
+
+    // Copies the next `length` bytes into `out`. Nothing is consumed if fewer bytes remain.
+    bool read(char* out, size_t length)
+    {
+        if (error || length > remaining())
+        {
+            return false;
+        }
+
+        std::memcpy(out, data + position, length);
+        position += length;
+        return true;
+    }
+
+    // Points `out` at the next `length` bytes without copying them. The view is only valid as long
+    // as the underlying buffer.
+    bool read_view(std::string_view& out, size_t length)
+    {
+        if (error || length > remaining())
+        {
+            return false;
+        }
+
+        out = std::string_view{reinterpret_cast<const char*>(data + position), length};
+        position += length;
+        return true;
+    }
+
+    // Replaces `out` with the next `count` big-endian u2 values in host order. Nothing is consumed
+    // if fewer bytes remain.
+    bool read_u2_array(std::vector<uint16_t>& out, size_t count)
+    {
+        if (error || count > remaining() / 2)
+        {
+            return false;
+        }
+
+        out.resize(count);
+        decode_big_endian_u2_array(data + position, out.data(), count);
+        position += count * 2;
+        return true;
+    }
+
+    bool skip(size_t length)
+    {
+        if (error || length > remaining())
+        {
+            return false;
+        }
+
+        position += length;
+        return true;
+    }
+
+    size_t tell() const
+    {
+        return position;
+    }
+
+    size_t remaining() const
+    {
+        return size - position;
+    }
+
+    // Records `message` at the current offset unless an earlier error was already recorded.
+    void fail(const char* message)
+    {
+        if (!error)
+        {
+            error = class_parse_error{message, position};
+        }
+    }
+
+    bool failed() const
+    {
+        return error.has_value();
+    }
+
+    const std::optional<class_parse_error>& get_error() const
+    {
+        return error;
+    }
+};
@@ -23,11 +23,15 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "attribute_info.hh"
 #include "bytecode.hh"
 #include "constant_pool.hh"
+#include "instruction_index.hh"
 #include "util.hh"
 
 struct exception_table_entry
@@ -58,6 +62,9 @@ class code_attribute: public attribute_info
     std::unique_ptr<uint8_t[]> bytecode;
     std::vector<exception_table_entry> exception_table;
     entry_attributes code_attributes;
+    // Built on first use so that methods the scan never decodes don't pay for it. Not safe to build
+    // from several threads at once; a class is only ever worked on by one thread.
+    mutable std::optional<instruction_index> instructions;
 
 public:
     explicit code_attribute(const constant_pool& cp, uint16_t max_stack, uint16_t max_locals,
@@ -76,77 +83,75 @@ public:
 
     template <bytecode_tag instr>
     using find_instructions_cb =
-        // Since each instruction tag is one byte, the instruction size minus one is the number of
-        // instruction operands.
-        typename find_instructions_cb_fn_type<get_instruction_size(instr) - 1>::type;
+        typename find_instructions_cb_fn_type<typename instruction_operands<instr>::type>::type;
 
-    template <bytecode_tag instr>
-    void find_instruction(find_instructions_cb<instr> cb) const
+    // Returns the start offset of every instruction, decoding the bytecode on the first call.
+    const instruction_index& get_instruction_index() const;
+
+    // Returns whether any byte of the bytecode, opcode or operand alike, could be one of the field
+    // access or `invoke*` opcodes. When it can't, no instruction in the method refers to a member
+    // and decoding the method to look for one can be skipped.
+    bool may_contain_member_access() const;
+
+    // Likewise for the opcodes that name a class, from `new` to `multianewarray`, and `ldc`. Since
+    // `ldc` is a common byte, this rules out far fewer methods.
+    bool may_contain_type_use() const;
+
+    // Calls `cb(std::integral_constant<bytecode_tag, instr>{}, pc, operands...)` for every
+    // instruction whose opcode is one of `instrs`, in pc order. Each opcode's operands are decoded
+    // by code generated for its layout, so nothing is decided at runtime beyond which opcode matched.
+    template <bytecode_tag... instrs, typename callback>
+    void find_instructions(callback&& cb) const
     {
-        constexpr size_t target_instr_operands_size = get_instruction_size(instr) - 1;
-        for (uint32_t pc = 0; pc < code_length;)
+        for (const uint16_t pc : get_instruction_index())
         {
             const bytecode_tag curr_instr = static_cast<bytecode_tag>(bytecode[pc]);
-            const size_t curr_instr_size = get_instruction_size(curr_instr);
-            // These are variable-sized instructions and require special parsing.
-            if (curr_instr == bytecode_tag::LOOKUPSWITCH ||
-                curr_instr == bytecode_tag::TABLESWITCH)
-            {
-                // Skip past padding bytes until we get to the first address that is a multiple of 4.
-                if (pc % 4 != 0)
-                {
-                    for (; pc % 4 != 0; pc++);
-                }
-
-                // Skip `default` bytes.
-                pc += 4;
-                if (curr_instr == bytecode_tag::LOOKUPSWITCH)
-                {
-                    // `npairs` is a signed 4-byte, big-endian integer. This should probably never
-                    // be negative.
-                    uint32_t* npairs_bytes = reinterpret_cast<uint32_t*>(&bytecode[pc]);
-                    uint32_t npairs = to_little_endian_int(*npairs_bytes);
-                    // Each pair consists of two 4-byte ints.
-                    pc += 8 * npairs;
-                }
-                else if (curr_instr == bytecode_tag::TABLESWITCH)
-                {
-                    // Read both `low` and `high` signed ints. These should probably never be
-                    // negative.
-                    uint32_t* low_bytes = reinterpret_cast<uint32_t*>(&bytecode[pc]);
-                    uint32_t low = to_little_endian_int(*low_bytes);
-                    pc += 4;
-
-                    uint32_t* high_bytes = reinterpret_cast<uint32_t*>(&bytecode[pc]);
-                    uint32_t high = to_little_endian_int(*high_bytes);
-                    // There are `high - low + 1` signed integer offsets that must be skipped.
-                    pc += 4 * (high - low + 1 + 1);
-                }
-
-                continue;
-            }
+            // One comparison per opcode in `instrs`, stopping at the first match.
+            ((curr_instr == instrs && (call_with_operands<instrs>(cb, pc), true)) || ...);
+        }
+    }
 
-            if (curr_instr == instr)
+    // Like `find_instructions`, but `cb` returns whether to stop, and no instruction after the one
+    // it stopped at is decoded. Returns whether it stopped.
+    template <bytecode_tag... instrs, typename callback>
+    bool find_instructions_until(callback&& cb) const
+    {
+        for (const uint16_t pc : get_instruction_index())
+        {
+            const bytecode_tag curr_instr = static_cast<bytecode_tag>(bytecode[pc]);
+            bool stop = false;
+            ((curr_instr == instrs && (stop = call_with_operands<instrs>(cb, pc), true)) || ...);
+            if (stop)
             {
-                // The type of `operands` is a `std::tuple` with a variable number of types
-                // (depends on the cb function given).
-                typename function_args_tuple<decltype(cb)>::type operands;
-                std::get<0>(operands) = pc & 0xFFFF;
-                // A `constexpr-for` construct would be perfect here...
-                if constexpr (target_instr_operands_size >= 1)
-                    std::get<1>(operands) = bytecode[pc + 1];
-                if constexpr (target_instr_operands_size >= 2)
-                    std::get<2>(operands) = bytecode[pc + 2];
-                if constexpr (target_instr_operands_size >= 3)
-                    std::get<3>(operands) = bytecode[pc + 3];
-                if constexpr (target_instr_operands_size >= 4)
-                    std::get<4>(operands) = bytecode[pc + 4];
-
-                std::apply(cb, operands);
+                return true;
             }
-
-            pc += curr_instr_size;
         }
+
+        return false;
+    }
+
+    template <bytecode_tag instr>
+    void find_instruction(find_instructions_cb<instr> cb) const
+    {
+        find_instructions<instr>([&](auto, uint16_t pc, auto... operands)
+        {
+            cb(pc, operands...);
+        });
+    }
+
+    const uint8_t* get_bytecode() const
+    {
+        return bytecode.get();
+    }
+
+    uint32_t get_code_length() const
+    {
+        return code_length;
+    }
+
+    const std::vector<exception_table_entry>& get_exception_table() const
+    {
+        return exception_table;
     }
 
     const entry_attributes& get_code_attributes() const
@@ -158,6 +163,16 @@ public:
     {
         return attribute_info_type::code;
     }
+
+private:
+    template <bytecode_tag instr, typename callback>
+    auto call_with_operands(callback& cb, uint16_t pc) const
+    {
+        return std::apply([&](auto... operands)
+        {
+            return cb(std::integral_constant<bytecode_tag, instr>{}, pc, operands...);
+        }, instruction_operands<instr>::decode(&bytecode[pc]));
+    }
 };
 
-std::unique_ptr<attribute_info> parse_code_attribute(std::ifstream& file, const constant_pool& cp);
+std::unique_ptr<attribute_info> parse_code_attribute(class_reader& file, const constant_pool& cp);
@@ -19,7 +19,6 @@
 
 #pragma once
 
-#include <fstream>
 #include <map>
 #include <memory>
 #include <optional>
@@ -28,6 +27,7 @@
 
 using constant_pool_entry_id = uint16_t;
 
+#include "class_reader.hh"
 #include "constant_pool_entry_parser.hh"
 
 enum class constant_pool_type : uint8_t
@@ -81,6 +81,8 @@ public:
         return entries.cend();
     }
 
+    // Returns the entry at `index` if there is one and it holds a `T`. Classes can reference any
+    // index, so a missing entry or one of another type must not be treated as fatal here.
     template <typename T>
     std::optional<T> get_entry_as(constant_pool_entry_id index) const
     {
@@ -89,12 +91,30 @@ public:
         {
             return std::nullopt;
         }
-        else
+
+        const T* entry = std::get_if<T>(&entries_it->second.entry);
+        if (!entry)
         {
-            return std::get<T>(entries_it->second.entry);
+            return std::nullopt;
         }
+
+        return *entry;
+    }
+
+    // Returns the entry at `index` without copying it, if there is one tagged `type`. The tag tells
+    // apart entries that share a representation, e.g. Class and String.
+    template <typename T>
+    const T* find_entry_as(constant_pool_entry_id index, constant_pool_type type) const
+    {
+        auto entries_it = entries.find(index);
+        if (entries_it == entries.cend() || entries_it->second.type != type)
+        {
+            return nullptr;
+        }
+
+        return std::get_if<T>(&entries_it->second.entry);
     }
 
     std::optional<constant_pool_entry_info> get_entry_info(constant_pool_entry_id index) const;
-    static constant_pool parse_constant_pool(std::ifstream& file);
+    static constant_pool parse_constant_pool(class_reader& file);
 };
@@ -19,16 +19,26 @@
 
 #pragma once
 
-#include <fstream>
+#include <string>
+#include <string_view>
 
+#include "class_reader.hh"
 #include "constant_pool.hh"
+#include "symbol_table.hh"
 
 template <typename T>
 struct cp_value_entry
 {
     T value;
 };
-using cp_utf8_entry = cp_value_entry<std::string>;
+
+// Utf8 entries are interned as they are parsed; `value` views the process-wide copy of the string.
+struct cp_utf8_entry
+{
+    symbol_id symbol;
+    std::string_view value;
+};
+
 using cp_integer_entry = cp_value_entry<int32_t>;
 using cp_float_entry = cp_value_entry<float>;
 using cp_long_entry = cp_value_entry<int64_t>;
@@ -59,11 +69,11 @@ struct cp_methodhandle_info_entry
     constant_pool_entry_id reference_index;
 };
 
-cp_utf8_entry parse_cp_utf8_entry(std::ifstream& file);
-cp_integer_entry parse_cp_integer_entry(std::ifstream& file);
-cp_float_entry parse_cp_float_entry(std::ifstream& file);
-cp_long_entry parse_cp_long_entry(std::ifstream& file);
-cp_double_entry parse_cp_double_entry(std::ifstream& file);
-cp_index_entry parse_cp_index_entry(std::ifstream& file);
-cp_double_index_entry parse_cp_double_index_entry(std::ifstream& file);
-cp_methodhandle_info_entry parse_cp_methodhandle_info_entry(std::ifstream& file);
+cp_utf8_entry parse_cp_utf8_entry(class_reader& file);
+cp_integer_entry parse_cp_integer_entry(class_reader& file);
+cp_float_entry parse_cp_float_entry(class_reader& file);
+cp_long_entry parse_cp_long_entry(class_reader& file);
+cp_double_entry parse_cp_double_entry(class_reader& file);
+cp_index_entry parse_cp_index_entry(class_reader& file);
+cp_double_index_entry parse_cp_double_index_entry(class_reader& file);
+cp_methodhandle_info_entry parse_cp_methodhandle_info_entry(class_reader& file);
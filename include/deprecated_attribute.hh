@@ -35,5 +35,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_deprecated_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_deprecated_attribute(class_reader& file,
     const constant_pool& cp);
@@ -44,5 +44,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_enclosing_method_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_enclosing_method_attribute(class_reader& file,
     const constant_pool& cp);
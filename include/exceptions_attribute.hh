@@ -41,5 +41,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_exceptions_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_exceptions_attribute(class_reader& file,
     const constant_pool& cp);
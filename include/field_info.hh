@@ -19,11 +19,11 @@
 
 #pragma once
 
-#include <fstream>
 #include <memory>
 #include <vector>
 
 #include "attribute_info.hh"
+#include "class_reader.hh"
 #include "constant_pool.hh"
 
 enum class field_access_flags : uint16_t
@@ -45,7 +45,7 @@ class field_info
         entry_attributes field_attributes);
 
 public:
-    static field_info parse_field(std::ifstream& file, const constant_pool& cp);
+    static field_info parse_field(class_reader& file, const constant_pool& cp);
 };
 
-std::vector<field_info> parse_fields(std::ifstream& file, const constant_pool& cp);
+std::vector<field_info> parse_fields(class_reader& file, const constant_pool& cp);
@@ -19,17 +19,118 @@
 
 #pragma once
 
+#include <atomic>
 #include <optional>
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "api_rules.hh"
+#include "argument_origins.hh"
+#include "bytecode.hh"
+#include "code_attribute.hh"
 #include "java_class.hh"
+#include "symbol_table.hh"
+
+enum class api_use_kind
+{
+    method_call, field_access,
+    // The type itself is used, e.g. by `new`, `checkcast` or loading its Class or a MethodType.
+    type_use
+};
 
 struct api_call_info
 {
     uint16_t line_number;
+    api_use_kind kind;
+    bytecode_tag instruction;
+    // For type uses, the Class entry's name or the MethodType's descriptor.
     std::string api_str;
+    // The descriptor of the called method, e.g. `(Ljava/lang/String;)V`, or the type of the
+    // accessed field.
+    std::string descriptor;
+    // The calling method's name followed by its descriptor.
     std::string method;
+    // Every rule the call matched.
+    std::vector<rule_match> matches;
+    // Set when the use was recovered from a reflective lookup, `instruction` being the call to it.
+    // The descriptor of a member found this way isn't known and is left empty.
+    bool reflective = false;
+    // Set when the call was matched by the class of its receiver, `api_str` naming the method of
+    // that class, to the class the instruction refers to.
+    std::string declared_owner;
+    // Where each argument of a call comes from, if asked for.
+    std::vector<argument_origin> argument_origins;
 };
 
-std::vector<api_call_info> find_api_calls(const java_class& clazz,
-    const std::vector<std::string>& apis);
+// Identifies what a use refers to by interned symbols, so that uses can be counted without building
+// any strings. Type uses are told apart by instruction and only have an owner: the Class name or
+// MethodType descriptor. Calls and field accesses leave the instruction as `nop`. Targets of
+// reflective lookups are set apart, with `NO_SYMBOL` for the descriptor, and the name of a class
+// loaded by name.
+struct api_use_key
+{
+    api_use_kind kind;
+    bytecode_tag instruction;
+    symbol_id owner;
+    symbol_id name;
+    symbol_id descriptor;
+    bool reflective = false;
+
+    bool operator==(const api_use_key& other) const
+    {
+        return kind == other.kind && instruction == other.instruction && owner == other.owner &&
+            name == other.name && descriptor == other.descriptor &&
+            reflective == other.reflective;
+    }
+};
+
+struct api_use_key_hash
+{
+    size_t operator()(const api_use_key& key) const
+    {
+        size_t hash = std::hash<uint32_t>{}(key.owner);
+        for (const uint32_t part : {static_cast<uint32_t>(key.kind),
+            static_cast<uint32_t>(key.instruction), key.name, key.descriptor,
+            static_cast<uint32_t>(key.reflective)})
+        {
+            hash = hash * 31 + part;
+        }
+
+        return hash;
+    }
+};
+
+using api_use_counts = std::unordered_map<api_use_key, size_t, api_use_key_hash>;
+
+// Returns the source line of the instruction at `pc`. Throws `invalid_class_format` if the method
+// has no line number for it.
+uint16_t get_line_number(const code_attribute& code, uint16_t pc);
+
+// Finds the uses matching the rules, in method then pc order. With `with_argument_origins`, the
+// arguments of each call found are also labelled with where they come from, which takes another
+// pass over the methods with such calls.
+std::vector<api_call_info> find_api_calls(const java_class& clazz, const api_rule_set& rules,
+    bool with_argument_origins = false);
+
+// Returns whether the class can have any use matching the rules, `matching_refs` being the rules as
+// compiled for it, from its constant pool alone, so the rest of a class without any needn't be
+// parsed.
+bool may_find_api_uses(const java_class& clazz, const api_rule_set& rules,
+    const compiled_api_rules& matching_refs);
+
+// Counts the uses matching the rules without resolving line numbers or building strings, including
+// the targets of reflective lookups and the calls matching by their receiver's class as
+// `find_api_calls` reports them. Returns how many were found.
+size_t count_api_uses(const java_class& clazz, const api_rule_set& rules, api_use_counts& counts);
+
+// Returns a use matching the rules, `matching_refs` being the rules as compiled for this class, and
+// stops looking once one is found. Uses made by instructions directly are looked for first, so the
+// passes following values through the stack only run for classes without any. Gives up, returning
+// nothing, once `cancelled` is set, which is checked between methods.
+std::optional<api_use_key> find_first_api_use(const java_class& clazz, const api_rule_set& rules,
+    const compiled_api_rules& matching_refs, const std::atomic<bool>* cancelled = nullptr);
+
+// Returns a use's name as `find_api_calls` reports it, e.g. `java/io/File.delete()Z`.
+std::string get_api_use_name(const api_use_key& key);
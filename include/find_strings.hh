@@ -0,0 +1,55 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "constant_pool.hh"
+#include "java_class.hh"
+#include "string_patterns.hh"
+
+struct string_use_info
+{
+    uint16_t line_number;
+    // The loading method's name followed by its descriptor.
+    std::string method;
+};
+
+struct string_indicator_info
+{
+    // The Utf8 entry holding the string.
+    constant_pool_entry_id cp_index;
+    // The string as standard UTF-8.
+    std::string value;
+    // Every pattern the string matched, in the order they were added.
+    std::vector<uint32_t> patterns;
+    // Every `ldc` loading the string as a String constant.
+    std::vector<string_use_info> uses;
+};
+
+// Matches every Utf8 constant of the class against the patterns, returning those matching any.
+// Only the constant pool is looked at, so the uses are left empty.
+std::vector<string_indicator_info> match_string_constants(const constant_pool& cp,
+    const string_pattern_set& patterns);
+
+// Fills in the uses of the strings `match_string_constants` found in the class.
+void find_string_uses(const java_class& clazz, std::vector<string_indicator_info>& indicators);
@@ -58,5 +58,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_inner_classes_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_inner_classes_attribute(class_reader& file,
     const constant_pool& cp);
@@ -0,0 +1,70 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Returns the length of the instruction starting at `pc`, including the padding and jump tables of
+// `tableswitch`/`lookupswitch` and the widened operands following `wide`. Returns 0 if the
+// instruction is malformed or would run past the end of the bytecode.
+uint32_t get_instruction_length(const uint8_t* bytecode, uint32_t code_length, uint32_t pc);
+
+// The start offset of every instruction of a method, decoded in a single pass so that the scanners,
+// the disassembler and any other analysis can step through instructions without working out their
+// lengths again. Every listed instruction lies entirely within the bytecode, operands included.
+class instruction_index
+{
+    std::vector<uint16_t> offsets;
+    // Decoding stops at the first malformed instruction since nothing after it can be located.
+    std::optional<uint32_t> malformed_pc;
+
+public:
+    explicit instruction_index(const uint8_t* bytecode, uint32_t code_length);
+
+    std::vector<uint16_t>::const_iterator begin() const
+    {
+        return offsets.cbegin();
+    }
+
+    std::vector<uint16_t>::const_iterator end() const
+    {
+        return offsets.cend();
+    }
+
+    size_t size() const
+    {
+        return offsets.size();
+    }
+
+    uint16_t operator[](size_t idx) const
+    {
+        return offsets[idx];
+    }
+
+    // Returns whether an instruction starts at `pc`, e.g. to check a branch target.
+    bool is_instruction_start(uint32_t pc) const;
+
+    // The offset of the instruction that stopped decoding, if any.
+    const std::optional<uint32_t>& get_malformed_pc() const
+    {
+        return malformed_pc;
+    }
+};
@@ -19,13 +19,15 @@
 
 #pragma once
 
-#include <fstream>
+#include <functional>
 #include <memory>
 #include <optional>
 
 #include "attribute_info.hh"
+#include "class_reader.hh"
 #include "constant_pool.hh"
 #include "field_info.hh"
+#include "member_ref_table.hh"
 #include "method_info.hh"
 
 enum class classfile_access_flag : uint16_t
@@ -36,7 +38,11 @@ enum class classfile_access_flag : uint16_t
 
 class java_class
 {
-    constant_pool cp;
+    // Fields, methods and attributes keep references to the constant pool, so it lives on the
+    // heap where it stays put when the class is moved.
+    std::unique_ptr<constant_pool> cp;
+    // Points into `cp`, so it must be declared, and built, after it.
+    member_ref_table member_refs;
     classfile_access_flag access_flags;
     constant_pool_entry_id this_index;
     constant_pool_entry_id super_index;
@@ -57,7 +63,12 @@ public:
 
     const constant_pool& get_class_constant_pool() const
     {
-        return cp;
+        return *cp;
+    }
+
+    const member_ref_table& get_class_member_refs() const
+    {
+        return member_refs;
     }
 
     classfile_access_flag get_class_access_flags() const
@@ -95,5 +106,26 @@ public:
         return attributes;
     }
 
+    // These throw `invalid_class_format` if the class cannot be parsed.
     static java_class parse_class_file(const std::string& path);
+    // Parses a classfile that is already in memory. Nothing refers back to `data` afterwards.
+    static java_class parse_class_bytes(const uint8_t* data, size_t size);
+
+    // Called once the constant pool and the class header up to its interfaces have been parsed.
+    // Returning false stops parsing there, leaving the class without fields, methods or
+    // attributes; an empty filter parses the whole class.
+    using parse_filter = std::function<bool(const java_class&)>;
+
+    // Returns whether `data` starts with the magic number of a classfile.
+    static bool is_class_file(const uint8_t* data, size_t size);
+
+    // Reads the whole classfile at `path` into memory.
+    static parse_result<std::vector<uint8_t>> try_read_class_file(const std::string& path);
+
+    // Non-throwing variants which report what failed and at which offset instead. These are
+    // meant for batch scans where some inputs are expected to be corrupt.
+    static parse_result<java_class> try_parse_class_file(const std::string& path,
+        const parse_filter& filter = {});
+    static parse_result<java_class> try_parse_class_bytes(const uint8_t* data, size_t size,
+        const parse_filter& filter = {});
 };
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <algorithm>
+#include <iterator>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -45,27 +46,30 @@ class line_number_table_attribute: public attribute_info {
 public:
     explicit line_number_table_attribute(std::vector<line_number_table_entry> line_number_table) :
         line_number_table{std::move(line_number_table)}
-    {}
+    {
+        // Compilers do not have to emit entries in pc order (javac doesn't for loops), so sort
+        // once here to make every lookup a binary search.
+        std::stable_sort(this->line_number_table.begin(), this->line_number_table.end(),
+            [](const auto& lhs, const auto& rhs)
+            {
+                return lhs.start_pc < rhs.start_pc;
+            });
+    }
 
     std::optional<uint16_t> find_line_number_from_pc(uint16_t pc) const
     {
-        if (line_number_table.empty())
-        {
-            return std::nullopt;
-        }
-
-        auto it = std::adjacent_find(line_number_table.cbegin(), line_number_table.cend(),
-            [pc](const auto& curr_entry, const auto& next_entry)
+        // The line is given by the last entry that starts at or before `pc`.
+        auto it = std::upper_bound(line_number_table.cbegin(), line_number_table.cend(), pc,
+            [](uint16_t pc, const auto& entry)
             {
-                return next_entry.start_pc > pc;
+                return pc < entry.start_pc;
             });
-        // Past the end, so use the last element.
-        if (it == line_number_table.cend())
+        if (it == line_number_table.cbegin())
         {
-            return line_number_table.back().line_number;
+            return std::nullopt;
         }
 
-        return it->line_number;
+        return std::prev(it)->line_number;
     }
 
     virtual attribute_info_type get_type() const
@@ -74,5 +78,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_line_number_table_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_line_number_table_attribute(class_reader& file,
     const constant_pool& cp);
@@ -59,5 +59,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_local_variable_table_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_local_variable_table_attribute(class_reader& file,
     const constant_pool& cp);
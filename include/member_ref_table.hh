@@ -0,0 +1,79 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "constant_pool.hh"
+#include "symbol_table.hh"
+
+// A Fieldref, Methodref or InterfaceMethodref with its Class and NameAndType links followed down to
+// the Utf8 entries they name, both as interned symbols and as strings.
+struct resolved_member_ref
+{
+    constant_pool_type type;
+    constant_pool_entry_id owner_index;
+    constant_pool_entry_id name_index;
+    constant_pool_entry_id descriptor_index;
+    symbol_id owner_symbol;
+    symbol_id name_symbol;
+    symbol_id descriptor_symbol;
+    std::string_view owner;
+    std::string_view name;
+    std::string_view descriptor;
+};
+
+// Every member reference of a class, resolved in a single pass over the constant pool. Looking one
+// up by the index an instruction carries is then one bounds check and one array load instead of a
+// chain of constant pool lookups.
+class member_ref_table
+{
+    struct slot
+    {
+        bool resolved;
+        resolved_member_ref ref;
+    };
+
+    // Indexed by constant pool index. Slots of other entries, and of references with a broken
+    // chain, are left unresolved.
+    std::vector<slot> slots;
+
+public:
+    explicit member_ref_table(const constant_pool& cp);
+    member_ref_table() = default;
+
+    // Returns the resolved reference at `index`, or nullptr if `index` isn't a member reference
+    // whose chain leads to well-typed entries.
+    const resolved_member_ref* find(constant_pool_entry_id index) const
+    {
+        if (index >= slots.size() || !slots[index].resolved)
+        {
+            return nullptr;
+        }
+
+        return &slots[index].ref;
+    }
+
+    // One past the highest constant pool index the table covers.
+    size_t size() const
+    {
+        return slots.size();
+    }
+};
@@ -0,0 +1,40 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "symbol_table.hh"
+
+// A method descriptor such as `(ILjava/lang/String;[J)V`, split into the field descriptors of its
+// parameters and its return type, each interned.
+struct method_descriptor
+{
+    std::vector<symbol_id> parameter_types;
+    // `V` for methods returning void.
+    symbol_id return_type;
+};
+
+// Parses a method descriptor as laid out in JVMS 4.3.3. Returns nothing if it is malformed.
+std::optional<method_descriptor> parse_method_descriptor(std::string_view descriptor);
+
+// Returns whether `descriptor` is a single field descriptor, e.g. `[Ljava/lang/String;`.
+bool is_valid_field_descriptor(std::string_view descriptor);
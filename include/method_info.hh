@@ -19,12 +19,15 @@
 
 #pragma once
 
-#include <fstream>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "attribute_info.hh"
+#include "class_reader.hh"
 #include "constant_pool.hh"
+#include "invalid_class_format_exception.hh"
 
 enum class method_access_flags : uint16_t
 {
@@ -36,9 +39,9 @@ enum class method_access_flags : uint16_t
 class method_info
 {
     const constant_pool& cp;
-    [[maybe_unused]] method_access_flags access_flags;
+    method_access_flags access_flags;
     constant_pool_entry_id name_index;
-    [[maybe_unused]] constant_pool_entry_id descriptor_index;
+    constant_pool_entry_id descriptor_index;
     entry_attributes method_attributes;
 
     explicit method_info(const constant_pool& cp, method_access_flags access_flags,
@@ -46,6 +49,11 @@ class method_info
         entry_attributes method_attributes);
 
 public:
+    method_access_flags get_access_flags() const
+    {
+        return access_flags;
+    }
+
     constant_pool_entry_id get_name_index() const
     {
         return name_index;
@@ -53,8 +61,24 @@ public:
 
     std::string get_name() const
     {
-        auto method_name_utf8_ref = cp.get_entry_as<cp_utf8_entry>(name_index).value();
-        return method_name_utf8_ref.value;
+        auto method_name_utf8_ref = cp.get_entry_as<cp_utf8_entry>(name_index);
+        if (!method_name_utf8_ref)
+        {
+            throw invalid_class_format{"Method name index does not refer to a Utf8 entry."};
+        }
+
+        return std::string{method_name_utf8_ref->value};
+    }
+
+    std::string_view get_descriptor() const
+    {
+        auto descriptor_utf8_ref = cp.get_entry_as<cp_utf8_entry>(descriptor_index);
+        if (!descriptor_utf8_ref)
+        {
+            throw invalid_class_format{"Method descriptor index does not refer to a Utf8 entry."};
+        }
+
+        return descriptor_utf8_ref->value;
     }
 
     const entry_attributes& get_method_attributes() const
@@ -62,7 +86,7 @@ public:
         return method_attributes;
     }
 
-    static method_info parse_method_info(std::ifstream& file, const constant_pool& cp);
+    static method_info parse_method_info(class_reader& file, const constant_pool& cp);
 };
 
-std::vector<method_info> parse_methods(std::ifstream& file, const constant_pool& cp);
+std::vector<method_info> parse_methods(class_reader& file, const constant_pool& cp);
@@ -0,0 +1,36 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Returns whether `data` is well-formed modified UTF-8 as used by constant pool Utf8 entries
+// (JVMS 4.4.7): no zero bytes, no bytes in 0xF0-0xFF, and every code unit in its shortest one, two
+// or three byte form, except NUL which must be encoded as 0xC0 0x80. Supplementary characters are
+// surrogate pairs of three byte sequences, and, as in Java strings, a surrogate may stand alone.
+// Runs of plain ASCII are checked a vector at a time.
+bool is_valid_modified_utf8(const uint8_t* data, size_t length);
+
+// Converts valid modified UTF-8 to standard UTF-8 for display: 0xC0 0x80 becomes a NUL byte,
+// surrogate pairs become four byte sequences and lone surrogates become U+FFFD. ASCII input is
+// returned unchanged.
+std::string modified_utf8_to_utf8(std::string_view input);
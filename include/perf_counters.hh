@@ -0,0 +1,75 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Hardware events sampled around each pipeline phase when `--perf` is given.
+enum class perf_event_kind : uint8_t
+{
+    cycles, instructions, l1d_misses, llc_misses, branch_misses
+};
+
+constexpr size_t TOTAL_PERF_EVENTS = static_cast<size_t>(perf_event_kind::branch_misses) + 1;
+
+using perf_event_values = std::array<uint64_t, TOTAL_PERF_EVENTS>;
+
+struct perf_reading
+{
+    perf_event_values values{};
+    // Nanoseconds the group has been enabled, and actually counting. Running falls behind enabled
+    // when the kernel multiplexes the counters with other events, so the values then undercount.
+    uint64_t time_enabled = 0;
+    uint64_t time_running = 0;
+};
+
+// A group of hardware counters that count for the calling thread only. Events the kernel or the
+// hardware refuses (e.g. inside VMs, or with a restrictive `perf_event_paranoid`) are left out and
+// read as zero.
+class perf_counter_group
+{
+    std::array<int, TOTAL_PERF_EVENTS> fds;
+    // Position of each event within the group read buffer, or -1 if it could not be opened.
+    std::array<int, TOTAL_PERF_EVENTS> slots;
+    size_t opened_events = 0;
+
+public:
+    perf_counter_group();
+    ~perf_counter_group();
+
+    perf_counter_group(const perf_counter_group&) = delete;
+    perf_counter_group& operator=(const perf_counter_group&) = delete;
+
+    // Returns false if not even the cycle counter could be opened; `reason` then describes why.
+    bool open(const char*& reason);
+
+    bool is_open() const
+    {
+        return opened_events > 0;
+    }
+
+    bool has_event(perf_event_kind kind) const
+    {
+        return slots[static_cast<size_t>(kind)] >= 0;
+    }
+
+    perf_reading read() const;
+};
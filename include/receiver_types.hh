@@ -0,0 +1,47 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "code_attribute.hh"
+#include "java_class.hh"
+#include "method_info.hh"
+
+// The static type of the receiver of an `invokevirtual` or `invokeinterface`, where it is a class
+// other than the one the instruction refers to: `java/util/ArrayList` for a call of
+// `java/util/List.add` on a list the method created, or a class implementing `Runnable` whose
+// `run` is called through the interface.
+struct receiver_type
+{
+    uint16_t pc;
+    // The receiver's class in internal form.
+    std::string_view type;
+};
+
+// Finds the receiver types of a method's calls in a single forward pass over its bytecode. The
+// types of the locals and stack are taken from the method's StackMapTable at each frame, which the
+// compiler emits at every branch target and exception handler, and are followed from instruction
+// to instruction in between, so no fixpoint has to be computed. Methods which branch without a
+// StackMapTable, as in classes older than Java 6, are skipped.
+std::vector<receiver_type> find_receiver_types(const java_class& clazz, const method_info& method,
+    const code_attribute& code);
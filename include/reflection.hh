@@ -0,0 +1,58 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "code_attribute.hh"
+#include "find_api_calls.hh"
+#include "java_class.hh"
+#include "method_info.hh"
+
+// What a reflective lookup resolves to: a class loaded by name, or a method, constructor or field
+// looked up by name in a class. The names are in internal form; constructors are named `<init>`.
+struct reflective_target
+{
+    // The pc of the lookup call.
+    uint16_t pc;
+    api_use_kind kind;
+    std::string owner;
+    // Empty for classes.
+    std::string name;
+};
+
+// Returns whether the class calls any of the lookups `find_reflective_targets` follows, so classes
+// without any needn't have their code interpreted.
+bool may_use_reflection(const java_class& clazz);
+
+// Returns names found in the bytes of every class calling one of the lookups: `java/lang/Class`,
+// which also appears in the descriptor of `loadClass`, and `MethodHandles.Lookup`.
+std::vector<std::string_view> get_reflective_lookup_names();
+
+// Recovers the targets of the method's `Class.forName`, `ClassLoader.loadClass`,
+// `Class.get[Declared]{Method,Field,Constructor}` and `MethodHandles.Lookup.find*` calls whose
+// class and member names are constants, following the constants through the operand stack and
+// locals in a single pass over the bytecode. Values meeting at a branch target or exception handler
+// are forgotten unless they're in a local that is only ever defined once, parameters being defined
+// on entry, so only targets the lookup can actually be given are reported, in pc order.
+std::vector<reflective_target> find_reflective_targets(const java_class& clazz,
+    const method_info& method, const code_attribute& code);
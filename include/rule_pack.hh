@@ -0,0 +1,214 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "api_rules.hh"
+
+// A rule pack is compiled from a text file with one rule per line, preceded by its category and
+// severity, e.g. `network high java/net/Socket.<init>(Ljava/lang/String;I)V`. `#` starts a comment.
+//
+// The compiled pack is laid out to be mapped and used in place: a header, then a perfect hash over
+// the owners (classes and packages) of the rules, then the owner, rule and category records and
+// finally the strings they point into. Every field is a native-endian `uint32_t` or narrower.
+static constexpr uint32_t RULE_PACK_MAGIC = 0x50525342; // "BSRP"
+static constexpr uint32_t RULE_PACK_VERSION = 1;
+// Marks a slot of the perfect hash that no owner hashes to.
+static constexpr uint32_t RULE_PACK_EMPTY_SLOT = UINT32_MAX;
+// Set in the flags of rules naming a field rather than a method.
+static constexpr uint8_t RULE_PACK_FIELD_RULE = 0x1;
+
+struct rule_pack_header
+{
+    uint32_t magic;
+    uint32_t version;
+    // The first hash of an owner picks a bucket, whose seed then picks its slot.
+    uint32_t bucket_count;
+    uint32_t slot_count;
+    uint32_t owner_count;
+    uint32_t rule_count;
+    uint32_t category_count;
+    uint32_t string_bytes;
+};
+
+struct rule_pack_string
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct rule_pack_owner
+{
+    rule_pack_string name;
+    // The rules of an owner are contiguous.
+    uint32_t first_rule;
+    uint32_t rule_count;
+};
+
+struct rule_pack_rule
+{
+    // Both empty for rules covering every member of the owner. The descriptor is also empty for
+    // field rules matching any type.
+    rule_pack_string name;
+    rule_pack_string descriptor;
+    uint16_t category;
+    uint8_t severity;
+    uint8_t flags;
+};
+
+// Compiles the rule pack source in `source` into `pack`. On failure, `error` says why and on which
+// line.
+bool compile_rule_pack(std::istream& source, std::ostream& pack, std::string& error);
+
+// A compiled rule pack, mapped into memory. Nothing is interned or copied when it is loaded, and
+// finding the rules for a method is a perfect hash lookup per owner or package of the method.
+class rule_pack
+{
+    struct mapping;
+
+    std::unique_ptr<mapping> file;
+    const rule_pack_header* header = nullptr;
+    const uint32_t* seeds = nullptr;
+    const uint32_t* slots = nullptr;
+    const rule_pack_owner* owners = nullptr;
+    const rule_pack_rule* rules = nullptr;
+    const rule_pack_string* categories = nullptr;
+    const char* strings = nullptr;
+
+    rule_pack();
+
+    std::string_view get_string(rule_pack_string str) const
+    {
+        return {strings + str.offset, str.length};
+    }
+
+    // Checks that every count and offset of the pack is in bounds, so lookups needn't.
+    bool validate(size_t size, std::string& error);
+    const rule_pack_owner* find_owner(std::string_view name) const;
+
+    // Calls `cb` with every rule of the owner record of `owner` and of each package containing it.
+    template <typename callback>
+    void for_each_owner_rule(std::string_view owner, callback&& cb) const
+    {
+        // Look up the class itself, then each package containing it.
+        for (size_t package_end = owner.size(); package_end != std::string_view::npos;
+            package_end = package_end ? owner.rfind('/', package_end - 1) : std::string_view::npos)
+        {
+            const bool is_class = package_end == owner.size();
+            const rule_pack_owner* owner_record =
+                find_owner(owner.substr(0, is_class ? package_end : package_end + 1));
+            if (!owner_record)
+            {
+                continue;
+            }
+
+            const rule_pack_rule* first = rules + owner_record->first_rule;
+            std::for_each(first, first + owner_record->rule_count, cb);
+        }
+    }
+
+    rule_match get_match(const rule_pack_rule& rule) const
+    {
+        return rule_match{get_string(categories[rule.category]),
+            static_cast<rule_severity>(rule.severity)};
+    }
+
+public:
+    ~rule_pack();
+
+    // Maps the pack at `path`. On failure, `error` says why.
+    static std::unique_ptr<const rule_pack> load(const std::string& path, std::string& error);
+
+    // Calls `cb` with the name of every class and package the rules of the pack are for.
+    template <typename callback>
+    void for_each_owner_name(callback&& cb) const
+    {
+        for (uint32_t i = 0; i < header->owner_count; i++)
+        {
+            cb(get_string(owners[i].name));
+        }
+    }
+
+    // Calls `cb` with every rule of the pack matching the member `owner.name` with `descriptor`.
+    template <typename callback>
+    void find_matches(std::string_view owner, std::string_view name, bool is_field,
+        std::string_view descriptor, callback&& cb) const
+    {
+        for_each_owner_rule(owner, [&](const rule_pack_rule& rule)
+        {
+            const std::string_view rule_name = get_string(rule.name);
+            const std::string_view rule_descriptor = get_string(rule.descriptor);
+            const bool is_field_rule = (rule.flags & RULE_PACK_FIELD_RULE) != 0;
+            if (rule_name.empty() || (rule_name == name && is_field_rule == is_field &&
+                (rule_descriptor == descriptor || (is_field && rule_descriptor.empty()))))
+            {
+                cb(get_match(rule));
+            }
+        });
+    }
+
+    // Like `find_matches`, for a member whose descriptor isn't known: rules naming it match
+    // whatever their descriptor.
+    template <typename callback>
+    void find_name_matches(std::string_view owner, std::string_view name, bool is_field,
+        callback&& cb) const
+    {
+        for_each_owner_rule(owner, [&](const rule_pack_rule& rule)
+        {
+            const std::string_view rule_name = get_string(rule.name);
+            const bool is_field_rule = (rule.flags & RULE_PACK_FIELD_RULE) != 0;
+            if (rule_name.empty() || (rule_name == name && is_field_rule == is_field))
+            {
+                cb(get_match(rule));
+            }
+        });
+    }
+
+    // Returns whether any rule of the pack covers `class_name`, one of its members or its package.
+    bool has_owner_rules(std::string_view class_name) const
+    {
+        bool found = false;
+        for_each_owner_rule(class_name, [&](const rule_pack_rule&)
+        {
+            found = true;
+        });
+
+        return found;
+    }
+
+    // Calls `cb` with every rule of the pack covering the whole of `class_name` or its package.
+    template <typename callback>
+    void find_class_matches(std::string_view class_name, callback&& cb) const
+    {
+        for_each_owner_rule(class_name, [&](const rule_pack_rule& rule)
+        {
+            if (!rule.name.length)
+            {
+                cb(get_match(rule));
+            }
+        });
+    }
+};
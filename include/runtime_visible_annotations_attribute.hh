@@ -36,5 +36,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_runtime_visible_annotations_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_runtime_visible_annotations_attribute(class_reader& file,
     const constant_pool& cp);
@@ -37,4 +37,4 @@ public:
 };
 
 std::unique_ptr<attribute_info> parse_runtime_visible_parameter_annotations_attribute(
-    std::ifstream& file, const constant_pool& cp);
+    class_reader& file, const constant_pool& cp);
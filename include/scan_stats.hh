@@ -0,0 +1,138 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#include "perf_counters.hh"
+
+// Pipeline phases that time is attributed to. Phases nest (e.g. line resolution happens while
+// walking bytecode), in which case the inner phase's time is excluded from the outer one.
+enum class scan_phase : uint8_t
+{
+    io, prefilter, constant_pool, attributes, bytecode, strings, line_resolution, output
+};
+
+constexpr size_t TOTAL_SCAN_PHASES = static_cast<size_t>(scan_phase::output) + 1;
+
+// The name `phase` is reported under, e.g. "constant pool".
+const char* get_scan_phase_name(scan_phase phase);
+
+enum class scan_counter : uint8_t
+{
+    input_bytes, classes, pool_entries, methods, bytecode_bytes, skipped_methods,
+    prefiltered_classes, findings
+};
+
+constexpr size_t TOTAL_SCAN_COUNTERS = static_cast<size_t>(scan_counter::findings) + 1;
+
+struct phase_times
+{
+    uint64_t wall_ns;
+    uint64_t cpu_ns;
+};
+
+class scan_stats
+{
+    bool enabled = false;
+    std::array<phase_times, TOTAL_SCAN_PHASES> phases{};
+    std::array<uint64_t, TOTAL_SCAN_COUNTERS> counters{};
+    // The phase currently being charged, or `TOTAL_SCAN_PHASES` when outside of any phase.
+    size_t current_phase = TOTAL_SCAN_PHASES;
+    phase_times last_mark{};
+    phase_times run_start{};
+    // Hardware counters are opt-in since reading them costs a syscall per phase transition.
+    perf_counter_group perf;
+    std::array<perf_event_values, TOTAL_SCAN_PHASES> phase_events{};
+    perf_reading last_reading{};
+    // Whether the counters were ever multiplexed during a phase, making its counts estimates.
+    bool perf_multiplexed = false;
+
+    void print_perf_summary(std::ostream& out);
+
+    friend class scoped_scan_phase;
+
+    // Charges everything since the last mark to the current phase and moves the mark forward.
+    void charge_current_phase();
+
+public:
+    static scan_stats& instance();
+
+    void enable();
+    // Opens the per-thread hardware counters. On failure statistics stay enabled without them and
+    // `reason` describes why the counters were unavailable.
+    bool enable_perf_counters(const char*& reason);
+
+    bool is_enabled() const
+    {
+        return enabled;
+    }
+
+    // The phase currently being charged, or `TOTAL_SCAN_PHASES` when outside of any phase.
+    size_t active_phase() const
+    {
+        return current_phase;
+    }
+
+    void add(scan_counter counter, uint64_t amount)
+    {
+        counters[static_cast<size_t>(counter)] += amount;
+    }
+
+    void print_summary(std::ostream& out);
+};
+
+// Attributes the time spent in the enclosing scope to `phase`.
+class scoped_scan_phase
+{
+    size_t previous_phase;
+
+public:
+    explicit scoped_scan_phase(scan_phase phase);
+    ~scoped_scan_phase();
+
+    scoped_scan_phase(const scoped_scan_phase&) = delete;
+    scoped_scan_phase& operator=(const scoped_scan_phase&) = delete;
+};
+
+// Instrumentation is only compiled in when building with `STATS=1` (the default); otherwise these
+// only evaluate their arguments, so that values computed for them aren't left unused, and `--stats`
+// only reports that support is missing.
+#ifdef BYTECODE_SCANNER_STATS
+#define SCAN_STATS_CONCAT_IMPL(a, b) a##b
+#define SCAN_STATS_CONCAT(a, b) SCAN_STATS_CONCAT_IMPL(a, b)
+#define SCAN_PHASE(phase) \
+    scoped_scan_phase SCAN_STATS_CONCAT(scan_phase_guard_, __LINE__){phase}
+#define SCAN_COUNT(counter, amount) \
+    do \
+    { \
+        scan_stats& stats = scan_stats::instance(); \
+        if (stats.is_enabled()) \
+        { \
+            stats.add(counter, amount); \
+        } \
+    } \
+    while (0)
+#else
+#define SCAN_PHASE(phase) do { (void)(phase); } while (0)
+#define SCAN_COUNT(counter, amount) do { (void)(counter); (void)(amount); } while (0)
+#endif
@@ -45,5 +45,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_signature_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_signature_attribute(class_reader& file,
     const constant_pool& cp);
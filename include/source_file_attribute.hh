@@ -40,5 +40,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_source_file_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_source_file_attribute(class_reader& file,
     const constant_pool& cp);
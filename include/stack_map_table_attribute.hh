@@ -19,16 +19,76 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "attribute_info.hh"
 #include "constant_pool.hh"
 #include "util.hh"
 
+enum class verification_type_tag : uint8_t
+{
+    Top = 0, Integer, Float, Double, Long, Null, UninitializedThis, Object, Uninitialized
+};
+
+struct verification_type
+{
+    verification_type_tag tag;
+    // The Class entry of an Object, or the offset of the `new` creating an Uninitialized value.
+    uint16_t data;
+};
+
+enum class stack_map_frame_kind : uint8_t
+{
+    // Every frame but a full frame only gives the locals which differ from the previous frame.
+    same, same_locals_1_stack_item, chop, append, full
+};
+
+// One frame, with its offset delta resolved to the pc it applies to.
+struct stack_map_frame
+{
+    // Malformed frames can point past the end of the code, so this doesn't fit a u2.
+    uint32_t pc;
+    stack_map_frame_kind kind;
+    // The number of locals a chop frame removes.
+    uint8_t chopped_locals;
+    // The locals of a full frame, or those an append frame adds, followed by the stack items.
+    uint16_t local_count;
+    uint16_t stack_count;
+    // Where the locals start in the attribute's `types`.
+    uint32_t first_type;
+};
+
 class stack_map_table_attribute: public attribute_info
 {
+    std::vector<stack_map_frame> frames;
+    // The verification types of every frame, one after another. Long and Double are one entry each,
+    // as in the attribute, even though they take two slots.
+    std::vector<verification_type> types;
+
 public:
-    stack_map_table_attribute() = default;
+    explicit stack_map_table_attribute(std::vector<stack_map_frame> frames,
+        std::vector<verification_type> types) :
+            frames{std::move(frames)},
+            types{std::move(types)}
+    {}
+
+    // The frames in pc order.
+    const std::vector<stack_map_frame>& get_frames() const
+    {
+        return frames;
+    }
+
+    const verification_type* get_locals(const stack_map_frame& frame) const
+    {
+        return types.data() + frame.first_type;
+    }
+
+    const verification_type* get_stack(const stack_map_frame& frame) const
+    {
+        return types.data() + frame.first_type + frame.local_count;
+    }
 
     virtual attribute_info_type get_type() const
     {
@@ -36,5 +96,5 @@ public:
     }
 };
 
-std::unique_ptr<attribute_info> parse_stack_map_table_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_stack_map_table_attribute(class_reader& file,
     const constant_pool& cp);
@@ -0,0 +1,164 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Indicators to look for in string constants, e.g. URLs or shell commands. Each pattern is either
+// a literal, matched anywhere in a string, or a regular expression, and every pattern is compiled
+// into a single NFA so that a string is matched against all of them in one pass.
+//
+// Regular expressions support `.`, `[...]` and `[^...]` classes, the escapes `\d`, `\w`, `\s` and
+// their negations, grouping with `(...)` or `(?:...)`, `|`, `*`, `+`, `?` and `{m,n}`. `^` and `$`
+// anchor a whole pattern to the start and end of the string, and a leading `(?i)` ignores ASCII
+// case.
+class string_pattern_set
+{
+public:
+    struct nfa_state
+    {
+        enum class kind : uint8_t
+        {
+            // Consumes one byte in `bytes` and continues to `out`.
+            bytes,
+            // Continues to both `out` and `out2` without consuming anything.
+            split,
+            // Pattern `pattern` has matched; only at the end of the string if `at_end` is set.
+            match
+        };
+
+        kind type;
+        bool at_end;
+        uint32_t out;
+        uint32_t out2;
+        uint32_t pattern;
+        std::bitset<256> bytes;
+    };
+
+private:
+    std::vector<std::string> names;
+    std::vector<nfa_state> states;
+    // Entered before the first byte of a string only, and before every byte.
+    std::vector<uint32_t> anchored_starts;
+    std::vector<uint32_t> unanchored_starts;
+
+public:
+    // Adds a pattern named `name`, matching `source` either literally or as a regular expression.
+    // Returns false, saying why in `error`, if it is malformed.
+    bool add_pattern(std::string_view name, bool is_regex, std::string_view source,
+        std::string& error);
+
+    // Adds the patterns of a file with one pattern per line: its name, `literal` or `regex` and the
+    // pattern itself, which runs to the end of the line, e.g. `url regex (?i)https?://[^ ]+`.
+    // Lines starting with `#` are comments. On failure, `error` says why and on which line.
+    bool load(std::istream& source, std::string& error);
+
+    bool empty() const
+    {
+        return names.empty();
+    }
+
+    const std::string& get_name(uint32_t pattern) const
+    {
+        return names[pattern];
+    }
+
+    const std::vector<nfa_state>& get_states() const
+    {
+        return states;
+    }
+
+    const std::vector<uint32_t>& get_anchored_starts() const
+    {
+        return anchored_starts;
+    }
+
+    const std::vector<uint32_t>& get_unanchored_starts() const
+    {
+        return unanchored_starts;
+    }
+};
+
+// Matches strings against a pattern set with a DFA built lazily from its NFA: a DFA state is only
+// made, and a transition only computed, the first time a string needs it, so strings mostly cost
+// one table lookup per byte however many patterns there are. Not thread safe; each thread keeps
+// its own matcher.
+class string_matcher
+{
+    struct dfa_state
+    {
+        // Besides those of the base set, which every state has.
+        std::vector<uint32_t> nfa_states;
+        // The patterns matched on reaching the state, and those matched if the string ends there.
+        std::vector<uint32_t> matches;
+        std::vector<uint32_t> end_matches;
+    };
+
+    // Once this many states are cached, the cache is dropped and rebuilt as strings need it.
+    static constexpr size_t MAX_DFA_STATES = 8192;
+    static constexpr uint32_t UNKNOWN_STATE = UINT32_MAX;
+
+    const string_pattern_set& patterns;
+    // Patterns not anchored to the start may begin at any byte, so the states they start from
+    // are part of every DFA state. With thousands of patterns, they are most of each state, so
+    // they are kept apart as the base set and the states they move to on each byte worked out
+    // once.
+    std::vector<bool> in_base;
+    std::array<std::vector<uint32_t>, 256> base_moves;
+    std::vector<uint32_t> base_matches;
+    std::vector<uint32_t> base_end_matches;
+
+    std::vector<dfa_state> states;
+    std::map<std::vector<uint32_t>, uint32_t> state_ids;
+    // The transitions of state `s` are `transitions[s * 256]` onwards.
+    std::vector<uint32_t> transitions;
+    uint32_t start_state = UNKNOWN_STATE;
+    // Bumped whenever the cache is dropped, which invalidates every state id.
+    uint64_t generation = 0;
+    // Reused between steps to avoid allocating.
+    std::vector<uint32_t> work_stack;
+    std::vector<uint32_t> touched;
+    std::vector<bool> visited;
+
+    // Returns the sorted states outside the base set reachable from `seeds` without consuming a
+    // byte.
+    std::vector<uint32_t> get_closure(const std::vector<uint32_t>& seeds);
+    uint32_t get_state(std::vector<uint32_t> nfa_states);
+    uint32_t get_start_state();
+    uint32_t step(uint32_t state, uint8_t byte);
+
+public:
+    explicit string_matcher(const string_pattern_set& patterns);
+
+    const string_pattern_set& get_patterns() const
+    {
+        return patterns;
+    }
+
+    // Sets `matched` to every pattern found in `value`, in ascending order.
+    void match(std::string_view value, std::vector<uint32_t>& matched);
+};
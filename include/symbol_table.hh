@@ -0,0 +1,107 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+// Identifies an interned string. Ids never change for the life of the process, so two symbols are
+// the same string iff their ids are equal. They are dense, but with several threads interning at
+// once the order in which they are handed out is not deterministic.
+using symbol_id = uint32_t;
+
+// Never handed out by the symbol table, so it can stand for the absence of a symbol.
+static constexpr symbol_id NO_SYMBOL = UINT32_MAX;
+
+// The process-wide string interner. Every Utf8 constant of every parsed class is interned, so names
+// such as `java/lang/Object` or `<init>` are stored once however many classes use them, and
+// matching compares ids instead of strings.
+//
+// Parser threads intern concurrently without taking a lock. Strings are found through a chain of
+// open-addressing tables of 64-bit slots, each packing part of the string's hash with its id, which
+// are claimed with a compare-and-swap. Once a table is three quarters full, the empty slot that a
+// new string would have claimed is instead turned into a permanent forwarding marker and the string
+// goes into the next table, twice the size. Everyone who later probes for that string reaches the
+// same marker, so a string can never end up with two ids. Each thread also keeps a small cache of
+// the symbols it interned recently. Once the last table is full, interning throws
+// `std::length_error`.
+class symbol_table
+{
+public:
+    // The first level is 128 KB, so scanning a few classes doesn't cost a large table, and the
+    // last has 2^29 slots.
+    static constexpr size_t MAX_LEVELS = 16;
+    static constexpr size_t FIRST_LEVEL_SLOTS_LOG2 = 14;
+    static constexpr size_t NAME_SEGMENT_SIZE_LOG2 = 16;
+    static constexpr size_t MAX_NAME_SEGMENTS = size_t{1} << (32 - NAME_SEGMENT_SIZE_LOG2);
+
+private:
+    struct level
+    {
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+        size_t mask;
+        // Slots claimed so far; a soft limit, only used to decide when to start forwarding.
+        std::atomic<size_t> used{0};
+
+        explicit level(size_t slots_log2);
+    };
+
+    std::array<std::atomic<level*>, MAX_LEVELS> levels{};
+    // Names are stored by id in fixed-size segments, allocated as ids reach them, so looking one
+    // up never has to wait for a resize.
+    std::array<std::atomic<std::string_view*>, MAX_NAME_SEGMENTS> name_segments{};
+    std::atomic<symbol_id> next_id{0};
+    // The most recently allocated block of name storage; each links to the one before it.
+    std::atomic<char*> name_chunks{nullptr};
+
+    symbol_table() = default;
+    ~symbol_table();
+
+    level& get_level(size_t level_idx);
+    std::string_view* get_name_segment(symbol_id id);
+    // Probes for `name`, adding it if `insert` is set. Returns nothing if it is absent and
+    // `insert` isn't set.
+    std::optional<symbol_id> lookup(std::string_view name, uint64_t hash, bool insert);
+    symbol_id publish(std::string_view name);
+
+public:
+    static symbol_table& instance();
+
+    symbol_table(const symbol_table&) = delete;
+    symbol_table& operator=(const symbol_table&) = delete;
+
+    // Returns the id of `name`, adding it if it is new.
+    symbol_id intern(std::string_view name);
+
+    // Returns the id of `name` without adding it.
+    std::optional<symbol_id> find(std::string_view name);
+
+    // Returns the string of an id previously handed out by `intern`. The view lives as long as the
+    // process.
+    std::string_view get_name(symbol_id id) const;
+
+    size_t size() const
+    {
+        return next_id.load(std::memory_order_acquire);
+    }
+};
@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <functional>
 #include <tuple>
+#include <vector>
 
 #include "invalid_class_format_exception.hh"
 
@@ -43,44 +44,59 @@ inline uint64_t to_little_endian_long(uint64_t n)
         ((n >> 48) & 0xFF) << 8 | ((n >> 56) & 0xFF);
 }
 
+// The `READ_*` macros read a big-endian field from the `class_reader` named `file`. On failure the
+// error is recorded in the reader and the field reads as zero.
 #define READ_U1_FIELD(var, err_msg) \
-    uint8_t var; \
+    uint8_t var = 0; \
     do \
     { \
         constexpr size_t var##_LENGTH = 1; \
         if (!file.read(reinterpret_cast<char*>(&var), var##_LENGTH)) \
         { \
-            throw invalid_class_format{err_msg}; \
+            file.fail(err_msg); \
         } \
     } \
     while (0)
 
 #define READ_U2_FIELD(var, err_msg) \
-    uint16_t var; \
+    uint16_t var = 0; \
     do \
     { \
         constexpr size_t var##_LENGTH = 2; \
         if (!file.read(reinterpret_cast<char*>(&var), var##_LENGTH)) \
         { \
-            throw invalid_class_format{err_msg}; \
+            file.fail(err_msg); \
         } \
         var = to_little_endian_short(var); \
     } \
     while (0)
 
 #define READ_U4_FIELD(var, err_msg) \
-    uint32_t var; \
+    uint32_t var = 0; \
     do \
     { \
         constexpr size_t var##_LENGTH = 4; \
         if (!file.read(reinterpret_cast<char*>(&var), var##_LENGTH)) \
         { \
-            throw invalid_class_format{err_msg}; \
+            file.fail(err_msg); \
         } \
         var = to_little_endian_int(var); \
     } \
     while (0)
 
+// Reads a table of `count` u2 values with a single bulk decode. Tables whose entries are several u2
+// fields wide are read as `count * fields` values and unpacked by the caller.
+#define READ_U2_ARRAY_FIELD(var, count, err_msg) \
+    std::vector<uint16_t> var; \
+    do \
+    { \
+        if (!file.read_u2_array(var, count)) \
+        { \
+            file.fail(err_msg); \
+        } \
+    } \
+    while (0)
+
 template <typename... Ts>
 struct overloaded : Ts...
 {
@@ -90,41 +106,13 @@ struct overloaded : Ts...
 template <typename... Ts>
 overloaded(Ts...) -> overloaded<Ts...>;
 
-template <typename R>
-struct function_args_tuple;
-
-template <typename R, typename ...Args>
-struct function_args_tuple<std::function<R(Args...)>>
-{
-    using type = std::tuple<Args...>;
-};
-
-template <size_t instr_size>
-struct find_instructions_cb_fn_type
-{
-    using type = std::function<void(uint16_t)>;
-};
-
-template <>
-struct find_instructions_cb_fn_type<1>
-{
-    using type = std::function<void(uint16_t, uint8_t)>;
-};
-
-template <>
-struct find_instructions_cb_fn_type<2>
-{
-    using type = std::function<void(uint16_t, uint8_t, uint8_t)>;
-};
-
-template <>
-struct find_instructions_cb_fn_type<3>
-{
-    using type = std::function<void(uint16_t, uint8_t, uint8_t, uint8_t)>;
-};
+// The callback type for instructions whose decoded operands are `operands_tuple`: it receives the
+// pc of the instruction followed by each operand.
+template <typename operands_tuple>
+struct find_instructions_cb_fn_type;
 
-template <>
-struct find_instructions_cb_fn_type<4>
+template <typename... Operands>
+struct find_instructions_cb_fn_type<std::tuple<Operands...>>
 {
-    using type = std::function<void(uint16_t, uint8_t, uint8_t, uint8_t, uint8_t)>;
+    using type = std::function<void(uint16_t, Operands...)>;
 };
@@ -0,0 +1,113 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <queue>
+
+#include "aho_corasick.hh"
+
+// Marks a transition of the trie that no pattern takes, before the failure links fill it in.
+static constexpr uint32_t NO_TRANSITION = UINT32_MAX;
+
+aho_corasick::aho_corasick(const std::vector<std::string_view>& patterns)
+{
+    for (const std::string_view pattern : patterns)
+    {
+        matches_everything = matches_everything || pattern.empty();
+        for (const char c : pattern)
+        {
+            uint16_t& byte_class = byte_classes[static_cast<uint8_t>(c)];
+            if (!byte_class)
+            {
+                byte_class = static_cast<uint16_t>(class_count++);
+            }
+        }
+    }
+
+    // Build the trie of the patterns. A state where a pattern ends needs no transitions of its
+    // own since searching stops there, so longer patterns sharing it as a prefix are cut short.
+    std::vector<bool> accepting(1, false);
+    transitions.assign(class_count, NO_TRANSITION);
+    for (const std::string_view pattern : patterns)
+    {
+        uint32_t state = 0;
+        for (size_t i = 0; i < pattern.size() && !accepting[state]; i++)
+        {
+            const size_t transition = state * class_count +
+                byte_classes[static_cast<uint8_t>(pattern[i])];
+            if (transitions[transition] == NO_TRANSITION)
+            {
+                transitions[transition] = static_cast<uint32_t>(accepting.size());
+                accepting.push_back(false);
+                transitions.resize(transitions.size() + class_count, NO_TRANSITION);
+            }
+
+            state = transitions[transition];
+        }
+
+        accepting[state] = true;
+    }
+
+    // Fill in the missing transitions breadth first: a state without a transition on some byte
+    // continues from where its failure link, the longest proper suffix that is also in the trie,
+    // would. Every state closer to the root has its row complete by then.
+    std::vector<uint32_t> failure(accepting.size(), 0);
+    std::queue<uint32_t> states;
+    for (uint32_t byte_class = 0; byte_class < class_count; byte_class++)
+    {
+        uint32_t& next = transitions[byte_class];
+        if (next == NO_TRANSITION)
+        {
+            next = 0;
+        }
+        else
+        {
+            states.push(next);
+        }
+    }
+
+    while (!states.empty())
+    {
+        const uint32_t state = states.front();
+        states.pop();
+        accepting[state] = accepting[state] || accepting[failure[state]];
+        for (uint32_t byte_class = 0; byte_class < class_count; byte_class++)
+        {
+            uint32_t& next = transitions[state * class_count + byte_class];
+            const uint32_t failure_next = transitions[failure[state] * class_count + byte_class];
+            if (next == NO_TRANSITION)
+            {
+                next = failure_next;
+            }
+            else
+            {
+                failure[next] = failure_next;
+                states.push(next);
+            }
+        }
+    }
+
+    // Tag the transitions into accepting states so searching needn't look the state up.
+    for (uint32_t& next : transitions)
+    {
+        if (accepting[next])
+        {
+            next |= MATCH_BIT;
+        }
+    }
+}
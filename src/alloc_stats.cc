@@ -0,0 +1,379 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+
+#include "alloc_stats.hh"
+
+#ifdef BYTECODE_SCANNER_ALLOC_STATS
+#include <execinfo.h>
+#endif
+
+// Allocations made outside of any phase are charged to this extra slot.
+constexpr size_t UNPHASED_SLOT = TOTAL_SCAN_PHASES;
+constexpr size_t TOTAL_ALLOC_SLOTS = TOTAL_SCAN_PHASES + 1;
+
+// Callers are identified by this many return addresses above `operator new`; the innermost few
+// frames are usually inside the standard library so one frame is not enough to tell sites apart.
+constexpr size_t SITE_FRAMES = 6;
+constexpr size_t SITE_TABLE_SIZE = 4096;
+
+struct alloc_slot
+{
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> peak_live_bytes{0};
+};
+
+static std::atomic<bool> counting{false};
+static std::atomic<bool> counting_sites{false};
+static std::atomic<int64_t> live_bytes{0};
+static std::atomic<int64_t> window_base_live_bytes{0};
+static std::atomic<int64_t> window_peak_live_bytes{0};
+static std::atomic<uint64_t> total_allocations{0};
+static std::atomic<uint64_t> total_bytes{0};
+static std::array<alloc_slot, TOTAL_ALLOC_SLOTS> phase_slots;
+
+#ifdef BYTECODE_SCANNER_ALLOC_STATS
+struct alloc_site
+{
+    std::array<void*, SITE_FRAMES> frames;
+    uint64_t hash;
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// The site table is a fixed open-addressing table so recording a site never allocates.
+static std::array<alloc_site, SITE_TABLE_SIZE> sites;
+static std::atomic_flag sites_lock = ATOMIC_FLAG_INIT;
+static size_t dropped_sites = 0;
+
+static void update_max(std::atomic<int64_t>& target, int64_t value)
+{
+    int64_t current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+        !target.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+static void update_max(std::atomic<uint64_t>& target, uint64_t value)
+{
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+        !target.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+// Kept out of line (as is `counted_allocate`) so the number of frames to skip is fixed.
+[[gnu::noinline]] static void record_site(size_t size)
+{
+    // `backtrace` may allocate the first time it is called (it lazily loads the unwinder), so
+    // guard against recursing back into here.
+    static thread_local bool in_backtrace = false;
+    if (in_backtrace)
+    {
+        return;
+    }
+
+    in_backtrace = true;
+    // Skip the frames of `record_site`, `counted_allocate` and `operator new` themselves.
+    constexpr int SKIPPED_FRAMES = 3;
+    std::array<void*, SITE_FRAMES + SKIPPED_FRAMES> frames{};
+    const int depth = backtrace(frames.data(), static_cast<int>(frames.size()));
+    in_backtrace = false;
+
+    alloc_site site{};
+    uint64_t hash = 1469598103934665603ULL;
+    for (int frame = SKIPPED_FRAMES; frame < depth; frame++)
+    {
+        site.frames[frame - SKIPPED_FRAMES] = frames[frame];
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[frame])) * 1099511628211ULL;
+    }
+
+    while (sites_lock.test_and_set(std::memory_order_acquire));
+    for (size_t probe = 0; probe < SITE_TABLE_SIZE; probe++)
+    {
+        alloc_site& slot = sites[(hash + probe) % SITE_TABLE_SIZE];
+        if (slot.allocations == 0)
+        {
+            slot.frames = site.frames;
+            slot.hash = hash;
+        }
+        else if (slot.hash != hash || slot.frames != site.frames)
+        {
+            continue;
+        }
+
+        slot.allocations++;
+        slot.bytes += size;
+        sites_lock.clear(std::memory_order_release);
+        return;
+    }
+
+    dropped_sites++;
+    sites_lock.clear(std::memory_order_release);
+}
+
+// Every allocation carries a header with its size so `operator delete` can keep the live byte
+// count exact even when the unsized overload is used.
+constexpr size_t ALLOC_HEADER_SIZE = alignof(std::max_align_t);
+
+[[gnu::noinline]] static void* counted_allocate(size_t size)
+{
+    void* block = std::malloc(size + ALLOC_HEADER_SIZE);
+    if (!block)
+    {
+        return nullptr;
+    }
+
+    *static_cast<size_t*>(block) = size;
+    if (counting.load(std::memory_order_relaxed))
+    {
+        size_t slot = scan_stats::instance().active_phase();
+        phase_slots[slot].allocations.fetch_add(1, std::memory_order_relaxed);
+        phase_slots[slot].bytes.fetch_add(size, std::memory_order_relaxed);
+        total_allocations.fetch_add(1, std::memory_order_relaxed);
+        total_bytes.fetch_add(size, std::memory_order_relaxed);
+
+        const int64_t live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        update_max(window_peak_live_bytes, live);
+        update_max(phase_slots[slot].peak_live_bytes, static_cast<uint64_t>(live));
+        if (counting_sites.load(std::memory_order_relaxed))
+        {
+            record_site(size);
+        }
+    }
+    else
+    {
+        // Blocks allocated before counting began are still tagged so they can be told apart
+        // when they are freed.
+        *static_cast<size_t*>(block) = size | (size_t{1} << (sizeof(size_t) * 8 - 1));
+    }
+
+    return static_cast<char*>(block) + ALLOC_HEADER_SIZE;
+}
+
+static void counted_deallocate(void* ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    void* block = static_cast<char*>(ptr) - ALLOC_HEADER_SIZE;
+    const size_t header = *static_cast<size_t*>(block);
+    constexpr size_t UNCOUNTED_BIT = size_t{1} << (sizeof(size_t) * 8 - 1);
+    if (!(header & UNCOUNTED_BIT))
+    {
+        live_bytes.fetch_sub(static_cast<int64_t>(header), std::memory_order_relaxed);
+    }
+
+    std::free(block);
+}
+
+void* operator new(size_t size)
+{
+    if (void* ptr = counted_allocate(size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    counted_deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    counted_deallocate(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    counted_deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    counted_deallocate(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    counted_deallocate(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    counted_deallocate(ptr);
+}
+#endif
+
+alloc_stats& alloc_stats::instance()
+{
+    static alloc_stats stats;
+    return stats;
+}
+
+bool alloc_stats::is_available()
+{
+#ifdef BYTECODE_SCANNER_ALLOC_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void alloc_stats::enable(bool track_sites)
+{
+    counting_sites.store(track_sites && is_available(), std::memory_order_relaxed);
+    counting.store(is_available(), std::memory_order_relaxed);
+}
+
+bool alloc_stats::is_enabled() const
+{
+    return counting.load(std::memory_order_relaxed);
+}
+
+void alloc_stats::begin_class()
+{
+    // Grow the record list before taking the readings so its own bookkeeping is not counted.
+    class_record& record = classes.emplace_back();
+    record.counters.allocations = total_allocations.load(std::memory_order_relaxed);
+    record.counters.bytes = total_bytes.load(std::memory_order_relaxed);
+
+    const int64_t live = live_bytes.load(std::memory_order_relaxed);
+    window_base_live_bytes.store(live, std::memory_order_relaxed);
+    window_peak_live_bytes.store(live, std::memory_order_relaxed);
+}
+
+void alloc_stats::end_class(const std::string& name)
+{
+    if (classes.empty())
+    {
+        return;
+    }
+
+    // Take the readings before naming the record so its own bookkeeping is not counted.
+    const uint64_t allocations = total_allocations.load(std::memory_order_relaxed);
+    const uint64_t bytes = total_bytes.load(std::memory_order_relaxed);
+    const int64_t peak = window_peak_live_bytes.load(std::memory_order_relaxed) -
+        window_base_live_bytes.load(std::memory_order_relaxed);
+
+    class_record& record = classes.back();
+    record.counters.allocations = allocations - record.counters.allocations;
+    record.counters.bytes = bytes - record.counters.bytes;
+    record.counters.peak_live_bytes = static_cast<uint64_t>(std::max<int64_t>(peak, 0));
+    record.name = name;
+}
+
+void alloc_stats::print_sites([[maybe_unused]] std::ostream& out) const
+{
+#ifdef BYTECODE_SCANNER_ALLOC_STATS
+    std::vector<const alloc_site*> used_sites;
+    for (const auto& site : sites)
+    {
+        if (site.allocations)
+        {
+            used_sites.push_back(&site);
+        }
+    }
+
+    std::sort(used_sites.begin(), used_sites.end(), [](const auto* lhs, const auto* rhs)
+    {
+        return lhs->bytes > rhs->bytes;
+    });
+
+    constexpr size_t MAX_PRINTED_SITES = 20;
+    out << "Top allocation sites by bytes:" << std::endl;
+    for (size_t site_idx = 0; site_idx < std::min(used_sites.size(), MAX_PRINTED_SITES); site_idx++)
+    {
+        const alloc_site& site = *used_sites[site_idx];
+        out << '\t' << site.allocations << " allocations, " << site.bytes << " bytes" << std::endl;
+        const int depth = static_cast<int>(std::count_if(site.frames.cbegin(), site.frames.cend(),
+            [](void* frame) { return frame != nullptr; }));
+        char** symbols = backtrace_symbols(site.frames.data(), depth);
+        for (int frame = 0; symbols && frame < depth; frame++)
+        {
+            out << "\t\t" << symbols[frame] << std::endl;
+        }
+
+        std::free(symbols);
+    }
+
+    if (dropped_sites)
+    {
+        out << '\t' << dropped_sites << " allocations from untracked sites (table full)" << std::endl;
+    }
+#endif
+}
+
+void alloc_stats::print_summary(std::ostream& out) const
+{
+    counting.store(false, std::memory_order_relaxed);
+
+    out << "Allocations:" << std::endl;
+    out << '\t' << std::left << std::setw(16) << "phase" << std::right << std::setw(12)
+        << "count" << std::setw(14) << "bytes" << std::setw(14) << "peak live" << std::endl;
+    for (size_t slot = 0; slot < TOTAL_ALLOC_SLOTS; slot++)
+    {
+        const char* slot_name = slot == UNPHASED_SLOT
+            ? "other" : get_scan_phase_name(static_cast<scan_phase>(slot));
+        out << '\t' << std::left << std::setw(16) << slot_name << std::right
+            << std::setw(12) << phase_slots[slot].allocations.load(std::memory_order_relaxed)
+            << std::setw(14) << phase_slots[slot].bytes.load(std::memory_order_relaxed)
+            << std::setw(14) << phase_slots[slot].peak_live_bytes.load(std::memory_order_relaxed)
+            << std::endl;
+    }
+
+    for (const auto& record : classes)
+    {
+        out << '\t' << record.name << ": " << record.counters.allocations << " allocations, "
+            << record.counters.bytes << " bytes, " << record.counters.peak_live_bytes
+            << " bytes peak live" << std::endl;
+    }
+
+    if (counting_sites.load(std::memory_order_relaxed))
+    {
+        print_sites(out);
+    }
+}
@@ -0,0 +1,432 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "api_rules.hh"
+#include "constant_pool.hh"
+#include "member_ref_table.hh"
+#include "method_descriptor.hh"
+#include "rule_pack.hh"
+#include "symbol_table.hh"
+
+static constexpr std::string_view PACKAGE_WILDCARD = "/*";
+static constexpr std::string_view ANY_FIELD_TYPE = "*";
+
+static constexpr const char* rule_severity_names[] = {"none", "low", "medium", "high", "critical"};
+
+std::string normalize_api_rule(std::string_view rule)
+{
+    std::string normalized{rule};
+    std::replace(normalized.begin(), normalized.end(), '.', '/');
+    normalized.erase(std::remove(normalized.begin(), normalized.end(), ' '), normalized.end());
+    return normalized;
+}
+
+std::optional<api_rule_parts> split_api_rule(std::string_view rule)
+{
+    // Method descriptors open with `(`, and field rules separate the type with a `:`.
+    const size_t descriptor_start = rule.find_first_of("(:");
+    if (descriptor_start == std::string_view::npos)
+    {
+        const bool is_package = rule.size() > PACKAGE_WILDCARD.size() &&
+            rule.substr(rule.size() - PACKAGE_WILDCARD.size()) == PACKAGE_WILDCARD;
+        if (rule.empty() || (!is_package && rule.find('*') != std::string_view::npos))
+        {
+            return std::nullopt;
+        }
+
+        // A last segment such as `exec` or `<init>` names a member whose descriptor was left out,
+        // rather than a class, which would otherwise never match.
+        const std::string_view last_segment = rule.substr(rule.find_last_of('/') + 1);
+        if (!is_package && !last_segment.empty() &&
+            (std::islower(static_cast<unsigned char>(last_segment[0])) || last_segment[0] == '<'))
+        {
+            return std::nullopt;
+        }
+
+        // Package rules keep their trailing `/` so `java/net` doesn't match `java/network`.
+        return api_rule_parts{is_package ? rule.substr(0, rule.size() - 1) : rule, is_package, {},
+            false, {}};
+    }
+
+    // The method name follows the last separator before the descriptor. `.` and `/` are both
+    // accepted since names given as `java.io.File.<init>` have every `.` turned into a `/`.
+    const size_t name_start = rule.find_last_of("./", descriptor_start) + 1;
+    if (name_start == 0 || name_start == 1 || name_start == descriptor_start)
+    {
+        return std::nullopt;
+    }
+
+    const bool is_field = rule[descriptor_start] == ':';
+    std::string_view descriptor = rule.substr(descriptor_start + (is_field ? 1 : 0));
+    if (is_field && descriptor == ANY_FIELD_TYPE)
+    {
+        descriptor = {};
+    }
+    else if (is_field ? !is_valid_field_descriptor(descriptor) : !parse_method_descriptor(descriptor))
+    {
+        return std::nullopt;
+    }
+
+    return api_rule_parts{rule.substr(0, name_start - 1), false,
+        rule.substr(name_start, descriptor_start - name_start), is_field, descriptor};
+}
+
+const char* get_rule_severity_name(rule_severity severity)
+{
+    return rule_severity_names[static_cast<size_t>(severity)];
+}
+
+std::optional<rule_severity> parse_rule_severity(std::string_view name)
+{
+    for (size_t i = 0; i < std::size(rule_severity_names); i++)
+    {
+        if (name == rule_severity_names[i])
+        {
+            return static_cast<rule_severity>(i);
+        }
+    }
+
+    return std::nullopt;
+}
+
+std::vector<rule_match> compiled_api_rules::get_matches(constant_pool_entry_id index) const
+{
+    if (!is_match(index))
+    {
+        return {};
+    }
+
+    return {matches.cbegin() + match_offsets[index], matches.cbegin() + match_offsets[index + 1]};
+}
+
+api_rule_set::api_rule_set() = default;
+api_rule_set::~api_rule_set() = default;
+
+bool api_rule_set::add_rule(std::string_view rule)
+{
+    const auto parts = split_api_rule(rule);
+    if (!parts)
+    {
+        return false;
+    }
+
+    symbol_table& symbols = symbol_table::instance();
+    api_rule interned_rule{symbols.intern(parts->owner), parts->is_package, std::nullopt,
+        parts->is_field, std::nullopt};
+    if (!parts->name.empty())
+    {
+        interned_rule.name = symbols.intern(parts->name);
+    }
+
+    if (!parts->descriptor.empty())
+    {
+        interned_rule.descriptor = symbols.intern(parts->descriptor);
+    }
+
+    rules.push_back(interned_rule);
+    return true;
+}
+
+void api_rule_set::set_rule_pack(std::unique_ptr<const rule_pack> rules_pack)
+{
+    pack = std::move(rules_pack);
+}
+
+void api_rule_set::build_prefilter(const std::vector<std::string_view>& extra_names)
+{
+    std::vector<std::string_view> owners = extra_names;
+    const symbol_table& symbols = symbol_table::instance();
+    for (const api_rule& rule : rules)
+    {
+        owners.push_back(symbols.get_name(rule.owner));
+    }
+
+    if (pack)
+    {
+        pack->for_each_owner_name([&](std::string_view owner)
+        {
+            owners.push_back(owner);
+        });
+    }
+
+    // Modified UTF-8 encodes NUL and supplementary characters differently from UTF-8, so a class
+    // whose name has either can't be found by its bytes; an empty pattern lets every class through.
+    for (std::string_view& owner : owners)
+    {
+        if (std::any_of(owner.begin(), owner.end(), [](char c)
+            {
+                return c == '\0' || static_cast<uint8_t>(c) >= 0xF0;
+            }))
+        {
+            owner = {};
+        }
+    }
+
+    owner_search = aho_corasick{owners};
+    has_owner_search = true;
+}
+
+// Returns the class an array or class type refers to, e.g. `java/net/Socket` for both
+// `Ljava/net/Socket;` and `[[Ljava/net/Socket;`, or nothing for primitive types.
+static std::optional<std::string_view> get_referenced_class(std::string_view type)
+{
+    const size_t element_start = type.find_first_not_of('[');
+    if (element_start == std::string_view::npos || type[element_start] != 'L' ||
+        type.back() != ';')
+    {
+        return std::nullopt;
+    }
+
+    return type.substr(element_start + 1, type.size() - element_start - 2);
+}
+
+bool api_rule_set::matches_class_rule(const api_rule& rule, std::string_view class_name) const
+{
+    const std::string_view owner = symbol_table::instance().get_name(rule.owner);
+    return rule.is_package ? class_name.substr(0, owner.size()) == owner : class_name == owner;
+}
+
+void api_rule_set::match_member(const resolved_member_ref& member_ref,
+    std::vector<rule_match>& out) const
+{
+    const bool is_field = member_ref.type == constant_pool_type::FieldRef;
+    const bool matches_cli_rule = std::any_of(rules.cbegin(), rules.cend(),
+        [&](const api_rule& rule)
+    {
+        if (rule.is_package)
+        {
+            return matches_class_rule(rule, member_ref.owner);
+        }
+
+        if (rule.owner != member_ref.owner_symbol)
+        {
+            return false;
+        }
+
+        // A rule naming a method never matches a field of the same name, and vice versa.
+        return !rule.name || (*rule.name == member_ref.name_symbol && rule.is_field == is_field &&
+            (!rule.descriptor || *rule.descriptor == member_ref.descriptor_symbol));
+    });
+    if (matches_cli_rule)
+    {
+        out.push_back(rule_match{{}, rule_severity::none});
+    }
+
+    if (pack)
+    {
+        pack->find_matches(member_ref.owner, member_ref.name, is_field, member_ref.descriptor,
+            [&](const rule_match& match)
+        {
+            out.push_back(match);
+        });
+    }
+}
+
+void api_rule_set::match_class(std::string_view class_name, std::vector<rule_match>& out) const
+{
+    // Only rules covering a whole class or package say anything about uses of the type itself.
+    const bool matches_cli_rule = std::any_of(rules.cbegin(), rules.cend(),
+        [&](const api_rule& rule)
+    {
+        return !rule.name && matches_class_rule(rule, class_name);
+    });
+    if (matches_cli_rule)
+    {
+        out.push_back(rule_match{{}, rule_severity::none});
+    }
+
+    if (pack)
+    {
+        pack->find_class_matches(class_name, [&](const rule_match& match)
+        {
+            out.push_back(match);
+        });
+    }
+}
+
+compiled_api_rules api_rule_set::compile(const constant_pool& cp,
+    const member_ref_table& member_refs) const
+{
+    compiled_api_rules compiled;
+    compiled.match_offsets.reserve(member_refs.size() + 1);
+    for (size_t index = 0; index < member_refs.size(); index++)
+    {
+        const auto entry_id = static_cast<constant_pool_entry_id>(index);
+        const size_t first_match = compiled.matches.size();
+        compiled.match_offsets.push_back(static_cast<uint32_t>(first_match));
+        if (const resolved_member_ref* member_ref = member_refs.find(entry_id))
+        {
+            match_member(*member_ref, compiled.matches);
+            compiled.matches_members |= compiled.matches.size() != first_match;
+            continue;
+        }
+
+        // Class, MethodType and MethodHandle entries can be used by instructions, and malformed
+        // classes can point anywhere, so each link is checked.
+        if (const auto* class_ref = cp.find_entry_as<cp_class_info_entry>(entry_id,
+            constant_pool_type::Class))
+        {
+            const auto* class_name = cp.find_entry_as<cp_utf8_entry>(class_ref->cp_index,
+                constant_pool_type::Utf8);
+            if (class_name && !class_name->value.empty())
+            {
+                // Array classes are named by their descriptor.
+                const auto element_class = class_name->value.front() == '['
+                    ? get_referenced_class(class_name->value) : class_name->value;
+                if (element_class)
+                {
+                    match_class(*element_class, compiled.matches);
+                }
+            }
+        }
+        else if (const auto* method_type = cp.find_entry_as<cp_methodtype_info_entry>(entry_id,
+            constant_pool_type::MethodType))
+        {
+            const auto* descriptor = cp.find_entry_as<cp_utf8_entry>(method_type->cp_index,
+                constant_pool_type::Utf8);
+            const auto parsed_descriptor = descriptor
+                ? parse_method_descriptor(descriptor->value) : std::nullopt;
+            if (parsed_descriptor)
+            {
+                std::vector<symbol_id> types = parsed_descriptor->parameter_types;
+                types.push_back(parsed_descriptor->return_type);
+                std::sort(types.begin(), types.end());
+                types.erase(std::unique(types.begin(), types.end()), types.end());
+                for (const symbol_id type : types)
+                {
+                    if (const auto type_class = get_referenced_class(
+                        symbol_table::instance().get_name(type)))
+                    {
+                        match_class(*type_class, compiled.matches);
+                    }
+                }
+            }
+        }
+        else if (const auto* method_handle = cp.find_entry_as<cp_methodhandle_info_entry>(
+            entry_id, constant_pool_type::MethodHandle))
+        {
+            if (const resolved_member_ref* member_ref =
+                member_refs.find(method_handle->reference_index))
+            {
+                match_member(*member_ref, compiled.matches);
+            }
+        }
+
+        compiled.matches_types |= compiled.matches.size() != first_match;
+    }
+
+    compiled.match_offsets.push_back(static_cast<uint32_t>(compiled.matches.size()));
+    return compiled;
+}
+
+std::vector<rule_match> api_rule_set::match_reflective_target(std::string_view owner,
+    std::string_view name, bool is_field) const
+{
+    std::vector<rule_match> matches;
+    if (owner.empty())
+    {
+        return matches;
+    }
+
+    if (name.empty())
+    {
+        // Classes loaded by name can be arrays, named by their descriptor.
+        if (const auto element_class = owner.front() == '[' ? get_referenced_class(owner) : owner)
+        {
+            match_class(*element_class, matches);
+        }
+
+        return matches;
+    }
+
+    const symbol_table& symbols = symbol_table::instance();
+    const bool matches_cli_rule = std::any_of(rules.cbegin(), rules.cend(),
+        [&](const api_rule& rule)
+    {
+        if (rule.is_package)
+        {
+            return matches_class_rule(rule, owner);
+        }
+
+        return symbols.get_name(rule.owner) == owner && (!rule.name ||
+            (symbols.get_name(*rule.name) == name && rule.is_field == is_field));
+    });
+    if (matches_cli_rule)
+    {
+        matches.push_back(rule_match{{}, rule_severity::none});
+    }
+
+    if (pack)
+    {
+        pack->find_name_matches(owner, name, is_field, [&](const rule_match& match)
+        {
+            matches.push_back(match);
+        });
+    }
+
+    return matches;
+}
+
+bool api_rule_set::has_owner_rules(std::string_view class_name) const
+{
+    return std::any_of(rules.cbegin(), rules.cend(), [&](const api_rule& rule)
+        {
+            return matches_class_rule(rule, class_name);
+        }) || (pack && pack->has_owner_rules(class_name));
+}
+
+std::vector<rule_match> api_rule_set::match_receiver_call(std::string_view owner,
+    std::string_view name, std::string_view descriptor) const
+{
+    std::vector<rule_match> matches;
+    const symbol_table& symbols = symbol_table::instance();
+    const bool matches_cli_rule = std::any_of(rules.cbegin(), rules.cend(),
+        [&](const api_rule& rule)
+    {
+        if (!matches_class_rule(rule, owner))
+        {
+            return false;
+        }
+
+        return rule.is_package || !rule.name || (symbols.get_name(*rule.name) == name &&
+            !rule.is_field &&
+            (!rule.descriptor || symbols.get_name(*rule.descriptor) == descriptor));
+    });
+    if (matches_cli_rule)
+    {
+        matches.push_back(rule_match{{}, rule_severity::none});
+    }
+
+    if (pack)
+    {
+        pack->find_matches(owner, name, false, descriptor, [&](const rule_match& match)
+        {
+            matches.push_back(match);
+        });
+    }
+
+    return matches;
+}
@@ -0,0 +1,289 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "argument_origins.hh"
+#include "bytecode.hh"
+#include "bytecode_analysis.hh"
+#include "code_attribute.hh"
+#include "java_class.hh"
+#include "member_ref_table.hh"
+#include "method_info.hh"
+
+static constexpr const char* argument_origin_names[] = {"unknown", "constant", "parameter", "call"};
+
+const char* get_argument_origin_name(argument_origin origin)
+{
+    return argument_origin_names[static_cast<size_t>(origin)];
+}
+
+// The stack effect of an invoke, and where each of its parameters starts among its argument slots.
+struct call_arguments
+{
+    method_slots slots;
+    std::vector<uint32_t> parameter_offsets;
+};
+
+// Steps through one method in pc order, keeping the origin of each stack slot and local, and reads
+// off those of the arguments at each call of interest. Each instruction is stepped through once and
+// each descriptor read once, so the method takes time linear in its length.
+class argument_origin_pass
+{
+    const java_class& clazz;
+    const code_attribute& code;
+    const uint8_t* bytecode;
+    const std::vector<uint16_t>& call_pcs;
+    abstract_frame<argument_origin> frame;
+    // The invokes decoded so far by constant pool index, doubled and set apart by whether they are
+    // `invokedynamic`.
+    std::unordered_map<uint32_t, call_arguments> invokes;
+    std::vector<std::vector<argument_origin>> origins;
+    size_t next_call = 0;
+    bool malformed = false;
+
+    // Pushes a value taking `slots` stack slots, whose origin is kept in the first.
+    void push(argument_origin origin, uint32_t slots)
+    {
+        frame.stack.push(origin);
+        frame.stack.push_unknown(slots - 1);
+    }
+
+    argument_origin pop(uint32_t slots)
+    {
+        const argument_origin* value = frame.stack.top(slots);
+        const argument_origin origin = value ? value[0] : argument_origin::unknown;
+        frame.stack.pop(slots);
+        return origin;
+    }
+
+    // Marks the locals holding parameters, which hold the value passed in until the method stores
+    // to them.
+    bool enter_method()
+    {
+        if (frame.has_malformed_descriptor())
+        {
+            return false;
+        }
+
+        for (const uint32_t local : frame.get_parameter_locals())
+        {
+            frame.store_local(local, argument_origin::parameter, false);
+        }
+
+        return true;
+    }
+
+    const call_arguments* get_call_arguments(bytecode_tag instr, constant_pool_entry_id cp_index)
+    {
+        const bool is_dynamic = instr == bytecode_tag::INVOKEDYNAMIC;
+        const uint32_t key = static_cast<uint32_t>(cp_index) * 2 + (is_dynamic ? 1 : 0);
+        if (const auto cached = invokes.find(key); cached != invokes.end())
+        {
+            return &cached->second;
+        }
+
+        call_arguments arguments;
+        const auto target = resolve_invoke(clazz, instr, cp_index);
+        const auto slots = target
+            ? get_method_slots(target->descriptor, &arguments.parameter_offsets) : std::nullopt;
+        if (!slots)
+        {
+            return nullptr;
+        }
+
+        arguments.slots = *slots;
+        return &invokes.emplace(key, std::move(arguments)).first->second;
+    }
+
+    void step_invoke(uint16_t pc, bytecode_tag instr)
+    {
+        const call_arguments* arguments =
+            get_call_arguments(instr, read_u2_operand(&bytecode[pc + 1]));
+        if (!arguments)
+        {
+            malformed = true;
+            return;
+        }
+
+        const bool has_receiver = instr != bytecode_tag::INVOKESTATIC &&
+            instr != bytecode_tag::INVOKEDYNAMIC;
+        const size_t argument_slots = arguments->slots.arguments + (has_receiver ? 1 : 0);
+        for (; next_call < call_pcs.size() && call_pcs[next_call] == pc; next_call++)
+        {
+            // Arguments pushed before the last join are unknown.
+            const argument_origin* values = frame.stack.top(argument_slots);
+            std::vector<argument_origin>& call_origins = origins[next_call];
+            for (const uint32_t offset : arguments->parameter_offsets)
+            {
+                call_origins.push_back(values ? values[(has_receiver ? 1 : 0) + offset]
+                    : argument_origin::unknown);
+            }
+        }
+
+        frame.stack.pop(argument_slots);
+        if (arguments->slots.result)
+        {
+            push(argument_origin::call_result, arguments->slots.result);
+        }
+    }
+
+    void step_field_access(uint16_t pc, bytecode_tag instr)
+    {
+        const resolved_member_ref* member_ref =
+            clazz.get_class_member_refs().find(read_u2_operand(&bytecode[pc + 1]));
+        if (!member_ref || member_ref->type != constant_pool_type::FieldRef ||
+            member_ref->descriptor.empty())
+        {
+            malformed = true;
+            return;
+        }
+
+        const uint32_t value_slots = get_type_slots(member_ref->descriptor.front());
+        const bool is_static = instr == bytecode_tag::GETSTATIC ||
+            instr == bytecode_tag::PUTSTATIC;
+        const bool is_get = instr == bytecode_tag::GETSTATIC || instr == bytecode_tag::GETFIELD;
+        frame.stack.pop((is_static ? 0 : 1) + (is_get ? 0 : value_slots));
+        frame.stack.push_unknown(is_get ? value_slots : 0);
+    }
+
+    void step(uint16_t pc)
+    {
+        if (const auto access = decode_local_access(bytecode, pc))
+        {
+            const uint32_t value_slots = access->is_wide_value() ? 2 : 1;
+            if (access->instruction == bytecode_tag::IINC)
+            {
+                frame.store_local(access->local, argument_origin::unknown, false);
+            }
+            else if (access->is_store())
+            {
+                frame.store_local(access->local, pop(value_slots), access->is_wide_value());
+            }
+            else
+            {
+                push(frame.get_local(access->local), value_slots);
+            }
+
+            return;
+        }
+
+        const auto instr = static_cast<bytecode_tag>(bytecode[pc]);
+        if (step_stack_permutation(frame.stack, instr))
+        {
+            return;
+        }
+
+        switch (instr)
+        {
+            case bytecode_tag::LCONST_0:
+            case bytecode_tag::LCONST_1:
+            case bytecode_tag::DCONST_0:
+            case bytecode_tag::DCONST_1:
+            case bytecode_tag::LDC2_W:
+                push(argument_origin::constant, 2);
+                return;
+            case bytecode_tag::CHECKCAST:
+            case bytecode_tag::WIDE:
+                // The cast value is the same reference, and only `wide ret` is left.
+                return;
+            case bytecode_tag::GETSTATIC:
+            case bytecode_tag::PUTSTATIC:
+            case bytecode_tag::GETFIELD:
+            case bytecode_tag::PUTFIELD:
+                step_field_access(pc, instr);
+                return;
+            case bytecode_tag::INVOKEVIRTUAL:
+            case bytecode_tag::INVOKESPECIAL:
+            case bytecode_tag::INVOKESTATIC:
+            case bytecode_tag::INVOKEINTERFACE:
+            case bytecode_tag::INVOKEDYNAMIC:
+                step_invoke(pc, instr);
+                return;
+            case bytecode_tag::MULTIANEWARRAY:
+                frame.stack.pop(bytecode[pc + 3]);
+                frame.stack.push_unknown(1);
+                return;
+            default:
+                break;
+        }
+
+        // Every other constant takes one slot.
+        if (instr >= bytecode_tag::ACONST_NULL && instr <= bytecode_tag::LDC_W)
+        {
+            push(argument_origin::constant, 1);
+            return;
+        }
+
+        const opcode_descriptor& descriptor = get_opcode_descriptor(instr);
+        frame.stack.pop(descriptor.stack_pops);
+        // A subroutine starts with the return address pushed, and pops it before returning past
+        // the `jsr`.
+        const bool is_jsr = instr == bytecode_tag::JSR || instr == bytecode_tag::JSR_W;
+        for_each_branch_target(bytecode, pc, [&](int64_t target)
+        {
+            frame.add_branch(pc, target, frame.stack.depth() + (is_jsr ? 1 : 0));
+        });
+
+        frame.stack.push_unknown(is_jsr ? 0 : descriptor.stack_pushes);
+    }
+
+public:
+    argument_origin_pass(const java_class& clazz, const method_info& method,
+        const code_attribute& code, const std::vector<uint16_t>& call_pcs) :
+            clazz{clazz},
+            code{code},
+            bytecode{code.get_bytecode()},
+            call_pcs{call_pcs},
+            frame{method, code},
+            origins(call_pcs.size())
+    {}
+
+    std::vector<std::vector<argument_origin>> run()
+    {
+        if (!enter_method())
+        {
+            return std::move(origins);
+        }
+
+        bool falls_through = true;
+        for (const uint16_t pc : code.get_instruction_index())
+        {
+            frame.enter_instruction(pc, falls_through);
+            step(pc);
+            // Nothing past an instruction referring to the wrong kind of entry can be trusted.
+            if (malformed || next_call == call_pcs.size())
+            {
+                break;
+            }
+
+            falls_through = can_fall_through(bytecode, pc);
+        }
+
+        return std::move(origins);
+    }
+};
+
+std::vector<std::vector<argument_origin>> find_argument_origins(const java_class& clazz,
+    const method_info& method, const code_attribute& code, const std::vector<uint16_t>& call_pcs)
+{
+    return argument_origin_pass{clazz, method, code, call_pcs}.run();
+}
@@ -24,7 +24,7 @@
 #include "constant_pool.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_annotation_default_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_annotation_default_attribute(class_reader& file,
     const constant_pool& cp)
 {
     skip_element_value_field(file);
@@ -25,7 +25,7 @@
 #include "constant_pool.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_bootstrap_methods_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_bootstrap_methods_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(num_bootstrap_methods, "Failed to parse number of bootstrap methods of "
@@ -37,13 +37,8 @@ std::unique_ptr<attribute_info> parse_bootstrap_methods_attribute(std::ifstream&
             "BootstrapMethods attribute.");
         READ_U2_FIELD(num_bootstrap_arguments, "Failed to parse number of bootstrap arguments of "
             "BootstrapMethods attribute.");
-        std::vector<uint16_t> bootstrap_arguments;
-        for (uint16_t curr_ba_idx = 0; curr_ba_idx < num_bootstrap_arguments; curr_ba_idx++)
-        {
-            READ_U2_FIELD(bootstrap_argument, "Failed to parse bootstrap argument of "
-                "BootstrapMethods attribute.");
-            bootstrap_arguments.push_back(bootstrap_argument);
-        }
+        READ_U2_ARRAY_FIELD(bootstrap_arguments, num_bootstrap_arguments, "Failed to parse "
+            "bootstrap arguments of BootstrapMethods attribute.");
 
         bootstrap_methods.emplace_back(bootstrap_method_ref, std::move(bootstrap_arguments));
     }
@@ -17,110 +17,105 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#include <fstream>
 #include <iomanip>
 #include <memory>
 #include <vector>
 
+#include "byte_search.hh"
+#include "class_reader.hh"
 #include "code_attribute.hh"
+#include "scan_stats.hh"
 
-void code_attribute::print_code(std::ostream& out) const
+bool code_attribute::may_contain_member_access() const
 {
-    for (uint32_t pc = 0; pc < code_length;)
-    {
-        const bytecode_tag curr_instr = static_cast<bytecode_tag>(bytecode[pc]);
-        const size_t curr_instr_size = get_instruction_size(curr_instr);
+    // The field access and `invoke*` opcodes are contiguous, from `getstatic` (0xB2) to
+    // `invokedynamic` (0xBA).
+    return contains_byte_in_range(bytecode.get(), code_length,
+        static_cast<uint8_t>(bytecode_tag::GETSTATIC),
+        static_cast<uint8_t>(bytecode_tag::INVOKEDYNAMIC));
+}
 
-        out << std::right << pc << ": " << std::left << get_instruction_name(curr_instr);
-        // These are variable-sized instructions and require special parsing.
-        if (curr_instr == bytecode_tag::LOOKUPSWITCH ||
-            curr_instr == bytecode_tag::TABLESWITCH)
-        {
-            // Skip past padding bytes until we get to the first address that is a multiple of 4.
-            if (pc % 4 != 0)
-            {
-                for (; pc % 4 != 0; pc++);
-            }
+bool code_attribute::may_contain_type_use() const
+{
+    return contains_byte_in_range(bytecode.get(), code_length,
+            static_cast<uint8_t>(bytecode_tag::NEW),
+            static_cast<uint8_t>(bytecode_tag::MULTIANEWARRAY)) ||
+        contains_byte_in_range(bytecode.get(), code_length,
+            static_cast<uint8_t>(bytecode_tag::LDC), static_cast<uint8_t>(bytecode_tag::LDC_W));
+}
 
-            // Skip `default` bytes.
-            pc += 4;
-            if (curr_instr == bytecode_tag::LOOKUPSWITCH)
-            {
-                // `npairs` is a signed 4-byte, big-endian integer. This should probably never
-                // be negative.
-                uint32_t* npairs_bytes = reinterpret_cast<uint32_t*>(&bytecode[pc]);
-                uint32_t npairs = to_little_endian_int(*npairs_bytes);
-                // Each pair consists of two 4-byte ints.
-                pc += 8 * npairs;
-            }
-            else if (curr_instr == bytecode_tag::TABLESWITCH)
-            {
-                // Read both `low` and `high` signed ints. These should probably never be
-                // negative.
-                uint32_t* low_bytes = reinterpret_cast<uint32_t*>(&bytecode[pc]);
-                uint32_t low = to_little_endian_int(*low_bytes);
-                pc += 4;
+const instruction_index& code_attribute::get_instruction_index() const
+{
+    if (!instructions)
+    {
+        instructions.emplace(bytecode.get(), code_length);
+    }
 
-                uint32_t* high_bytes = reinterpret_cast<uint32_t*>(&bytecode[pc]);
-                uint32_t high = to_little_endian_int(*high_bytes);
-                // There are `high - low + 1` signed integer offsets that must be skipped.
-                pc += 4 * (high - low + 1 + 1);
-            }
+    return *instructions;
+}
 
-            out << std::endl;
-            continue;
-        }
+void code_attribute::print_code(std::ostream& out) const
+{
+    const instruction_index& instructions = get_instruction_index();
+    for (const uint16_t pc : instructions)
+    {
+        const bytecode_tag curr_instr = static_cast<bytecode_tag>(bytecode[pc]);
+        out << std::right << pc << ": " << std::left << get_instruction_name(curr_instr);
 
-        // Instructions with an operand that references the constant pool.
-        if (curr_instr == bytecode_tag::GETSTATIC ||
-            curr_instr == bytecode_tag::PUTSTATIC ||
-            curr_instr == bytecode_tag::GETFIELD ||
-            curr_instr == bytecode_tag::PUTFIELD ||
-            curr_instr == bytecode_tag::LDC_W ||
-            curr_instr == bytecode_tag::LDC2_W ||
-            curr_instr == bytecode_tag::INVOKEVIRTUAL ||
-            curr_instr == bytecode_tag::INVOKESPECIAL ||
-            curr_instr == bytecode_tag::INVOKESTATIC ||
-            curr_instr == bytecode_tag::INVOKEINTERFACE ||
-            curr_instr == bytecode_tag::NEW ||
-            curr_instr == bytecode_tag::CHECKCAST ||
-            curr_instr == bytecode_tag::INSTANCEOF ||
-            curr_instr == bytecode_tag::ANEWARRAY ||
-            curr_instr == bytecode_tag::MULTIANEWARRAY)
+        // Instructions whose first operand references the constant pool.
+        const operand_kind first_operand = get_opcode_descriptor(curr_instr).operands[0];
+        if (get_opcode_descriptor(curr_instr).operand_count &&
+            (first_operand == operand_kind::cp_index_u1 ||
+                first_operand == operand_kind::cp_index_u2))
         {
-            uint8_t* index1 = reinterpret_cast<uint8_t*>(&bytecode[pc + 1]);
-            uint8_t* index2 = reinterpret_cast<uint8_t*>(&bytecode[pc + 2]);
-            constant_pool_entry_id cp_index = (*index1 << 8) | *index2;
+            constant_pool_entry_id cp_index = get_operand_size(first_operand) == 1
+                ? bytecode[pc + 1]
+                : (bytecode[pc + 1] << 8) | bytecode[pc + 2];
             out << '\t' << "#" << cp_index << "// ";
         }
 
-        pc += curr_instr_size;
         out << std::endl;
     }
+
+    if (const auto& malformed_pc = instructions.get_malformed_pc(); malformed_pc)
+    {
+        out << std::right << *malformed_pc << ": <malformed>" << std::endl;
+    }
 }
 
-std::unique_ptr<attribute_info> parse_code_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_code_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(max_stack, "Failed to parse max stack count of Code attribute.");
     READ_U2_FIELD(max_locals, "Failed to parse max local count of Code attribute.");
     READ_U4_FIELD(code_length, "Failed to parse code length of Code attribute.");
+    // The JVM spec limits methods to 64KiB of bytecode. Checking against the remaining input also
+    // keeps a forged length from causing a huge allocation.
+    if (code_length == 0 || code_length > 0xFFFF || code_length > file.remaining())
+    {
+        file.fail("Invalid code length of Code attribute.");
+        return nullptr;
+    }
+
+    SCAN_COUNT(scan_counter::bytecode_bytes, code_length);
     auto bytecode = std::make_unique<uint8_t[]>(code_length);
     if (!file.read(reinterpret_cast<char*>(bytecode.get()), code_length))
     {
-        throw invalid_class_format{"Failed to parse bytecode of Code attribute."};
+        file.fail("Failed to parse bytecode of Code attribute.");
+        return nullptr;
     }
 
     READ_U2_FIELD(exception_table_length, "Failed to parse exception table length of Code "
         "attribute.");
+    constexpr size_t EXCEPTION_TABLE_ENTRY_FIELDS = 4;
+    READ_U2_ARRAY_FIELD(fields, exception_table_length * EXCEPTION_TABLE_ENTRY_FIELDS, "Failed to "
+        "parse exception table of Code attribute.");
     std::vector<exception_table_entry> exception_table;
-    for (uint16_t curr_et_idx = 0; curr_et_idx < exception_table_length; curr_et_idx++)
+    exception_table.reserve(exception_table_length);
+    for (size_t field_idx = 0; field_idx < fields.size(); field_idx += EXCEPTION_TABLE_ENTRY_FIELDS)
     {
-        READ_U2_FIELD(start_pc, "Failed to parse start pc of Code attribute.");
-        READ_U2_FIELD(end_pc, "Failed to parse end pc of Code attribute.");
-        READ_U2_FIELD(handler_pc, "Failed to parse handler pc of Code attribute.");
-        READ_U2_FIELD(catch_pc, "Failed to parse catch pc of Code attribute.");
-        exception_table.emplace_back(start_pc, end_pc, handler_pc, catch_pc);
+        exception_table.emplace_back(fields[field_idx], fields[field_idx + 1],
+            fields[field_idx + 2], fields[field_idx + 3]);
     }
 
     return std::make_unique<code_attribute>(cp, max_stack, max_locals, code_length,
@@ -24,7 +24,7 @@
 #include "constant_value_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_constant_value_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_constant_value_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(constantvalue_index, "Failed to parse constant value of ConstantValue "
@@ -24,7 +24,7 @@
 #include "deprecated_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_deprecated_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_deprecated_attribute(class_reader& file,
     const constant_pool& cp)
 {
     return std::make_unique<deprecated_attribute>();
@@ -25,7 +25,7 @@
 #include "enclosing_method_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_enclosing_method_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_enclosing_method_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(class_index, "Failed to parse class index of EnclosingMethod attribute.");
@@ -25,16 +25,12 @@
 #include "exceptions_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_exceptions_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_exceptions_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(number_of_exceptions, "Failed to parse line number of exceptions of method.");
-    std::vector<constant_pool_entry_id> exception_index_table;
-    for (uint16_t curr_et_idx = 0; curr_et_idx < number_of_exceptions; curr_et_idx++)
-    {
-        READ_U2_FIELD(exception_table_entry, "Failed to parse exception table entry of method.");
-        exception_index_table.emplace_back(exception_table_entry);
-    }
+    READ_U2_ARRAY_FIELD(exception_index_table, number_of_exceptions, "Failed to parse exception "
+        "table of method.");
 
     return std::make_unique<exceptions_attribute>(std::move(exception_index_table));
 }
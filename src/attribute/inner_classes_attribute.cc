@@ -25,24 +25,20 @@
 #include "inner_classes_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_inner_classes_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_inner_classes_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(number_of_classes, "Failed to parse number of classes of InnerClasses "
         "attribute.");
+    constexpr size_t INNER_CLASS_ENTRY_FIELDS = 4;
+    READ_U2_ARRAY_FIELD(fields, number_of_classes * INNER_CLASS_ENTRY_FIELDS, "Failed to parse "
+        "classes of InnerClasses attribute.");
     std::vector<inner_class_entry> inner_classes;
-    for (uint16_t curr_class_idx = 0; curr_class_idx < number_of_classes; curr_class_idx++)
+    inner_classes.reserve(number_of_classes);
+    for (size_t field_idx = 0; field_idx < fields.size(); field_idx += INNER_CLASS_ENTRY_FIELDS)
     {
-        READ_U2_FIELD(inner_class_info_index, "Failed to parse inner class info index of "
-            "InnerClasses attribute.");
-        READ_U2_FIELD(outer_class_info_index, "Failed to parse outer class info index of "
-            "InnerClasses attribute.");
-        READ_U2_FIELD(inner_name_index, "Failed to parse inner name index of InnerClasses "
-            "attribute.");
-        READ_U2_FIELD(inner_class_access_flags, "Failed to parse inner class access flags of "
-            "InnerClasses attribute.");
-        inner_classes.emplace_back(inner_class_info_index, outer_class_info_index, inner_name_index,
-            inner_class_access_flags);
+        inner_classes.emplace_back(fields[field_idx], fields[field_idx + 1], fields[field_idx + 2],
+            fields[field_idx + 3]);
     }
 
     return std::make_unique<inner_classes_attribute>(std::move(inner_classes));
@@ -25,17 +25,20 @@
 #include "line_number_table_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_line_number_table_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_line_number_table_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(line_number_table_length, "Failed to parse line number table length of "
         "LineNumberTable attribute.");
+    constexpr size_t LINE_NUMBER_TABLE_ENTRY_FIELDS = 2;
+    READ_U2_ARRAY_FIELD(fields, line_number_table_length * LINE_NUMBER_TABLE_ENTRY_FIELDS,
+        "Failed to parse entries of LineNumberTable attribute.");
     std::vector<line_number_table_entry> line_number_table;
-    for (uint16_t curr_lnt_idx = 0; curr_lnt_idx < line_number_table_length; curr_lnt_idx++)
+    line_number_table.reserve(line_number_table_length);
+    for (size_t field_idx = 0; field_idx < fields.size();
+        field_idx += LINE_NUMBER_TABLE_ENTRY_FIELDS)
     {
-        READ_U2_FIELD(start_pc, "Failed to parse start pc of LineNumberTable attribute.");
-        READ_U2_FIELD(line_number, "Failed to parse line number of LineNumberTable attribute.");
-        line_number_table.emplace_back(start_pc, line_number);
+        line_number_table.emplace_back(fields[field_idx], fields[field_idx + 1]);
     }
 
     return std::make_unique<line_number_table_attribute>(std::move(line_number_table));
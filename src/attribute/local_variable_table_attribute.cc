@@ -25,21 +25,21 @@
 #include "local_variable_table_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_local_variable_table_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_local_variable_table_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(local_variable_table_length, "Failed to parse local variable table length of "
         "LocalVariableTable attribute.");
+    constexpr size_t LOCAL_VARIABLE_TABLE_ENTRY_FIELDS = 5;
+    READ_U2_ARRAY_FIELD(fields, local_variable_table_length * LOCAL_VARIABLE_TABLE_ENTRY_FIELDS,
+        "Failed to parse entries of LocalVariableTable attribute.");
     std::vector<local_variable_table_entry> local_variable_table;
-    for (uint16_t curr_lvt_idx = 0; curr_lvt_idx < local_variable_table_length; curr_lvt_idx++)
+    local_variable_table.reserve(local_variable_table_length);
+    for (size_t field_idx = 0; field_idx < fields.size();
+        field_idx += LOCAL_VARIABLE_TABLE_ENTRY_FIELDS)
     {
-        READ_U2_FIELD(start_pc, "Failed to parse start pc of LocalVariableTable attribute.");
-        READ_U2_FIELD(length, "Failed to parse length of LocalVariableTable attribute.");
-        READ_U2_FIELD(name_index, "Failed to parse name index of LocalVariableTable attribute.");
-        READ_U2_FIELD(descriptor_index, "Failed to parse descriptor index of LocalVariableTable "
-            "attribute.");
-        READ_U2_FIELD(index, "Failed to parse index of LocalVariableTable attribute.");
-        local_variable_table.emplace_back(start_pc, length, name_index, descriptor_index, index);
+        local_variable_table.emplace_back(fields[field_idx], fields[field_idx + 1],
+            fields[field_idx + 2], fields[field_idx + 3], fields[field_idx + 4]);
     }
 
     return std::make_unique<local_variable_table_attribute>(std::move(local_variable_table));
@@ -24,7 +24,7 @@
 #include "runtime_invisible_annotations_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_runtime_invisible_annotations_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_runtime_invisible_annotations_attribute(class_reader& file,
     const constant_pool& cp)
 {
     skip_annotations(file);
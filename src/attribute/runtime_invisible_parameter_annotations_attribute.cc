@@ -25,7 +25,7 @@
 #include "util.hh"
 
 std::unique_ptr<attribute_info> parse_runtime_invisible_parameter_annotations_attribute(
-    std::ifstream& file, const constant_pool& cp)
+    class_reader& file, const constant_pool& cp)
 {
     READ_U1_FIELD(num_parameters, "Failed to parse number of parameter annotations of "
         "RuntimeInvisibleParameterAnnotations attribute.");
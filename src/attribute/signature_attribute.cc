@@ -24,7 +24,7 @@
 #include "signature_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_signature_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_signature_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(signature_index, "Failed to parse signature index of Signature attribute.");
@@ -24,7 +24,7 @@
 #include "source_file_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_source_file_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_source_file_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(sourcefile_index, "Failed to parse source file index of SourceFile attribute.");
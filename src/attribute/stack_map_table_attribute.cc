@@ -18,68 +18,120 @@
 */
 
 #include <memory>
+#include <vector>
 
 #include "attribute_info.hh"
 #include "constant_pool.hh"
 #include "stack_map_table_attribute.hh"
 #include "util.hh"
 
-static void skip_verification_type_info(std::ifstream& file, uint16_t length)
+static void parse_verification_types(class_reader& file, uint16_t length,
+    std::vector<verification_type>& types)
 {
     for (uint16_t current = 0; current < length; current++)
     {
         READ_U1_FIELD(tag, "Failed to parse tag for current verification type info entry of "
             "StackMapTable attribute.");
-        if (tag == 7 || tag == 8)
+        if (tag > static_cast<uint8_t>(verification_type_tag::Uninitialized))
         {
-            READ_U2_FIELD(tmp, "Failed to parse cp info/offset for current verification type info "
-                "entry of StackMapTable attribute.");
+            file.fail("Invalid tag for current verification type info entry of StackMapTable "
+                "attribute.");
+            return;
         }
+
+        const auto type_tag = static_cast<verification_type_tag>(tag);
+        uint16_t data = 0;
+        if (type_tag == verification_type_tag::Object ||
+            type_tag == verification_type_tag::Uninitialized)
+        {
+            READ_U2_FIELD(cp_index_or_offset, "Failed to parse cp info/offset for current "
+                "verification type info entry of StackMapTable attribute.");
+            data = cp_index_or_offset;
+        }
+
+        types.push_back(verification_type{type_tag, data});
     }
 }
 
-std::unique_ptr<attribute_info> parse_stack_map_table_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_stack_map_table_attribute(class_reader& file,
     const constant_pool& cp)
 {
     READ_U2_FIELD(number_of_entries, "Failed to parse number of stack map table entries of "
         "StackMapTable attribute.");
-    for (uint16_t curr_entry_idx = 0; curr_entry_idx < number_of_entries; curr_entry_idx++)
+    std::vector<stack_map_frame> frames;
+    std::vector<verification_type> types;
+    frames.reserve(number_of_entries);
+    // The first frame's offset delta is its pc; each later one's is one less than the distance from
+    // the previous frame.
+    uint32_t pc = 0;
+    for (uint16_t curr_entry_idx = 0; curr_entry_idx < number_of_entries && !file.failed();
+        curr_entry_idx++)
     {
         READ_U1_FIELD(frame_type, "Failed to parse frame type for current entry of StackMapTable "
             "attribute.");
+        stack_map_frame frame{0, stack_map_frame_kind::same, 0, 0, 0,
+            static_cast<uint32_t>(types.size())};
+        uint16_t offset_delta = frame_type;
         if (frame_type >= 64 && frame_type <= 127)
         {
-            skip_verification_type_info(file, 1);
+            offset_delta = frame_type - 64;
+            frame.kind = stack_map_frame_kind::same_locals_1_stack_item;
+            frame.stack_count = 1;
+            parse_verification_types(file, 1, types);
+        }
+        else if (frame_type >= 128 && frame_type <= 246)
+        {
+            file.fail("Reserved frame type for current entry of StackMapTable attribute.");
+            break;
         }
         else if (frame_type == 247)
         {
-            READ_U2_FIELD(offset_delta, "Failed to parse offset delta for current entry of "
-                "StackMapTable attribute.");
-            skip_verification_type_info(file, 1);
+            READ_U2_FIELD(extended_offset_delta, "Failed to parse offset delta for current entry "
+                "of StackMapTable attribute.");
+            offset_delta = extended_offset_delta;
+            frame.kind = stack_map_frame_kind::same_locals_1_stack_item;
+            frame.stack_count = 1;
+            parse_verification_types(file, 1, types);
         }
         else if (frame_type >= 248 && frame_type <= 251)
         {
-            READ_U2_FIELD(offset_delta, "Failed to parse offset delta for current entry of "
-                "StackMapTable attribute.");
+            READ_U2_FIELD(extended_offset_delta, "Failed to parse offset delta for current entry "
+                "of StackMapTable attribute.");
+            offset_delta = extended_offset_delta;
+            // 251 is a same frame with an extended offset delta.
+            frame.kind = frame_type == 251
+                ? stack_map_frame_kind::same : stack_map_frame_kind::chop;
+            frame.chopped_locals = static_cast<uint8_t>(251 - frame_type);
         }
         else if (frame_type >= 252 && frame_type <= 254)
         {
-            READ_U2_FIELD(offset_delta, "Failed to parse offset delta for current entry of "
-                "StackMapTable attribute.");
-            skip_verification_type_info(file, frame_type - 251);
+            READ_U2_FIELD(extended_offset_delta, "Failed to parse offset delta for current entry "
+                "of StackMapTable attribute.");
+            offset_delta = extended_offset_delta;
+            frame.kind = stack_map_frame_kind::append;
+            frame.local_count = static_cast<uint16_t>(frame_type - 251);
+            parse_verification_types(file, frame.local_count, types);
         }
         else if (frame_type == 255)
         {
-            READ_U2_FIELD(offset_delta, "Failed to parse offset delta for current entry of "
-                "StackMapTable attribute.");
+            READ_U2_FIELD(extended_offset_delta, "Failed to parse offset delta for current entry "
+                "of StackMapTable attribute.");
+            offset_delta = extended_offset_delta;
+            frame.kind = stack_map_frame_kind::full;
             READ_U2_FIELD(number_of_locals, "Failed to parse number of locals for current entry of "
                 "StackMapTable attribute.");
-            skip_verification_type_info(file, number_of_locals);
+            frame.local_count = number_of_locals;
+            parse_verification_types(file, number_of_locals, types);
             READ_U2_FIELD(number_of_stack_items, "Failed to parse number of stack items for "
                 "current entry of StackMapTable attribute.");
-            skip_verification_type_info(file, number_of_stack_items);
+            frame.stack_count = number_of_stack_items;
+            parse_verification_types(file, number_of_stack_items, types);
         }
+
+        pc = curr_entry_idx == 0 ? offset_delta : pc + offset_delta + 1;
+        frame.pc = pc;
+        frames.push_back(frame);
     }
 
-    return std::make_unique<stack_map_table_attribute>();
+    return std::make_unique<stack_map_table_attribute>(std::move(frames), std::move(types));
 }
@@ -24,7 +24,7 @@
 #include "synthetic_attribute.hh"
 #include "util.hh"
 
-std::unique_ptr<attribute_info> parse_synthetic_attribute(std::ifstream& file,
+std::unique_ptr<attribute_info> parse_synthetic_attribute(class_reader& file,
     const constant_pool& cp)
 {
     return std::make_unique<synthetic_attribute>();
@@ -17,8 +17,6 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#include <fstream>
-#include <ios>
 #include <memory>
 #include <stack>
 #include <unordered_map>
@@ -26,8 +24,9 @@
 #include <vector>
 
 #include "attribute_info.hh"
+#include "class_reader.hh"
 #include "constant_pool.hh"
-#include "invalid_class_format_exception.hh"
+#include "symbol_table.hh"
 #include "util.hh"
 
 #include "annotation_default_attribute.hh"
@@ -50,8 +49,30 @@
 #include "stack_map_table_attribute.hh"
 #include "synthetic_attribute.hh"
 
-void skip_element_value_field(std::ifstream& file)
+// Annotations can nest arbitrarily deep; bound the recursion so a hostile class cannot exhaust the
+// stack.
+constexpr size_t MAX_ELEMENT_VALUE_DEPTH = 256;
+
+static void skip_annotation(class_reader& file, size_t depth)
+{
+    READ_U2_FIELD(type_index, "Failed to read type index for annotation.");
+    READ_U2_FIELD(num_ev_pairs, "Failed to read ev pairs length for annotation.");
+    for (uint16_t curr_ev_pair_idx = 0; curr_ev_pair_idx < num_ev_pairs && !file.failed();
+        curr_ev_pair_idx++)
+    {
+        READ_U2_FIELD(element_name_index, "Failed to read element name index for annotation.");
+        skip_element_value_field(file, depth);
+    }
+}
+
+void skip_element_value_field(class_reader& file, size_t depth)
 {
+    if (depth > MAX_ELEMENT_VALUE_DEPTH)
+    {
+        file.fail("Annotation element values are nested too deeply.");
+        return;
+    }
+
     READ_U1_FIELD(tag, "Failed to read tag for annotation.");
     unsigned char tag_char = reinterpret_cast<unsigned char>(tag);
     if (tag_char == 'B' || tag_char == 'C' || tag_char == 'D' || tag_char == 'F' ||
@@ -71,70 +92,71 @@ void skip_element_value_field(std::ifstream& file)
     }
     else if (tag_char == '@')
     {
-        skip_annotations(file);
+        skip_annotation(file, depth + 1);
     }
     else if (tag_char == '[')
     {
         READ_U2_FIELD(num_values, "Failed to read values length for annotation.");
-        skip_element_value_field(file);
+        for (uint16_t curr_value_idx = 0; curr_value_idx < num_values && !file.failed();
+            curr_value_idx++)
+        {
+            skip_element_value_field(file, depth + 1);
+        }
     }
     else
     {
-        throw invalid_class_format{"Unknown annotation tag type."};
+        file.fail("Unknown annotation tag type.");
     }
 }
 
-void skip_annotations(std::ifstream& file)
+void skip_annotations(class_reader& file)
 {
     READ_U2_FIELD(num_annotations, "Failed to read annotations length for field.");
     for (uint16_t curr_annotation_idx = 0; curr_annotation_idx < num_annotations;
         curr_annotation_idx++)
     {
-        READ_U2_FIELD(type_index, "Failed to read type index for annotation.");
-        READ_U2_FIELD(num_ev_pairs, "Failed to read ev pairs length for annotation.");
-        for (uint16_t curr_ev_pair_idx = 0; curr_ev_pair_idx < num_ev_pairs; curr_ev_pair_idx++)
-        {
-            READ_U2_FIELD(element_name_index, "Failed to read element name index for annotation.");
-            skip_element_value_field(file);
-        }
+        skip_annotation(file, 0);
     }
 }
 
-using attribute_parser_fn = std::function<std::unique_ptr<attribute_info>(std::ifstream&, const
+using attribute_parser_fn = std::function<std::unique_ptr<attribute_info>(class_reader&, const
     constant_pool&)>;
-using utf8_entry_value_type = decltype(std::declval<cp_utf8_entry>().value);
-using attribute_parser_table = std::unordered_map<utf8_entry_value_type, attribute_parser_fn>;
+// Keyed by the interned attribute name, so finding a parser is an integer lookup.
+using attribute_parser_table = std::unordered_map<symbol_id, attribute_parser_fn>;
 
 attribute_parser_table build_attribute_parser_table()
 {
     attribute_parser_table table;
-    table["AnnotationDefault"] = parse_annotation_default_attribute;
-    table["BootstrapMethods"] = parse_bootstrap_methods_attribute;
-    table["Code"] = parse_code_attribute;
-    table["ConstantValue"] = parse_constant_value_attribute;
-    table["Deprecated"] = parse_deprecated_attribute;
-    table["EnclosingMethod"] = parse_enclosing_method_attribute;
-    table["Exceptions"] = parse_exceptions_attribute;
-    table["InnerClasses"] = parse_inner_classes_attribute;
-    table["LineNumberTable"] = parse_line_number_table_attribute;
-    table["LocalVariableTable"] = parse_local_variable_table_attribute;
-    table["LocalVariableTypeTable"] = parse_local_variable_type_table_attribute;
-    table["RuntimeInvisibleAnnotations"] = parse_runtime_invisible_annotations_attribute;
-    table["RuntimeInvisibleParameterAnnotations"] =
+    symbol_table& symbols = symbol_table::instance();
+    table[symbols.intern("AnnotationDefault")] = parse_annotation_default_attribute;
+    table[symbols.intern("BootstrapMethods")] = parse_bootstrap_methods_attribute;
+    table[symbols.intern("Code")] = parse_code_attribute;
+    table[symbols.intern("ConstantValue")] = parse_constant_value_attribute;
+    table[symbols.intern("Deprecated")] = parse_deprecated_attribute;
+    table[symbols.intern("EnclosingMethod")] = parse_enclosing_method_attribute;
+    table[symbols.intern("Exceptions")] = parse_exceptions_attribute;
+    table[symbols.intern("InnerClasses")] = parse_inner_classes_attribute;
+    table[symbols.intern("LineNumberTable")] = parse_line_number_table_attribute;
+    table[symbols.intern("LocalVariableTable")] = parse_local_variable_table_attribute;
+    table[symbols.intern("LocalVariableTypeTable")] = parse_local_variable_type_table_attribute;
+    table[symbols.intern("RuntimeInvisibleAnnotations")] =
+    parse_runtime_invisible_annotations_attribute;
+    table[symbols.intern("RuntimeInvisibleParameterAnnotations")] =
     parse_runtime_invisible_parameter_annotations_attribute;
-    table["RuntimeVisibleAnnotations"] = parse_runtime_visible_annotations_attribute;
-    table["RuntimeVisibleParameterAnnotations"] =
+    table[symbols.intern("RuntimeVisibleAnnotations")] =
+    parse_runtime_visible_annotations_attribute;
+    table[symbols.intern("RuntimeVisibleParameterAnnotations")] =
     parse_runtime_visible_parameter_annotations_attribute;
-    table["Signature"] = parse_signature_attribute;
-    table["SourceFile"] = parse_source_file_attribute;
-    table["StackMapTable"] = parse_stack_map_table_attribute;
-    table["Synthetic"] = parse_synthetic_attribute;
+    table[symbols.intern("Signature")] = parse_signature_attribute;
+    table[symbols.intern("SourceFile")] = parse_source_file_attribute;
+    table[symbols.intern("StackMapTable")] = parse_stack_map_table_attribute;
+    table[symbols.intern("Synthetic")] = parse_synthetic_attribute;
     return table;
 }
 
 static const attribute_parser_table attribute_parsers = build_attribute_parser_table();
 
-entry_attributes parse_attributes(std::ifstream& file, const constant_pool& cp)
+entry_attributes parse_attributes(class_reader& file, const constant_pool& cp)
 {
     entry_attributes field_attributes;
     READ_U2_FIELD(attributes_count, "Failed to parse attributes count of field.");
@@ -143,12 +165,19 @@ entry_attributes parse_attributes(std::ifstream& file, const constant_pool& cp)
     {
         READ_U2_FIELD(attribute_name_index, "Failed to parse attribute name index of field.");
         READ_U4_FIELD(attribute_length, "Failed to parse attribute length of field.");
+        if (attribute_length > file.remaining())
+        {
+            file.fail("Attribute length exceeds the end of the class file.");
+            break;
+        }
+
+        const size_t attribute_end = file.tell() + attribute_length;
         auto cp_entry_handle = cp.get_entry_info(attribute_name_index);
         // Unexpected attribute entries must be ignored according to the JVM spec.
         if (!cp_entry_handle)
         {
             // Skip the rest of this attribute.
-            file.seekg(attribute_length, std::ios::ios_base::cur);
+            file.skip(attribute_length);
             continue;
         }
 
@@ -157,25 +186,37 @@ entry_attributes parse_attributes(std::ifstream& file, const constant_pool& cp)
         // attributes must be identified by the UTF8 entry value, the class is probably malformed.
         if (cp_entry.type != constant_pool_type::Utf8)
         {
-            throw invalid_class_format{"Attribute name unidentifiable -- cp entry not utf8."};
+            file.fail("Attribute name unidentifiable -- cp entry not utf8.");
+            break;
         }
 
-        auto utf8_entry = std::get<cp_utf8_entry>(cp_entry.entry);
-        auto attribute_parser_it = attribute_parsers.find(utf8_entry.value);
+        const auto& utf8_entry = std::get<cp_utf8_entry>(cp_entry.entry);
+        auto attribute_parser_it = attribute_parsers.find(utf8_entry.symbol);
+        // Attributes we have no parser for (including `SourceDebugExtension` debugger
+        // information) are skipped, as the JVM spec requires for unrecognized attributes.
         if (attribute_parser_it == attribute_parsers.cend())
         {
-            throw invalid_class_format{"Attribute parser not found."};
+            file.skip(attribute_length);
+            continue;
         }
 
-        // Skip over debugger information.
-        if (utf8_entry.value == "SourceDebugExtension")
+        const auto& parser_fn = attribute_parser_it->second;
+        auto attribute = parser_fn(file, cp);
+        if (file.failed())
         {
-            file.seekg(attribute_length, std::ios::ios_base::cur);
-            continue;
+            break;
         }
 
-        const auto& parser_fn = attribute_parser_it->second;
-        field_attributes.emplace_back(parser_fn(file, cp));
+        // A parser must stay within its attribute, otherwise everything that follows would be
+        // misinterpreted. Trailing bytes it did not need are skipped.
+        if (file.tell() > attribute_end)
+        {
+            file.fail("Attribute contents exceed the attribute length.");
+            break;
+        }
+
+        field_attributes.emplace_back(std::move(attribute));
+        file.skip(attribute_end - file.tell());
     }
 
     return field_attributes;
@@ -0,0 +1,99 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_ORDER_HAVE_X86_SIMD
+#endif
+
+#include "byte_order.hh"
+
+using decode_u2_fn = void (*)(const uint8_t*, uint16_t*, size_t);
+
+static void decode_u2_scalar(const uint8_t* in, uint16_t* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        uint16_t value;
+        std::memcpy(&value, in + i * sizeof(value), sizeof(value));
+        out[i] = __builtin_bswap16(value);
+    }
+}
+
+#ifdef BYTE_ORDER_HAVE_X86_SIMD
+// Shuffle mask that reverses the bytes of every u2 lane within a 16 byte block.
+#define U2_SWAP_MASK 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+
+__attribute__((target("ssse3")))
+static void decode_u2_ssse3(const uint8_t* in, uint16_t* out, size_t count)
+{
+    const __m128i mask = _mm_set_epi8(U2_SWAP_MASK);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_shuffle_epi8(block, mask));
+    }
+
+    decode_u2_scalar(in + i * 2, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void decode_u2_avx2(const uint8_t* in, uint16_t* out, size_t count)
+{
+    // `vpshufb` shuffles within each 128-bit lane, so the mask is simply repeated.
+    const __m256i mask = _mm256_set_epi8(U2_SWAP_MASK, U2_SWAP_MASK);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m256i block =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i * 2));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+            _mm256_shuffle_epi8(block, mask));
+    }
+
+    decode_u2_ssse3(in + i * 2, out + i, count - i);
+}
+
+#undef U2_SWAP_MASK
+#endif
+
+static decode_u2_fn select_decode_u2()
+{
+#ifdef BYTE_ORDER_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return decode_u2_avx2;
+    }
+
+    if (__builtin_cpu_supports("ssse3"))
+    {
+        return decode_u2_ssse3;
+    }
+#endif
+    return decode_u2_scalar;
+}
+
+void decode_big_endian_u2_array(const uint8_t* in, uint16_t* out, size_t count)
+{
+    static const decode_u2_fn decode = select_decode_u2();
+    decode(in, out, count);
+}
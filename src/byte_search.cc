@@ -0,0 +1,112 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_SEARCH_HAVE_X86_SIMD
+#endif
+
+#include "byte_search.hh"
+
+using contains_byte_in_range_fn = bool (*)(const uint8_t*, size_t, uint8_t, uint8_t);
+
+static bool contains_byte_in_range_scalar(const uint8_t* data, size_t length, uint8_t first,
+    uint8_t last)
+{
+    const uint8_t width = last - first;
+    for (size_t i = 0; i < length; i++)
+    {
+        // Wraps around for bytes below `first`, so one unsigned comparison checks both bounds.
+        if (static_cast<uint8_t>(data[i] - first) <= width)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef BYTE_SEARCH_HAVE_X86_SIMD
+// Both vector versions use the same trick as the scalar loop: after subtracting `first`, a byte is
+// in range iff it is unchanged by an unsigned minimum with the range width.
+
+__attribute__((target("sse2")))
+static bool contains_byte_in_range_sse2(const uint8_t* data, size_t length, uint8_t first,
+    uint8_t last)
+{
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(first));
+    const __m128i width = _mm_set1_epi8(static_cast<char>(last - first));
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i block = _mm_sub_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), bias);
+        const __m128i in_range = _mm_cmpeq_epi8(_mm_min_epu8(block, width), block);
+        if (_mm_movemask_epi8(in_range))
+        {
+            return true;
+        }
+    }
+
+    return contains_byte_in_range_scalar(data + i, length - i, first, last);
+}
+
+__attribute__((target("avx2")))
+static bool contains_byte_in_range_avx2(const uint8_t* data, size_t length, uint8_t first,
+    uint8_t last)
+{
+    const __m256i bias = _mm256_set1_epi8(static_cast<char>(first));
+    const __m256i width = _mm256_set1_epi8(static_cast<char>(last - first));
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i block = _mm256_sub_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), bias);
+        const __m256i in_range = _mm256_cmpeq_epi8(_mm256_min_epu8(block, width), block);
+        if (_mm256_movemask_epi8(in_range))
+        {
+            return true;
+        }
+    }
+
+    return contains_byte_in_range_sse2(data + i, length - i, first, last);
+}
+#endif
+
+static contains_byte_in_range_fn select_contains_byte_in_range()
+{
+#ifdef BYTE_SEARCH_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return contains_byte_in_range_avx2;
+    }
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return contains_byte_in_range_sse2;
+    }
+#endif
+    return contains_byte_in_range_scalar;
+}
+
+bool contains_byte_in_range(const uint8_t* data, size_t length, uint8_t first, uint8_t last)
+{
+    static const contains_byte_in_range_fn contains = select_contains_byte_in_range();
+    return contains(data, length, first, last);
+}
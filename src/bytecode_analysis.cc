@@ -0,0 +1,163 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "bytecode.hh"
+#include "bytecode_analysis.hh"
+#include "constant_pool.hh"
+#include "java_class.hh"
+#include "member_ref_table.hh"
+
+std::optional<method_slots> get_method_slots(std::string_view descriptor,
+    std::vector<uint32_t>* parameter_offsets)
+{
+    if (descriptor.empty() || descriptor.front() != '(')
+    {
+        return std::nullopt;
+    }
+
+    uint32_t arguments = 0;
+    size_t idx = 1;
+    while (idx < descriptor.size() && descriptor[idx] != ')')
+    {
+        if (parameter_offsets)
+        {
+            parameter_offsets->push_back(arguments);
+        }
+
+        arguments += get_type_slots(descriptor[idx]);
+        idx = descriptor.find_first_not_of('[', idx);
+        if (idx != std::string_view::npos && descriptor[idx] == 'L')
+        {
+            idx = descriptor.find(';', idx);
+        }
+
+        if (idx == std::string_view::npos)
+        {
+            return std::nullopt;
+        }
+
+        idx++;
+    }
+
+    if (idx + 1 >= descriptor.size())
+    {
+        return std::nullopt;
+    }
+
+    const char result = descriptor[idx + 1];
+    return method_slots{arguments, result == 'V' ? 0 : get_type_slots(result)};
+}
+
+std::optional<invoke_target> resolve_invoke(const java_class& clazz, bytecode_tag instr,
+    constant_pool_entry_id cp_index)
+{
+    if (instr != bytecode_tag::INVOKEDYNAMIC)
+    {
+        const resolved_member_ref* member_ref = clazz.get_class_member_refs().find(cp_index);
+        if (!member_ref || member_ref->type == constant_pool_type::FieldRef)
+        {
+            return std::nullopt;
+        }
+
+        return invoke_target{member_ref, member_ref->descriptor};
+    }
+
+    const constant_pool& cp = clazz.get_class_constant_pool();
+    const auto* invoke_dynamic = cp.find_entry_as<cp_invokedynamic_info_entry>(cp_index,
+        constant_pool_type::InvokeDynamic);
+    const auto* name_and_type = invoke_dynamic
+        ? cp.find_entry_as<cp_name_and_type_index_entry>(invoke_dynamic->cp_index2,
+            constant_pool_type::NameAndType)
+        : nullptr;
+    const auto* descriptor = name_and_type
+        ? cp.find_entry_as<cp_utf8_entry>(name_and_type->cp_index2, constant_pool_type::Utf8)
+        : nullptr;
+    if (!descriptor)
+    {
+        return std::nullopt;
+    }
+
+    return invoke_target{nullptr, descriptor->value};
+}
+
+std::optional<local_access> decode_local_access(const uint8_t* bytecode, uint16_t pc)
+{
+    const auto instr = static_cast<bytecode_tag>(bytecode[pc]);
+    // Each short form group holds the four locals of one type, in the order of the long forms.
+    const auto from_short_form = [&](bytecode_tag first_short, bytecode_tag first_long)
+    {
+        const size_t offset = static_cast<size_t>(instr) - static_cast<size_t>(first_short);
+        return local_access{static_cast<bytecode_tag>(static_cast<size_t>(first_long) + offset / 4),
+            static_cast<uint32_t>(offset % 4)};
+    };
+
+    if ((instr >= bytecode_tag::ILOAD && instr <= bytecode_tag::ALOAD) ||
+        (instr >= bytecode_tag::ISTORE && instr <= bytecode_tag::ASTORE) ||
+        instr == bytecode_tag::IINC)
+    {
+        return local_access{instr, bytecode[pc + 1]};
+    }
+
+    if (instr >= bytecode_tag::ILOAD_0 && instr <= bytecode_tag::ALOAD_3)
+    {
+        return from_short_form(bytecode_tag::ILOAD_0, bytecode_tag::ILOAD);
+    }
+
+    if (instr >= bytecode_tag::ISTORE_0 && instr <= bytecode_tag::ASTORE_3)
+    {
+        return from_short_form(bytecode_tag::ISTORE_0, bytecode_tag::ISTORE);
+    }
+
+    // Every instruction `wide` can widen accesses a local, save for `ret`.
+    if (instr == bytecode_tag::WIDE && bytecode[pc + 1] != static_cast<uint8_t>(bytecode_tag::RET))
+    {
+        return local_access{static_cast<bytecode_tag>(bytecode[pc + 1]),
+            read_u2_operand(&bytecode[pc + 2])};
+    }
+
+    return std::nullopt;
+}
+
+bool can_fall_through(const uint8_t* bytecode, uint16_t pc)
+{
+    const auto instr = static_cast<bytecode_tag>(bytecode[pc]);
+    switch (instr)
+    {
+        case bytecode_tag::WIDE:
+            return bytecode[pc + 1] != static_cast<uint8_t>(bytecode_tag::RET);
+        case bytecode_tag::GOTO:
+        case bytecode_tag::GOTO_W:
+        case bytecode_tag::RET:
+        case bytecode_tag::TABLESWITCH:
+        case bytecode_tag::LOOKUPSWITCH:
+        case bytecode_tag::IRETURN:
+        case bytecode_tag::LRETURN:
+        case bytecode_tag::FRETURN:
+        case bytecode_tag::DRETURN:
+        case bytecode_tag::ARETURN:
+        case bytecode_tag::RETURN:
+        case bytecode_tag::ATHROW:
+            return false;
+        default:
+            return true;
+    }
+}
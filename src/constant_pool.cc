@@ -17,19 +17,19 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#include <fstream>
 #include <functional>
 #include <optional>
 #include <unordered_map>
 #include <utility>
 #include <variant>
 
+#include "class_reader.hh"
 #include "constant_pool.hh"
 #include "constant_pool_entry_parser.hh"
-#include "invalid_class_format_exception.hh"
+#include "scan_stats.hh"
 #include "util.hh"
 
-using cp_parser_fn = std::function<constant_pool_entry(std::ifstream&)>;
+using cp_parser_fn = std::function<constant_pool_entry(class_reader&)>;
 using cp_parser_table = std::unordered_map<constant_pool_type, cp_parser_fn>;
 
 cp_parser_table build_cp_entry_parser_table()
@@ -54,8 +54,9 @@ cp_parser_table build_cp_entry_parser_table()
 
 static const cp_parser_table cp_entry_parser_table = build_cp_entry_parser_table();
 
-constant_pool constant_pool::parse_constant_pool(std::ifstream& file)
+constant_pool constant_pool::parse_constant_pool(class_reader& file)
 {
+    SCAN_PHASE(scan_phase::constant_pool);
     READ_U2_FIELD(constant_pool_count, "Failed to parse constant pool count.");
     if (constant_pool_count > 0)
     {
@@ -75,19 +76,26 @@ constant_pool constant_pool::parse_constant_pool(std::ifstream& file)
         auto parser_it = cp_entry_parser_table.find(current_entry_tag);
         if (parser_it == cp_entry_parser_table.cend())
         {
-            throw invalid_class_format{"Unknown constant pool tag."};
+            file.fail("Unknown constant pool tag.");
+            break;
         }
 
         // Lookup the parser function for the given tag and emplace the object it parses into our
         // constant pool.
         const auto& parse_entry_fn = parser_it->second;
         constant_pool_entry parse_entry = parse_entry_fn(file);
+        if (file.failed())
+        {
+            break;
+        }
+
         entries.emplace(curr_idx + 1,
             constant_pool_entry_info{current_entry_tag, std::move(parse_entry)});
         // Doubles and Longs increment the constant pool index by 2.
         curr_idx += (current_entry_tag == constant_pool_type::Double || current_entry_tag == constant_pool_type::Long) ? 2 : 1;
     }
 
+    SCAN_COUNT(scan_counter::pool_entries, entries.size());
     return constant_pool{std::move(entries)};
 }
 
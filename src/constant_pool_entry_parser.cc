@@ -18,33 +18,44 @@
 */
 
 #include <cmath>
-#include <fstream>
 #include <limits>
 
+#include "class_reader.hh"
 #include "constant_pool.hh"
 #include "constant_pool_entry_parser.hh"
-#include "invalid_class_format_exception.hh"
+#include "modified_utf8.hh"
 #include "util.hh"
 
-cp_utf8_entry parse_cp_utf8_entry(std::ifstream& file)
+cp_utf8_entry parse_cp_utf8_entry(class_reader& file)
 {
     READ_U2_FIELD(utf8_length, "Failed to parse constant pool utf8 string entry.");
-    std::string utf8_string(utf8_length, '\0');
-    if (!file.read(utf8_string.data(), utf8_length))
+    std::string_view utf8_string;
+    if (!file.read_view(utf8_string, utf8_length))
     {
-        throw invalid_class_format{"Failed to parse constant pool utf8 string entry."};
+        file.fail("Failed to parse constant pool utf8 string entry.");
+        return cp_utf8_entry{};
     }
 
-    return cp_utf8_entry{std::move(utf8_string)};
+    if (!is_valid_modified_utf8(reinterpret_cast<const uint8_t*>(utf8_string.data()),
+        utf8_string.size()))
+    {
+        file.fail("Constant pool utf8 string entry is not valid modified UTF-8.");
+        return cp_utf8_entry{};
+    }
+
+    // The bytes belong to the caller's buffer, so the entry refers to the interned copy instead.
+    symbol_table& symbols = symbol_table::instance();
+    const symbol_id symbol = symbols.intern(utf8_string);
+    return cp_utf8_entry{symbol, symbols.get_name(symbol)};
 }
 
-cp_integer_entry parse_cp_integer_entry(std::ifstream& file)
+cp_integer_entry parse_cp_integer_entry(class_reader& file)
 {
     READ_U4_FIELD(number, "Failed to parse constant pool integer entry.");
     return cp_integer_entry{static_cast<int32_t>(number)};
 }
 
-cp_float_entry parse_cp_float_entry(std::ifstream& file)
+cp_float_entry parse_cp_float_entry(class_reader& file)
 {
     READ_U4_FIELD(bits, "Failed to parse constant pool float entry.");
     float number = 0;
@@ -72,13 +83,13 @@ cp_float_entry parse_cp_float_entry(std::ifstream& file)
     return cp_float_entry{number};
 }
 
-cp_long_entry parse_cp_long_entry(std::ifstream& file)
+cp_long_entry parse_cp_long_entry(class_reader& file)
 {
     constexpr size_t LONG_ENTRY_LENGTH = 8;
     uint64_t number = 0;
     if (!file.read(reinterpret_cast<char*>(&number), LONG_ENTRY_LENGTH))
     {
-        throw invalid_class_format{"Failed to parse constant pool long entry."};
+        file.fail("Failed to parse constant pool long entry.");
     }
 
     uint32_t high_bytes = (number >> 32) & 0xFFFFFFFF;
@@ -87,13 +98,13 @@ cp_long_entry parse_cp_long_entry(std::ifstream& file)
     return cp_long_entry{static_cast<int64_t>(number)};
 }
 
-cp_double_entry parse_cp_double_entry(std::ifstream& file)
+cp_double_entry parse_cp_double_entry(class_reader& file)
 {
     constexpr size_t DOUBLE_ENTRY_LENGTH = 8;
     uint64_t bits = 0;
     if (!file.read(reinterpret_cast<char*>(&bits), DOUBLE_ENTRY_LENGTH))
     {
-        throw invalid_class_format{"Failed to parse constant pool double entry."};
+        file.fail("Failed to parse constant pool double entry.");
     }
 
     uint32_t high_bytes = (bits >> 32) & 0xFFFFFFFF;
@@ -126,20 +137,20 @@ cp_double_entry parse_cp_double_entry(std::ifstream& file)
     return cp_double_entry{number};
 }
 
-cp_index_entry parse_cp_index_entry(std::ifstream& file)
+cp_index_entry parse_cp_index_entry(class_reader& file)
 {
     READ_U2_FIELD(cp_index, "Failed to parse constant pool index entry.");
     return cp_index_entry{cp_index};
 }
 
-cp_double_index_entry parse_cp_double_index_entry(std::ifstream& file)
+cp_double_index_entry parse_cp_double_index_entry(class_reader& file)
 {
     READ_U2_FIELD(cp_index, "Failed to parse constant pool double index entry.");
     READ_U2_FIELD(cp_index2, "Failed to parse constant pool double index entry.");
     return cp_double_index_entry{cp_index, cp_index2};
 }
 
-cp_methodhandle_info_entry parse_cp_methodhandle_info_entry(std::ifstream& file)
+cp_methodhandle_info_entry parse_cp_methodhandle_info_entry(class_reader& file)
 {
     READ_U1_FIELD(reference_kind, "Failed to parse constant pool method handle entry.");
     READ_U2_FIELD(reference_info, "Failed to parse constant pool method handle entry.");
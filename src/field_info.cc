@@ -17,18 +17,19 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#include <fstream>
 #include <vector>
 
 #include "attribute_info.hh"
+#include "class_reader.hh"
 #include "field_info.hh"
 #include "util.hh"
 
-std::vector<field_info> parse_fields(std::ifstream& file, const constant_pool& cp)
+std::vector<field_info> parse_fields(class_reader& file, const constant_pool& cp)
 {
     std::vector<field_info> fields;
     READ_U2_FIELD(fields_count, "Failed to parse fields count of class file.");
-    for (uint16_t curr_field_idx = 0; curr_field_idx < fields_count; curr_field_idx++)
+    for (uint16_t curr_field_idx = 0; curr_field_idx < fields_count && !file.failed();
+        curr_field_idx++)
     {
         fields.emplace_back(field_info::parse_field(file, cp));
     }
@@ -36,7 +37,7 @@ std::vector<field_info> parse_fields(std::ifstream& file, const constant_pool& c
     return fields;
 }
 
-field_info field_info::parse_field(std::ifstream& file, const constant_pool& cp)
+field_info field_info::parse_field(class_reader& file, const constant_pool& cp)
 {
     READ_U2_FIELD(access_flag_bytes, "Failed to parse access flags of field.");
 
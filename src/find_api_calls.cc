@@ -18,87 +18,647 @@
 */
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <variant>
 #include <vector>
 
+#include "api_rules.hh"
+#include "argument_origins.hh"
 #include "attribute_info.hh"
+#include "bytecode_analysis.hh"
 #include "code_attribute.hh"
 #include "find_api_calls.hh"
 #include "invalid_class_format_exception.hh"
 #include "java_class.hh"
 #include "line_number_table_attribute.hh"
+#include "member_ref_table.hh"
+#include "receiver_types.hh"
+#include "reflection.hh"
+#include "scan_stats.hh"
+#include "symbol_table.hh"
 
-std::optional<api_call_info> get_api_call_info(const constant_pool& cp, uint16_t pc, uint8_t high, uint8_t low,
-    const std::vector<std::string>& apis)
-{
-    constant_pool_entry_id cp_method_ref = (high << 8) + low;
-    auto method_ref = cp.get_entry_as<cp_methodref_info_entry>(cp_method_ref).value();
-    // Extract the class name from the method reference.
-    auto class_ref = cp.get_entry_as<cp_class_info_entry>(method_ref.cp_index).value();
-    auto class_name_utf8_ref = cp.get_entry_as<cp_utf8_entry>(class_ref.cp_index).value();
-    // If the class name matches ones we're looking for, get the method name too, and
-    // return the API handle.
-    auto apis_iter = std::find(apis.cbegin(), apis.cend(), class_name_utf8_ref.value);
-    if (apis_iter != apis.cend())
-    {
-        // Extract the method name from the constant pool.
-        auto name_and_type_ref = cp.get_entry_as<cp_name_and_type_index_entry>(method_ref.cp_index2).value();
-        auto method_name_utf8_ref = cp.get_entry_as<cp_utf8_entry>(name_and_type_ref.cp_index).value();
-        return std::make_optional<api_call_info>({
-            // Store the pc instead of line number for now.
-            pc, class_name_utf8_ref.value + "." + method_name_utf8_ref.value, ""
-        });
+// A matching instruction, with the entry it refers to followed through to what it names.
+struct api_use
+{
+    api_use_kind kind;
+    bytecode_tag instruction;
+    // Set for calls and field accesses, including through a loaded MethodHandle.
+    const resolved_member_ref* member_ref;
+    // Otherwise, the name of the Class or the descriptor of the MethodType.
+    const cp_utf8_entry* type_name;
+};
+
+static std::optional<api_use> resolve_api_use(const java_class& clazz, bytecode_tag instruction,
+    constant_pool_entry_id cp_index, const compiled_api_rules& matching_refs)
+{
+    // Malformed classes can point anywhere; anything outside the table never matches.
+    if (!matching_refs.is_match(cp_index))
+    {
+        return std::nullopt;
+    }
+
+    const auto& cp = clazz.get_class_constant_pool();
+    const auto& member_refs = clazz.get_class_member_refs();
+    const bool is_field_instruction = instruction >= bytecode_tag::GETSTATIC &&
+        instruction <= bytecode_tag::PUTFIELD;
+    const bool is_invoke_instruction = instruction >= bytecode_tag::INVOKEVIRTUAL &&
+        instruction <= bytecode_tag::INVOKEDYNAMIC;
+    const bool is_ldc_instruction = instruction == bytecode_tag::LDC ||
+        instruction == bytecode_tag::LDC_W;
+
+    // Each instruction only matches the kind of entry it can refer to.
+    const resolved_member_ref* member_ref = member_refs.find(cp_index);
+    if (const auto* method_handle = cp.find_entry_as<cp_methodhandle_info_entry>(cp_index,
+        constant_pool_type::MethodHandle); method_handle && is_ldc_instruction)
+    {
+        member_ref = member_refs.find(method_handle->reference_index);
+    }
+    else if (member_ref && (member_ref->type == constant_pool_type::FieldRef
+        ? !is_field_instruction : !is_invoke_instruction))
+    {
+        return std::nullopt;
     }
 
-    return std::nullopt;
+    if (member_ref)
+    {
+        return api_use{member_ref->type == constant_pool_type::FieldRef
+            ? api_use_kind::field_access : api_use_kind::method_call, instruction, member_ref,
+            nullptr};
+    }
+
+    // Every other matching entry is a Class or MethodType naming the type, which are used by the
+    // remaining instructions.
+    if (is_field_instruction || is_invoke_instruction)
+    {
+        return std::nullopt;
+    }
+
+    const auto* type_entry = cp.find_entry_as<cp_index_entry>(cp_index, constant_pool_type::Class);
+    if (!type_entry && is_ldc_instruction)
+    {
+        type_entry = cp.find_entry_as<cp_index_entry>(cp_index, constant_pool_type::MethodType);
+    }
+    const auto* type_name = type_entry
+        ? cp.find_entry_as<cp_utf8_entry>(type_entry->cp_index, constant_pool_type::Utf8)
+        : nullptr;
+    if (!type_name)
+    {
+        return std::nullopt;
+    }
+
+    return api_use{api_use_kind::type_use, instruction, nullptr, type_name};
 }
 
 uint16_t get_line_number(const code_attribute& code, uint16_t pc)
 {
+    SCAN_PHASE(scan_phase::line_resolution);
     for (const auto& code_attr: code.get_code_attributes())
     {
         if (code_attr->get_type() == attribute_info_type::line_number_table)
         {
             const auto& lnt_attr = dynamic_cast<const line_number_table_attribute&>(*code_attr);
-            return *lnt_attr.find_line_number_from_pc(pc);
+            if (auto line_number = lnt_attr.find_line_number_from_pc(pc); line_number)
+            {
+                return *line_number;
+            }
+
+            break;
         }
     }
 
     // Should never reach here.
-    throw invalid_class_format{"Missing `LineNumberTable` attribute in `Code`."};
+    throw invalid_class_format{"Missing `LineNumberTable` entry for call in `Code`."};
     return 0;
 }
 
-std::vector<api_call_info> find_api_calls(const java_class& clazz, const std::vector<std::string>& apis)
+// Returns whether another thread has asked the walks to stop, which they check between methods.
+static bool is_cancelled(const std::atomic<bool>* cancelled)
 {
-    std::vector<api_call_info> calls;
-    const auto& cp = clazz.get_class_constant_pool();
+    return cancelled && cancelled->load(std::memory_order_relaxed);
+}
+
+// Calls `cb(method, code, pc, cp_index, use)` for every instruction of the class matching one of
+// the rules, in method then pc order, until it returns true or `cancelled` is set. Returns whether
+// it stopped early.
+template <typename callback>
+static bool for_each_api_use(const java_class& clazz, const compiled_api_rules& matching_refs,
+    callback&& cb, const std::atomic<bool>* cancelled = nullptr)
+{
+    // Nothing the class refers to is of interest, so none of its code can be.
+    if (matching_refs.empty())
+    {
+        SCAN_COUNT(scan_counter::skipped_methods, clazz.get_class_methods().size());
+        return false;
+    }
+
     for (const method_info& method: clazz.get_class_methods())
     {
+        if (is_cancelled(cancelled))
+        {
+            return true;
+        }
+
         for (const auto& attr: method.get_method_attributes())
         {
             // The `Code` attribute contains raw bytecode and line number information.
             if (attr->get_type() == attribute_info_type::code)
             {
                 const auto& code_attr = dynamic_cast<const code_attribute&>(*attr);
-                const auto instruction_cb = [&](uint16_t pc, uint8_t high, uint8_t low)
+                // Most methods have no instructions of interest; those without so much as a byte
+                // that looks like the opcode of one are ruled out without decoding a single
+                // instruction.
+                if (!(matching_refs.has_member_matches() && code_attr.may_contain_member_access()) &&
+                    !(matching_refs.has_type_matches() && code_attr.may_contain_type_use()))
                 {
-                    if (auto call = get_api_call_info(cp, pc, high, low, apis); call)
-                    {
-                        call->line_number = get_line_number(code_attr, call->line_number);
-                        call->method = method.get_name();
-                        calls.emplace_back(*call);
-                    }
+                    SCAN_COUNT(scan_counter::skipped_methods, 1);
+                    continue;
+                }
+
+                const auto instruction_cb = [&](auto instruction, uint16_t pc,
+                    constant_pool_entry_id cp_index, auto...)
+                {
+                    const auto use = resolve_api_use(clazz, instruction, cp_index, matching_refs);
+                    return use && cb(method, code_attr, pc, cp_index, *use);
                 };
 
-                // Call the callback when an `invokevirtual` instruction is found in bytecode.
-                code_attr.find_instruction<bytecode_tag::INVOKEVIRTUAL>(instruction_cb);
-                // Call the callback when an `invokespecial` instruction is found in bytecode.
-                code_attr.find_instruction<bytecode_tag::INVOKESPECIAL>(instruction_cb);
+                // Field accesses, calls and type uses are all found in a single walk over the
+                // bytecode, in pc order.
+                if (code_attr.find_instructions_until<bytecode_tag::GETSTATIC,
+                    bytecode_tag::PUTSTATIC, bytecode_tag::GETFIELD, bytecode_tag::PUTFIELD,
+                    bytecode_tag::INVOKEVIRTUAL, bytecode_tag::INVOKESPECIAL,
+                    bytecode_tag::INVOKESTATIC, bytecode_tag::INVOKEINTERFACE,
+                    bytecode_tag::INVOKEDYNAMIC, bytecode_tag::NEW,
+                    bytecode_tag::ANEWARRAY, bytecode_tag::CHECKCAST, bytecode_tag::INSTANCEOF,
+                    bytecode_tag::MULTIANEWARRAY, bytecode_tag::LDC, bytecode_tag::LDC_W>(
+                        instruction_cb))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+static api_use_key make_api_use_key(const api_use& use)
+{
+    if (use.member_ref)
+    {
+        return api_use_key{use.kind, bytecode_tag::NOP, use.member_ref->owner_symbol,
+            use.member_ref->name_symbol, use.member_ref->descriptor_symbol};
+    }
+
+    return api_use_key{use.kind, use.instruction, use.type_name->symbol, NO_SYMBOL, NO_SYMBOL};
+}
+
+// A call found in the method at `method_index`, kept with its position to order it among those
+// found by the reflective lookups and by the receivers' types.
+struct located_api_call
+{
+    size_t method_index;
+    uint16_t pc;
+    api_call_info call;
+};
+
+// Calls `cb(method_index, code, target, matches)` for every target of the class's reflective
+// lookups which matches the rules, in method then pc order, until it returns true or `cancelled`
+// is set. Returns whether it stopped early. These are looked for whether or not anything the class
+// refers to directly matched.
+template <typename callback>
+static bool for_each_reflective_use(const java_class& clazz, const api_rule_set& rules,
+    callback&& cb, const std::atomic<bool>* cancelled = nullptr)
+{
+    if (!may_use_reflection(clazz))
+    {
+        return false;
+    }
+
+    const auto& methods = clazz.get_class_methods();
+    for (size_t method_index = 0; method_index < methods.size(); method_index++)
+    {
+        if (is_cancelled(cancelled))
+        {
+            return true;
+        }
+
+        const method_info& method = methods[method_index];
+        for (const auto& attr: method.get_method_attributes())
+        {
+            if (attr->get_type() != attribute_info_type::code)
+            {
+                continue;
+            }
+
+            const auto& code_attr = dynamic_cast<const code_attribute&>(*attr);
+            if (!code_attr.may_contain_member_access())
+            {
+                continue;
+            }
+
+            for (const reflective_target& target : find_reflective_targets(clazz, method,
+                code_attr))
+            {
+                auto matches = rules.match_reflective_target(target.owner, target.name,
+                    target.kind == api_use_kind::field_access);
+                if (!matches.empty() && cb(method_index, code_attr, target, std::move(matches)))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+// Adds the targets of the class's reflective lookups which match the rules.
+static void find_reflective_calls(const java_class& clazz, const api_rule_set& rules,
+    std::vector<located_api_call>& calls)
+{
+    const auto& methods = clazz.get_class_methods();
+    for_each_reflective_use(clazz, rules, [&](size_t method_index, const code_attribute& code_attr,
+        const reflective_target& target, std::vector<rule_match>&& matches)
+    {
+        const method_info& method = methods[method_index];
+        api_call_info call{get_line_number(code_attr, target.pc), target.kind,
+            static_cast<bytecode_tag>(code_attr.get_bytecode()[target.pc]),
+            target.name.empty() ? target.owner : target.owner + "." + target.name, "",
+            method.get_name() + std::string{method.get_descriptor()}, std::move(matches), true};
+        calls.push_back(located_api_call{method_index, target.pc, std::move(call)});
+        return false;
+    });
+}
+
+// Calls `cb(class_name)` with every class named by a field or method descriptor.
+template <typename callback>
+static void for_each_descriptor_class(std::string_view descriptor, callback&& cb)
+{
+    for (size_t start = descriptor.find('L'); start != std::string_view::npos;
+        start = descriptor.find('L', start))
+    {
+        const size_t end = descriptor.find(';', start);
+        if (end == std::string_view::npos)
+        {
+            return;
+        }
+
+        cb(descriptor.substr(start + 1, end - start - 1));
+        start = end + 1;
+    }
+}
+
+// Returns whether a rule covers any class the class's receivers can have a static type of: those
+// it names in Class entries, for `new`, `checkcast` and StackMapTable frames, and in the
+// descriptors of the fields and methods it refers to or declares. Descriptors are all Utf8
+// entries, so the constant pool alone tells.
+static bool may_match_receiver_types(const java_class& clazz, const api_rule_set& rules)
+{
+    const constant_pool& cp = clazz.get_class_constant_pool();
+    bool found = false;
+    for (const auto& [entry_id, entry_data] : cp)
+    {
+        const auto* class_ref = std::get_if<cp_index_entry>(&entry_data.entry);
+        const auto* class_name = class_ref && entry_data.type == constant_pool_type::Class
+            ? cp.find_entry_as<cp_utf8_entry>(class_ref->cp_index, constant_pool_type::Utf8)
+            : nullptr;
+        if (class_name && !class_name->value.empty() && class_name->value.front() != '[' &&
+            rules.has_owner_rules(class_name->value))
+        {
+            return true;
+        }
+
+        // Anything else starting like a descriptor is looked at as one; a string that merely
+        // looks like one only costs a needless pass.
+        const auto* utf8 = std::get_if<cp_utf8_entry>(&entry_data.entry);
+        if (utf8 && !utf8->value.empty() && (utf8->value.front() == '(' ||
+            utf8->value.front() == 'L' || utf8->value.front() == '['))
+        {
+            for_each_descriptor_class(utf8->value, [&](std::string_view descriptor_class)
+            {
+                found = found || rules.has_owner_rules(descriptor_class);
+            });
+            if (found)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Calls `cb(method_index, code, receiver, member_ref, matches)` for every call which matches the
+// rules by the class of its receiver, as found from the types of the stack at each call, but not
+// by the class the instruction refers to: `List.add` called on an `ArrayList` the method created
+// matches rules for `ArrayList.add`. Goes in method then pc order until `cb` returns true or
+// `cancelled` is set, and returns whether it stopped early.
+template <typename callback>
+static bool for_each_receiver_use(const java_class& clazz, const api_rule_set& rules,
+    const compiled_api_rules& matching_refs, callback&& cb,
+    const std::atomic<bool>* cancelled = nullptr)
+{
+    if (!may_match_receiver_types(clazz, rules))
+    {
+        return false;
+    }
+
+    const member_ref_table& member_refs = clazz.get_class_member_refs();
+    const auto& methods = clazz.get_class_methods();
+    for (size_t method_index = 0; method_index < methods.size(); method_index++)
+    {
+        if (is_cancelled(cancelled))
+        {
+            return true;
+        }
+
+        const method_info& method = methods[method_index];
+        for (const auto& attr: method.get_method_attributes())
+        {
+            if (attr->get_type() != attribute_info_type::code)
+            {
+                continue;
+            }
+
+            const auto& code_attr = dynamic_cast<const code_attribute&>(*attr);
+            if (!code_attr.may_contain_member_access())
+            {
+                continue;
+            }
+
+            for (const receiver_type& receiver : find_receiver_types(clazz, method, code_attr))
+            {
+                const uint8_t* instruction = &code_attr.get_bytecode()[receiver.pc];
+                const auto cp_index = read_u2_operand(instruction + 1);
+                // Calls matching by the class they refer to are already reported as such.
+                if (matching_refs.is_match(cp_index))
+                {
+                    continue;
+                }
+
+                const resolved_member_ref* member_ref = member_refs.find(cp_index);
+                auto matches = rules.match_receiver_call(receiver.type, member_ref->name,
+                    member_ref->descriptor);
+                if (!matches.empty() &&
+                    cb(method_index, code_attr, receiver, *member_ref, std::move(matches)))
+                {
+                    return true;
+                }
             }
         }
     }
 
+    return false;
+}
+
+// Adds the calls which match the rules by the class of their receiver alone.
+static void find_receiver_calls(const java_class& clazz, const api_rule_set& rules,
+    const compiled_api_rules& matching_refs, std::vector<located_api_call>& calls)
+{
+    const auto& methods = clazz.get_class_methods();
+    for_each_receiver_use(clazz, rules, matching_refs, [&](size_t method_index,
+        const code_attribute& code_attr, const receiver_type& receiver,
+        const resolved_member_ref& member_ref, std::vector<rule_match>&& matches)
+    {
+        const method_info& method = methods[method_index];
+        api_call_info call{get_line_number(code_attr, receiver.pc), api_use_kind::method_call,
+            static_cast<bytecode_tag>(code_attr.get_bytecode()[receiver.pc]),
+            std::string{receiver.type} + "." + std::string{member_ref.name},
+            std::string{member_ref.descriptor},
+            method.get_name() + std::string{method.get_descriptor()}, std::move(matches), false,
+            std::string{member_ref.owner}};
+        calls.push_back(located_api_call{method_index, receiver.pc, std::move(call)});
+        return false;
+    });
+}
+
+// Labels the arguments of the calls found in each method, which are in method then pc order. Only
+// methods with such a call are looked at.
+static void find_call_argument_origins(const java_class& clazz,
+    std::vector<located_api_call>& calls)
+{
+    const auto& methods = clazz.get_class_methods();
+    std::vector<uint16_t> call_pcs;
+    std::vector<api_call_info*> method_calls;
+    for (size_t first = 0, last = 0; first < calls.size(); first = last)
+    {
+        const size_t method_index = calls[first].method_index;
+        call_pcs.clear();
+        method_calls.clear();
+        for (; last < calls.size() && calls[last].method_index == method_index; last++)
+        {
+            // The target of a reflective lookup isn't called by the lookup itself.
+            api_call_info& call = calls[last].call;
+            if (call.kind == api_use_kind::method_call && !call.reflective)
+            {
+                call_pcs.push_back(calls[last].pc);
+                method_calls.push_back(&call);
+            }
+        }
+
+        if (call_pcs.empty())
+        {
+            continue;
+        }
+
+        const method_info& method = methods[method_index];
+        for (const auto& attr: method.get_method_attributes())
+        {
+            if (attr->get_type() == attribute_info_type::code)
+            {
+                auto origins = find_argument_origins(clazz, method,
+                    dynamic_cast<const code_attribute&>(*attr), call_pcs);
+                for (size_t idx = 0; idx < method_calls.size(); idx++)
+                {
+                    method_calls[idx]->argument_origins = std::move(origins[idx]);
+                }
+
+                break;
+            }
+        }
+    }
+}
+
+std::vector<api_call_info> find_api_calls(const java_class& clazz, const api_rule_set& rules,
+    bool with_argument_origins)
+{
+    SCAN_PHASE(scan_phase::bytecode);
+    std::vector<located_api_call> located_calls;
+    const compiled_api_rules matching_refs = rules.compile(clazz.get_class_constant_pool(),
+        clazz.get_class_member_refs());
+    const method_info* const first_method = clazz.get_class_methods().data();
+    for_each_api_use(clazz, matching_refs, [&](const method_info& method,
+        const code_attribute& code_attr, uint16_t pc, constant_pool_entry_id cp_index,
+        const api_use& use)
+    {
+        api_call_info call{get_line_number(code_attr, pc), use.kind, use.instruction, "", "",
+            method.get_name() + std::string{method.get_descriptor()},
+            matching_refs.get_matches(cp_index)};
+        if (use.member_ref)
+        {
+            call.api_str = std::string{use.member_ref->owner} + "." +
+                std::string{use.member_ref->name};
+            call.descriptor = use.member_ref->descriptor;
+        }
+        else
+        {
+            call.api_str = use.type_name->value;
+        }
+
+        located_calls.push_back(located_api_call{static_cast<size_t>(&method - first_method), pc,
+            std::move(call)});
+        return false;
+    });
+
+    // Each pass finds its calls in method then pc order, and each is merged into those found before
+    // it; a lookup's target follows the lookup call itself.
+    const auto merge_calls = [&](size_t earlier_calls)
+    {
+        std::inplace_merge(located_calls.begin(), located_calls.begin() + earlier_calls,
+            located_calls.end(), [](const located_api_call& a, const located_api_call& b)
+        {
+            return std::tie(a.method_index, a.pc) < std::tie(b.method_index, b.pc);
+        });
+    };
+
+    const size_t instruction_calls = located_calls.size();
+    find_reflective_calls(clazz, rules, located_calls);
+    merge_calls(instruction_calls);
+    const size_t earlier_calls = located_calls.size();
+    find_receiver_calls(clazz, rules, matching_refs, located_calls);
+    merge_calls(earlier_calls);
+    if (with_argument_origins)
+    {
+        find_call_argument_origins(clazz, located_calls);
+    }
+
+    std::vector<api_call_info> calls;
+    calls.reserve(located_calls.size());
+    for (located_api_call& located_call : located_calls)
+    {
+        calls.push_back(std::move(located_call.call));
+    }
+
     return calls;
 }
+
+// Reflective lookups are told apart from the uses the class makes directly. The descriptor of a
+// member found this way isn't known.
+static api_use_key make_reflective_use_key(const reflective_target& target)
+{
+    symbol_table& symbols = symbol_table::instance();
+    return api_use_key{target.kind, bytecode_tag::NOP, symbols.intern(target.owner),
+        target.name.empty() ? NO_SYMBOL : symbols.intern(target.name), NO_SYMBOL, true};
+}
+
+// Calls matched by the class of their receiver are counted as calls of that class's method.
+static api_use_key make_receiver_use_key(const receiver_type& receiver,
+    const resolved_member_ref& member_ref)
+{
+    return api_use_key{api_use_kind::method_call, bytecode_tag::NOP,
+        symbol_table::instance().intern(receiver.type), member_ref.name_symbol,
+        member_ref.descriptor_symbol};
+}
+
+bool may_find_api_uses(const java_class& clazz, const api_rule_set& rules,
+    const compiled_api_rules& matching_refs)
+{
+    return !matching_refs.empty() || may_use_reflection(clazz) ||
+        may_match_receiver_types(clazz, rules);
+}
+
+size_t count_api_uses(const java_class& clazz, const api_rule_set& rules, api_use_counts& counts)
+{
+    size_t uses = 0;
+    SCAN_PHASE(scan_phase::bytecode);
+    const compiled_api_rules matching_refs = rules.compile(clazz.get_class_constant_pool(),
+        clazz.get_class_member_refs());
+    for_each_api_use(clazz, matching_refs, [&](const method_info&, const code_attribute&,
+        uint16_t, constant_pool_entry_id, const api_use& use)
+    {
+        counts[make_api_use_key(use)]++;
+        uses++;
+        return false;
+    });
+
+    for_each_reflective_use(clazz, rules, [&](size_t, const code_attribute&,
+        const reflective_target& target, std::vector<rule_match>&&)
+    {
+        counts[make_reflective_use_key(target)]++;
+        uses++;
+        return false;
+    });
+
+    for_each_receiver_use(clazz, rules, matching_refs, [&](size_t, const code_attribute&,
+        const receiver_type& receiver, const resolved_member_ref& member_ref,
+        std::vector<rule_match>&&)
+    {
+        counts[make_receiver_use_key(receiver, member_ref)]++;
+        uses++;
+        return false;
+    });
+
+    return uses;
+}
+
+std::optional<api_use_key> find_first_api_use(const java_class& clazz, const api_rule_set& rules,
+    const compiled_api_rules& matching_refs, const std::atomic<bool>* cancelled)
+{
+    SCAN_PHASE(scan_phase::bytecode);
+    std::optional<api_use_key> first_use;
+    for_each_api_use(clazz, matching_refs, [&](const method_info&, const code_attribute&, uint16_t,
+        constant_pool_entry_id, const api_use& use)
+    {
+        first_use = make_api_use_key(use);
+        return true;
+    }, cancelled);
+
+    // The passes following values through the stack only run when the walk found nothing.
+    if (!first_use)
+    {
+        for_each_reflective_use(clazz, rules, [&](size_t, const code_attribute&,
+            const reflective_target& target, std::vector<rule_match>&&)
+        {
+            first_use = make_reflective_use_key(target);
+            return true;
+        }, cancelled);
+    }
+
+    if (!first_use)
+    {
+        for_each_receiver_use(clazz, rules, matching_refs, [&](size_t, const code_attribute&,
+            const receiver_type& receiver, const resolved_member_ref& member_ref,
+            std::vector<rule_match>&&)
+        {
+            first_use = make_receiver_use_key(receiver, member_ref);
+            return true;
+        }, cancelled);
+    }
+
+    return first_use;
+}
+
+std::string get_api_use_name(const api_use_key& key)
+{
+    const symbol_table& symbols = symbol_table::instance();
+    if (key.reflective)
+    {
+        return "reflection " + std::string{symbols.get_name(key.owner)} +
+            (key.name == NO_SYMBOL ? "" : "." + std::string{symbols.get_name(key.name)});
+    }
+
+    if (key.kind == api_use_kind::type_use)
+    {
+        return std::string{get_instruction_name(key.instruction)} + " " +
+            std::string{symbols.get_name(key.owner)};
+    }
+
+    return std::string{symbols.get_name(key.owner)} + "." + std::string{symbols.get_name(key.name)} +
+        (key.kind == api_use_kind::field_access ? ":" : "") +
+        std::string{symbols.get_name(key.descriptor)};
+}
@@ -0,0 +1,123 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "attribute_info.hh"
+#include "code_attribute.hh"
+#include "find_api_calls.hh"
+#include "find_strings.hh"
+#include "modified_utf8.hh"
+#include "scan_stats.hh"
+
+std::vector<string_indicator_info> match_string_constants(const constant_pool& cp,
+    const string_pattern_set& patterns)
+{
+    SCAN_PHASE(scan_phase::strings);
+    // The DFA is built as strings are matched, so each thread keeps its own and reuses it for
+    // every class.
+    thread_local std::unique_ptr<string_matcher> matcher;
+    if (!matcher || &matcher->get_patterns() != &patterns)
+    {
+        matcher = std::make_unique<string_matcher>(patterns);
+    }
+
+    std::vector<string_indicator_info> indicators;
+    std::vector<uint32_t> matched;
+    for (const auto& [entry_id, entry_data] : cp)
+    {
+        if (entry_data.type != constant_pool_type::Utf8)
+        {
+            continue;
+        }
+
+        const auto& utf8_entry = std::get<cp_utf8_entry>(entry_data.entry);
+        matcher->match(utf8_entry.value, matched);
+        if (!matched.empty())
+        {
+            indicators.push_back(string_indicator_info{entry_id,
+                modified_utf8_to_utf8(utf8_entry.value), matched, {}});
+        }
+    }
+
+    return indicators;
+}
+
+void find_string_uses(const java_class& clazz, std::vector<string_indicator_info>& indicators)
+{
+    SCAN_PHASE(scan_phase::bytecode);
+    // The String entries wrapping the matched Utf8 entries, which is what `ldc` refers to.
+    std::unordered_map<constant_pool_entry_id, size_t> utf8_indicators, string_indicators;
+    for (size_t i = 0; i < indicators.size(); i++)
+    {
+        utf8_indicators.emplace(indicators[i].cp_index, i);
+    }
+
+    const auto& cp = clazz.get_class_constant_pool();
+    for (const auto& [entry_id, entry_data] : cp)
+    {
+        if (entry_data.type == constant_pool_type::String)
+        {
+            const auto& string_entry = std::get<cp_index_entry>(entry_data.entry);
+            if (const auto it = utf8_indicators.find(string_entry.cp_index);
+                it != utf8_indicators.end())
+            {
+                string_indicators.emplace(entry_id, it->second);
+            }
+        }
+    }
+
+    // Names and descriptors are never loaded, so there is nothing to look for.
+    if (string_indicators.empty())
+    {
+        return;
+    }
+
+    for (const method_info& method : clazz.get_class_methods())
+    {
+        for (const auto& attr : method.get_method_attributes())
+        {
+            if (attr->get_type() != attribute_info_type::code)
+            {
+                continue;
+            }
+
+            const auto& code_attr = dynamic_cast<const code_attribute&>(*attr);
+            if (!code_attr.may_contain_type_use())
+            {
+                SCAN_COUNT(scan_counter::skipped_methods, 1);
+                continue;
+            }
+
+            code_attr.find_instructions<bytecode_tag::LDC, bytecode_tag::LDC_W>(
+                [&](auto, uint16_t pc, auto cp_index)
+            {
+                if (const auto it = string_indicators.find(cp_index); it != string_indicators.end())
+                {
+                    indicators[it->second].uses.push_back(string_use_info{
+                        get_line_number(code_attr, pc),
+                        method.get_name() + std::string{method.get_descriptor()}});
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,130 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+
+#include "bytecode.hh"
+#include "bytecode_analysis.hh"
+#include "instruction_index.hh"
+
+uint32_t get_instruction_length(const uint8_t* bytecode, uint32_t code_length, uint32_t pc)
+{
+    if (bytecode[pc] >= TOTAL_BYTECODE_INSTRUCTIONS)
+    {
+        return 0;
+    }
+
+    const bytecode_tag instr = static_cast<bytecode_tag>(bytecode[pc]);
+    // Computed in 64 bits so that hostile jump table sizes cannot wrap around.
+    int64_t length = get_instruction_size(instr);
+    if (instr == bytecode_tag::LOOKUPSWITCH || instr == bytecode_tag::TABLESWITCH)
+    {
+        // Operands start at the first address after the opcode that is a multiple of 4.
+        const int64_t operands = (static_cast<int64_t>(pc) + 4) & ~int64_t{3};
+        // `default` followed by `npairs`, or by `low` and `high`.
+        const int64_t header_end = operands + (instr == bytecode_tag::LOOKUPSWITCH ? 8 : 12);
+        if (header_end > code_length)
+        {
+            return 0;
+        }
+
+        int64_t entries_size = 0;
+        if (instr == bytecode_tag::LOOKUPSWITCH)
+        {
+            // Each match-offset pair consists of two 4-byte ints.
+            const int64_t npairs = read_s4_operand(&bytecode[operands + 4]);
+            entries_size = 8 * npairs;
+        }
+        else
+        {
+            // There are `high - low + 1` signed integer offsets.
+            const int64_t low = read_s4_operand(&bytecode[operands + 4]);
+            const int64_t high = read_s4_operand(&bytecode[operands + 8]);
+            entries_size = 4 * (high - low + 1);
+        }
+
+        if (entries_size < 0)
+        {
+            return 0;
+        }
+
+        length = header_end + entries_size - pc;
+    }
+    else if (instr == bytecode_tag::WIDE)
+    {
+        if (pc + 1 >= code_length)
+        {
+            return 0;
+        }
+
+        // `wide iinc` carries a 2-byte index and a 2-byte constant, the loads, stores and `ret`
+        // only the index. No other instruction can be widened.
+        switch (static_cast<bytecode_tag>(bytecode[pc + 1]))
+        {
+            case bytecode_tag::IINC:
+                length = 6;
+                break;
+            case bytecode_tag::ILOAD:
+            case bytecode_tag::LLOAD:
+            case bytecode_tag::FLOAD:
+            case bytecode_tag::DLOAD:
+            case bytecode_tag::ALOAD:
+            case bytecode_tag::ISTORE:
+            case bytecode_tag::LSTORE:
+            case bytecode_tag::FSTORE:
+            case bytecode_tag::DSTORE:
+            case bytecode_tag::ASTORE:
+            case bytecode_tag::RET:
+                length = 4;
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    if (length == 0 || pc + length > code_length)
+    {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(length);
+}
+
+instruction_index::instruction_index(const uint8_t* bytecode, uint32_t code_length)
+{
+    // Every iteration advances `pc` by at least one byte, so building the index is linear in the
+    // code length no matter what the operands claim.
+    for (uint32_t pc = 0; pc < code_length;)
+    {
+        const uint32_t curr_instr_length = get_instruction_length(bytecode, code_length, pc);
+        if (!curr_instr_length)
+        {
+            malformed_pc = pc;
+            break;
+        }
+
+        // The code length is at most 65535, so every offset fits.
+        offsets.push_back(static_cast<uint16_t>(pc));
+        pc += curr_instr_length;
+    }
+}
+
+bool instruction_index::is_instruction_start(uint32_t pc) const
+{
+    return std::binary_search(offsets.cbegin(), offsets.cend(), pc);
+}
@@ -18,13 +18,16 @@
 */
 
 #include <fstream>
+#include <variant>
 #include <vector>
 
+#include "class_reader.hh"
 #include "constant_pool.hh"
 #include "field_info.hh"
 #include "invalid_class_format_exception.hh"
 #include "java_class.hh"
 #include "method_info.hh"
+#include "scan_stats.hh"
 #include "util.hh"
 
 constexpr const uint32_t CLASS_MAGIC_NUMBER = 0xCAFEBABE;
@@ -35,19 +38,87 @@ struct version_info
     uint16_t major_version;
 };
 
+static java_class unwrap_parse_result(parse_result<java_class> result)
+{
+    if (const auto* error = std::get_if<class_parse_error>(&result))
+    {
+        throw invalid_class_format{error->message};
+    }
+
+    return std::move(std::get<java_class>(result));
+}
+
 java_class java_class::parse_class_file(const std::string& path)
 {
-    std::ifstream file {path, std::ios::binary};
+    return unwrap_parse_result(try_parse_class_file(path));
+}
+
+java_class java_class::parse_class_bytes(const uint8_t* data, size_t size)
+{
+    return unwrap_parse_result(try_parse_class_bytes(data, size));
+}
+
+bool java_class::is_class_file(const uint8_t* data, size_t size)
+{
+    class_reader file {data, size};
+    READ_U4_FIELD(magic_number, "Failed to parse magic number.");
+    return !file.failed() && magic_number == CLASS_MAGIC_NUMBER;
+}
+
+parse_result<std::vector<uint8_t>> java_class::try_read_class_file(const std::string& path)
+{
+    SCAN_PHASE(scan_phase::io);
+    std::ifstream file {path, std::ios::binary | std::ios::ate};
     if (!file.is_open())
     {
-        throw std::ios_base::failure{"Classfile not found at " + path};
+        return class_parse_error{"Failed to open class file.", 0};
+    }
+
+    // Streams which can't be seeked have no size, and directories open fine but report a bogus
+    // one and fail on the first read, so both are caught before allocating anything.
+    const std::streamoff size = file.tellg();
+    file.seekg(0);
+    if (size < 0 || (size > 0 && file.peek() == std::ifstream::traits_type::eof()))
+    {
+        return class_parse_error{"Failed to read class file.", 0};
+    }
+
+    // Read the whole classfile up front; the parsers then work on memory only.
+    std::vector<uint8_t> contents(static_cast<size_t>(size));
+    if (!file.read(reinterpret_cast<char*>(contents.data()), contents.size()) ||
+        file.gcount() != size)
+    {
+        return class_parse_error{"Failed to read class file.", 0};
     }
 
+    SCAN_COUNT(scan_counter::input_bytes, contents.size());
+    return contents;
+}
+
+parse_result<java_class> java_class::try_parse_class_file(const std::string& path,
+    const parse_filter& filter)
+{
+    const auto contents = try_read_class_file(path);
+    if (const auto* error = std::get_if<class_parse_error>(&contents))
+    {
+        return *error;
+    }
+
+    const auto& bytes = std::get<std::vector<uint8_t>>(contents);
+    return try_parse_class_bytes(bytes.data(), bytes.size(), filter);
+}
+
+parse_result<java_class> java_class::try_parse_class_bytes(const uint8_t* data, size_t size,
+    const parse_filter& filter)
+{
+    SCAN_COUNT(scan_counter::classes, 1);
+    class_reader file {data, size};
+
     READ_U4_FIELD(magic_number, "Failed to parse magic number.");
     // Either a malformed Java classfile or not one at all.
     if (magic_number != CLASS_MAGIC_NUMBER)
     {
-        throw invalid_class_format{"Parsed magic number does not match Java classfile."};
+        return class_parse_error{"Parsed magic number does not match Java classfile.", 0};
     }
 
     // TODO needs to convert values to LE.
@@ -55,11 +126,13 @@ java_class java_class::parse_class_file(const std::string& path)
     constexpr size_t VERSION_INFO_LENGTH = 4;
     if (!file.read(reinterpret_cast<char*>(&version_info), VERSION_INFO_LENGTH))
     {
-        throw invalid_class_format{"Failed to parse version info of class file."};
+        file.fail("Failed to parse version info of class file.");
     }
 
     constant_pool constant_pool = constant_pool::parse_constant_pool(file);
 
+    SCAN_PHASE(scan_phase::attributes);
+
     READ_U2_FIELD(access_flag_bytes, "Failed to parse access flags of class file.");
     auto access_flags = classfile_access_flag{access_flag_bytes};
 
@@ -67,20 +140,30 @@ java_class java_class::parse_class_file(const std::string& path)
     READ_U2_FIELD(super_index, "Failed to parse `super` index of class file.");
     READ_U2_FIELD(interface_count, "Failed to parse interface count of class file.");
 
-    std::vector<constant_pool_entry_id> interfaces_ids;
-    for (uint16_t curr_interface_idx = 0; curr_interface_idx < interface_count;
-        curr_interface_idx++)
-    {
-        READ_U2_FIELD(entry_id, "Failed to parse interface id of class file.");
-        interfaces_ids.push_back(entry_id);
-    }
+    READ_U2_ARRAY_FIELD(interfaces_ids, interface_count, "Failed to parse interface ids of class "
+        "file.");
 
     auto class_instance = java_class{
         std::move(constant_pool), access_flags, this_index, super_index, std::move(interfaces_ids)
     };
-    class_instance.fields = parse_fields(file, class_instance.cp);
-    class_instance.methods = parse_methods(file, class_instance.cp);
-    class_instance.attributes = parse_attributes(file, class_instance.cp);
+    if (file.failed())
+    {
+        return *file.get_error();
+    }
+
+    if (filter && !filter(class_instance))
+    {
+        return class_instance;
+    }
+
+    class_instance.fields = parse_fields(file, *class_instance.cp);
+    class_instance.methods = parse_methods(file, *class_instance.cp);
+    class_instance.attributes = parse_attributes(file, *class_instance.cp);
+    if (file.failed())
+    {
+        return *file.get_error();
+    }
+
     return class_instance;
 }
 
@@ -88,7 +171,8 @@ java_class::java_class(constant_pool cp, classfile_access_flag access_flags,
     constant_pool_entry_id this_index, constant_pool_entry_id super_index,
     std::vector<constant_pool_entry_id> interfaces_ids, std::vector<field_info> fields,
     std::vector<method_info> methods, entry_attributes attributes) :
-        cp{std::move(cp)},
+        cp{std::make_unique<constant_pool>(std::move(cp))},
+        member_refs{*this->cp},
         access_flags{access_flags},
         this_index{this_index},
         super_index{super_index},
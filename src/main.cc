@@ -18,30 +18,46 @@
 */
 
 #include <algorithm>
+#include <atomic>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "cxxopts.hh"
 
+#include "alloc_stats.hh"
+#include "api_rules.hh"
+#include "argument_origins.hh"
 #include "find_api_calls.hh"
+#include "find_strings.hh"
 #include "invalid_class_format_exception.hh"
 #include "java_class.hh"
+#include "member_ref_table.hh"
+#include "modified_utf8.hh"
+#include "reflection.hh"
+#include "rule_pack.hh"
+#include "scan_stats.hh"
+#include "string_patterns.hh"
 
 void denormalize_api_names(std::vector<std::string>& apis)
 {
     std::for_each(apis.begin(), apis.end(), [](std::string& api)
     {
-        std::replace(api.begin(), api.end(), '.', '/');
-        api.erase(std::remove(api.begin(), api.end(), ' '), api.end());
+        api = normalize_api_rule(api);
     });
 }
 
-void do_dump_cp(const java_class& clazz)
+void do_dump_cp(const java_class& clazz, std::ostream& out)
 {
     std::vector<std::string> id_col, entry_col, pointed_col;
     const auto& constant_pool = clazz.get_class_constant_pool();
@@ -58,7 +74,7 @@ void do_dump_cp(const java_class& clazz)
             if constexpr (std::is_same_v<cp_entry_type, cp_utf8_entry>)
             {
                 id_str << "Utf8";
-                entry_str << arg.value;
+                entry_str << modified_utf8_to_utf8(arg.value);
             }
             else if constexpr (std::is_same_v<cp_entry_type, cp_integer_entry>)
             {
@@ -94,8 +110,10 @@ void do_dump_cp(const java_class& clazz)
                 entry_str << "#" << arg.cp_index;
 
                 // Class, String, and MethodType all point to a Utf8 index.
-                auto utf8_entry = constant_pool.get_entry_as<cp_utf8_entry>(arg.cp_index).value();
-                pointed_str << "-> " << utf8_entry.value;
+                const auto* utf8_entry = constant_pool.find_entry_as<cp_utf8_entry>(arg.cp_index,
+                    constant_pool_type::Utf8);
+                pointed_str << "-> "
+                    << (utf8_entry ? modified_utf8_to_utf8(utf8_entry->value) : "<invalid>");
             }
             else if constexpr (std::is_same_v<cp_entry_type, cp_double_index_entry>)
             {
@@ -113,47 +131,37 @@ void do_dump_cp(const java_class& clazz)
                 entry_str << "#" << arg.cp_index << ":#" << arg.cp_index2;
                 pointed_str << "-> ";
 
-                // These are used to allow the NameAndType entry logic to be reused for
-                // entries that have it as their second constant pool operand.
-                constant_pool_type current_entry_type = entry_type;
-                cp_double_index_entry current_entry = arg;
-
                 // FieldRef, MethodRef, and InterfaceMethodRef point to a Class entry and
-                // NameAndType entry.
-                if (current_entry_type == constant_pool_type::FieldRef ||
-                    current_entry_type == constant_pool_type::MethodRef ||
-                    current_entry_type == constant_pool_type::InterfaceMethodRef)
+                // NameAndType entry, which the class has already resolved.
+                std::optional<std::pair<std::string_view, std::string_view>> name_and_type;
+                if (const auto* member_ref = clazz.get_class_member_refs().find(entry_id))
                 {
-                    // Get Class entry.
-                    auto class_entry =
-                        constant_pool.get_entry_as<cp_class_info_entry>(current_entry.cp_index).value();
-                    // From the Class entry, get the Utf8 entry.
-                    auto utf8_entry =
-                        constant_pool.get_entry_as<cp_utf8_entry>(class_entry.cp_index).value();
-                    pointed_str << utf8_entry.value << ".";
-
-                    // To avoid repeating code, set the current entry to the NameAndType
-                    // entry.
-                    current_entry_type = constant_pool_type::NameAndType;
-                    current_entry =
-                        constant_pool.get_entry_as<cp_double_index_entry>(current_entry.cp_index2).value();
+                    pointed_str << member_ref->owner << ".";
+                    name_and_type.emplace(member_ref->name, member_ref->descriptor);
                 }
-
-                // NameAndType points to two Utf8 entries.
-                if (current_entry_type == constant_pool_type::NameAndType)
+                else if (entry_type == constant_pool_type::NameAndType)
                 {
-                    // Pull out the the Utf8 entries from NameAndType (respectively).
-                    auto name_utf8_entry =
-                        constant_pool.get_entry_as<cp_utf8_entry>(current_entry.cp_index).value();
-                    auto type_utf8_entry =
-                        constant_pool.get_entry_as<cp_utf8_entry>(current_entry.cp_index2).value();
+                    // NameAndType points to two Utf8 entries.
+                    const auto* name_utf8_entry = constant_pool.find_entry_as<cp_utf8_entry>(
+                        arg.cp_index, constant_pool_type::Utf8);
+                    const auto* type_utf8_entry = constant_pool.find_entry_as<cp_utf8_entry>(
+                        arg.cp_index2, constant_pool_type::Utf8);
+                    if (name_utf8_entry && type_utf8_entry)
+                    {
+                        name_and_type.emplace(name_utf8_entry->value, type_utf8_entry->value);
+                    }
+                }
 
+                if (name_and_type)
+                {
                     // `<init>` has quotes around it according to Java's tool; follow
                     // their format.
-                    std::string normalize_init = name_utf8_entry.value == "<init>"
-                        ? "\"<init>\""
-                        : name_utf8_entry.value;
-                    pointed_str << normalize_init << ":" << type_utf8_entry.value;
+                    const auto& [name, type] = *name_and_type;
+                    pointed_str << (name == "<init>" ? "\"<init>\"" : name) << ":" << type;
+                }
+                else if (entry_type != constant_pool_type::InvokeDynamic)
+                {
+                    pointed_str << "<invalid>";
                 }
             }
         }, entry_data.entry);
@@ -184,7 +192,7 @@ void do_dump_cp(const java_class& clazz)
 
     for (size_t i = 0; i < id_col.size(); i++)
     {
-        std::cout
+        out
             << std::left
             << std::setw(id_col_longest + 1) << id_col[i]
             << std::setw(entry_col_longest + 1) << entry_col[i]
@@ -193,69 +201,615 @@ void do_dump_cp(const java_class& clazz)
     }
 }
 
-void do_dump_class(const java_class& clazz)
+void do_dump_class(const java_class& clazz, std::ostream& out)
 {
     const std::vector<method_info>& methods = clazz.get_class_methods();
     for (const auto& method : methods)
     {
         std::string method_name = method.get_name();
-        std::cout << method_name << ":" << std::endl;
+        out << method_name << ":" << std::endl;
 
         const entry_attributes& attributes = method.get_method_attributes();
         for (const auto& attribute : attributes)
         {
-            std::cout << static_cast<int>(attribute->get_type()) << std::endl;
+            out << static_cast<int>(attribute->get_type()) << std::endl;
         }
 
-        std::cout << std::endl;
+        out << std::endl;
     }
 }
 
-void do_scan(const java_class& clazz, const std::string& class_name, const std::vector<std::string>& api_names)
+void print_api_calls(const std::string& class_name, const std::vector<api_call_info>& calls,
+    std::ostream& out)
 {
-    std::cout << "Found the following API calls in " << class_name << ":" << std::endl;
-    const auto calls = find_api_calls(clazz, api_names);
+    SCAN_PHASE(scan_phase::output);
+    out << "Found the following API calls in " << class_name << ":" << std::endl;
     for (const auto& call : calls)
     {
-        std::cout << '\t' << call.api_str << " in method " << call.method << " on line " <<
-            call.line_number << std::endl;
+        // Calls and field accesses speak for themselves; other uses are named by their
+        // instruction, e.g. `new java/net/Socket`.
+        out << '\t';
+        if (call.reflective)
+        {
+            out << "reflection ";
+        }
+        else if (call.instruction < bytecode_tag::GETSTATIC ||
+            call.instruction > bytecode_tag::INVOKEDYNAMIC)
+        {
+            out << get_instruction_name(call.instruction) << ' ';
+        }
+
+        out << call.api_str
+            << (call.kind == api_use_kind::field_access && !call.descriptor.empty() ? ":" : "")
+            << call.descriptor;
+        if (!call.declared_owner.empty())
+        {
+            out << " through " << call.declared_owner;
+        }
+
+        out << " in method " << call.method << " on line " << call.line_number;
+        for (size_t idx = 0; idx < call.argument_origins.size(); idx++)
+        {
+            out << (idx ? ", " : " (arguments: ")
+                << get_argument_origin_name(call.argument_origins[idx]);
+        }
+
+        out << (call.argument_origins.empty() ? "" : ")");
+        // Rules from a rule pack also say why the call was reported.
+        bool tagged = false;
+        for (const auto& match : call.matches)
+        {
+            if (match.severity != rule_severity::none)
+            {
+                out << (tagged ? ", " : " [") << match.category << "/"
+                    << get_rule_severity_name(match.severity);
+                tagged = true;
+            }
+        }
+
+        out << (tagged ? "]" : "") << std::endl;
+    }
+}
+
+void do_scan(const java_class& clazz, const std::string& class_name, const api_rule_set& rules,
+    bool with_argument_origins, std::ostream& out)
+{
+    const auto calls = find_api_calls(clazz, rules, with_argument_origins);
+    SCAN_COUNT(scan_counter::findings, calls.size());
+    print_api_calls(class_name, calls, out);
+}
+
+// Lists the classes and members the class refers to, read off its constant pool alone. With rules,
+// only those matching one are listed.
+void do_list_refs(const java_class& clazz, const std::string& class_name,
+    const api_rule_set& rules, bool has_rules, std::ostream& out)
+{
+    const auto& cp = clazz.get_class_constant_pool();
+    const auto& member_refs = clazz.get_class_member_refs();
+    std::optional<compiled_api_rules> matching_refs;
+    if (has_rules)
+    {
+        matching_refs.emplace(rules.compile(cp, member_refs));
+        if (matching_refs->empty())
+        {
+            return;
+        }
+    }
+
+    const auto is_listed = [&](constant_pool_entry_id index)
+    {
+        return !matching_refs || matching_refs->is_match(index);
+    };
+
+    SCAN_PHASE(scan_phase::output);
+    size_t refs = 0;
+    out << "Found the following references in " << class_name << ":" << std::endl;
+    for (const auto& [entry_id, entry_data] : cp)
+    {
+        // The class referring to itself says nothing about what it uses.
+        if (entry_data.type != constant_pool_type::Class ||
+            entry_id == clazz.get_class_this_index() || !is_listed(entry_id))
+        {
+            continue;
+        }
+
+        const auto* class_entry = cp.find_entry_as<cp_index_entry>(entry_id,
+            constant_pool_type::Class);
+        const auto* name_entry = class_entry
+            ? cp.find_entry_as<cp_utf8_entry>(class_entry->cp_index, constant_pool_type::Utf8)
+            : nullptr;
+        if (name_entry)
+        {
+            out << "\tclass " << name_entry->value << std::endl;
+            refs++;
+        }
+    }
+
+    for (size_t index = 0; index < member_refs.size(); index++)
+    {
+        const auto entry_id = static_cast<constant_pool_entry_id>(index);
+        if (const auto* member_ref = member_refs.find(entry_id); member_ref && is_listed(entry_id))
+        {
+            const bool is_field = member_ref->type == constant_pool_type::FieldRef;
+            out << '\t' << (is_field ? "field " : "method ") << member_ref->owner << "."
+                << member_ref->name << (is_field ? ":" : "") << member_ref->descriptor << std::endl;
+            refs++;
+        }
+    }
+
+    SCAN_COUNT(scan_counter::findings, refs);
+}
+
+// Writes `value` on one line, escaping quotes and control characters and cutting it short if it
+// is long, e.g. an embedded blob.
+void print_string_value(std::string_view value, std::ostream& out)
+{
+    constexpr size_t MAX_PRINTED_LENGTH = 100;
+    size_t length = std::min(value.size(), MAX_PRINTED_LENGTH);
+    // Don't cut a multibyte character in half.
+    while (length < value.size() && length && (static_cast<uint8_t>(value[length]) & 0xC0) == 0x80)
+    {
+        length--;
     }
+
+    out << '"';
+    for (const char c : value.substr(0, length))
+    {
+        if (c == '"' || c == '\\')
+        {
+            out << '\\' << c;
+        }
+        else if (static_cast<uint8_t>(c) < 0x20 || c == 0x7F)
+        {
+            out << "\\x" << std::hex << std::setw(2) << std::setfill('0')
+                << static_cast<int>(c) << std::dec << std::setfill(' ');
+        }
+        else
+        {
+            out << c;
+        }
+    }
+
+    out << '"' << (length < value.size() ? "..." : "");
 }
 
-void do_command(cxxopts::ParseResult args, bool& error) {
-    const auto class_name = args["input"].as<std::string>();
+void do_find_strings(const java_class& clazz, const std::string& class_name,
+    const string_pattern_set& patterns, std::vector<string_indicator_info>& indicators,
+    std::ostream& out)
+{
+    find_string_uses(clazz, indicators);
+
+    SCAN_PHASE(scan_phase::output);
+    SCAN_COUNT(scan_counter::findings, indicators.size());
+    out << "Found the following strings in " << class_name << ":" << std::endl;
+    for (const auto& indicator : indicators)
+    {
+        std::ostringstream line;
+        line << "\t#" << indicator.cp_index << ' ';
+        print_string_value(indicator.value, line);
+        for (size_t i = 0; i < indicator.patterns.size(); i++)
+        {
+            line << (i ? ", " : " [") << patterns.get_name(indicator.patterns[i]);
+        }
+
+        line << ']';
+        if (indicator.uses.empty())
+        {
+            out << line.str() << std::endl;
+        }
+
+        // One line per instruction loading it, like the calls of a scan.
+        for (const auto& use : indicator.uses)
+        {
+            out << line.str() << " loaded in method " << use.method << " on line "
+                << use.line_number << std::endl;
+        }
+    }
+}
+
+void print_api_use_counts(const api_use_counts& counts, std::ostream& out)
+{
+    std::vector<std::pair<std::string, size_t>> rows;
+    for (const auto& [key, count] : counts)
+    {
+        rows.emplace_back(get_api_use_name(key), count);
+    }
+
+    // Most used first, then by name so the table doesn't depend on hashing or on thread timing.
+    std::sort(rows.begin(), rows.end(), [](const auto& lhs, const auto& rhs)
+    {
+        return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+    });
+
+    out << "Found the following API use counts:" << std::endl;
+    for (const auto& [name, count] : rows)
+    {
+        out << std::right << std::setw(10) << count << "  " << name << std::endl;
+    }
+}
+
+// What the classes of a run add up to, rather than print one by one.
+struct command_results
+{
+    // The uses of each API in `--count` mode.
+    api_use_counts counts;
+    // Whether `--exists` found a use.
+    bool found_use = false;
+    // Set by parallel runs once any worker found a use, so `--exists` stops searching a class.
+    const std::atomic<bool>* stop_searching = nullptr;
+};
+
+// Parses and processes one class, writing its output to `out` and its errors to `err`. In
+// `--count` and `--exists` mode, what it found is instead added to `results`. Returns false if the
+// class could not be processed.
+bool do_class_command(const cxxopts::ParseResult& args, const std::string& class_name,
+    const api_rule_set& rules, const string_pattern_set& string_patterns,
+    command_results& results, std::ostream& out, std::ostream& err)
+{
+    alloc_stats& allocations = alloc_stats::instance();
+    if (allocations.is_enabled())
+    {
+        allocations.begin_class();
+    }
+
+    // The rules decide what is printed unless dumping the class, looking for strings or listing all
+    // of its references.
+    const bool has_rules = args.count("scan") || args.count("rules");
+    const bool is_rule_driven = has_rules && !args.count("dump-cp") &&
+        !args.count("dump-class") && !args.count("strings");
+
+    // A corrupt class is reported and skipped rather than ending the whole run.
+    const auto contents = java_class::try_read_class_file(class_name);
+    if (const auto* read_error = std::get_if<class_parse_error>(&contents))
+    {
+        err << class_name << ": " << read_error->message << " (at byte " << read_error->offset
+            << ")" << std::endl;
+        return false;
+    }
+
+    const auto& bytes = std::get<std::vector<uint8_t>>(contents);
+    if (is_rule_driven && java_class::is_class_file(bytes.data(), bytes.size()))
+    {
+        bool may_match;
+        {
+            SCAN_PHASE(scan_phase::prefilter);
+            may_match = rules.may_match_class_bytes(bytes.data(), bytes.size());
+        }
+
+        // The class is known to be clean without parsing it, so it is reported as if it had been.
+        if (!may_match)
+        {
+            SCAN_COUNT(scan_counter::classes, 1);
+            SCAN_COUNT(scan_counter::prefiltered_classes, 1);
+            if (!args.count("refs") && !args.count("exists") && !args.count("count"))
+            {
+                print_api_calls(class_name, {}, out);
+            }
+
+            if (allocations.is_enabled())
+            {
+                allocations.end_class(class_name);
+            }
+
+            return true;
+        }
+    }
+
+    // `--strings` and `--exists` only need the rest of the class if its constant pool has a
+    // matching string or refers to a matching API, which most classes don't.
+    java_class::parse_filter filter;
+    std::vector<string_indicator_info> indicators;
+    std::optional<compiled_api_rules> matching_refs;
+    if (args.count("dump-class"))
+    {
+        // Dumps the whole class, whatever else is asked for.
+    }
+    else if (args.count("strings"))
+    {
+        filter = [&](const java_class& clazz)
+        {
+            indicators = match_string_constants(clazz.get_class_constant_pool(), string_patterns);
+            return !indicators.empty();
+        };
+    }
+    else if (args.count("refs"))
+    {
+        // Everything `--refs` lists is in the constant pool.
+        filter = [](const java_class&)
+        {
+            return false;
+        };
+    }
+    else if (args.count("exists"))
+    {
+        filter = [&](const java_class& clazz)
+        {
+            SCAN_PHASE(scan_phase::bytecode);
+            matching_refs.emplace(rules.compile(clazz.get_class_constant_pool(),
+                clazz.get_class_member_refs()));
+            return may_find_api_uses(clazz, rules, *matching_refs);
+        };
+    }
+
+    const auto parsed_class = java_class::try_parse_class_bytes(bytes.data(), bytes.size(), filter);
+    if (const auto* parse_error = std::get_if<class_parse_error>(&parsed_class))
+    {
+        err << class_name << ": " << parse_error->message << " (at byte "
+            << parse_error->offset << ")" << std::endl;
+        return false;
+    }
+
+    bool processed = true;
+    const auto& clazz = std::get<java_class>(parsed_class);
     try
     {
-        const auto clazz = java_class::parse_class_file(class_name);
         if (args.count("dump-cp"))
         {
-            do_dump_cp(clazz);
+            do_dump_cp(clazz, out);
         }
         else if (args.count("dump-class"))
         {
-            do_dump_class(clazz);
+            do_dump_class(clazz, out);
         }
-        else if (args.count("scan"))
+        else if (args.count("strings"))
         {
-            // The constant pool stores APIs as, for example, "java/io/PrintStream" instead of the
-            // common convention of "java.io.PrintStream".
-            auto api_names = args["scan"].as<std::vector<std::string>>();
-            denormalize_api_names(api_names);
-            do_scan(clazz, class_name, api_names);
+            if (!indicators.empty())
+            {
+                do_find_strings(clazz, class_name, string_patterns, indicators, out);
+            }
         }
-        else
+        else if (args.count("refs"))
         {
-            error = true;
+            do_list_refs(clazz, class_name, rules, has_rules, out);
+        }
+        else if (args.count("exists"))
+        {
+            if (const auto use = find_first_api_use(clazz, rules, *matching_refs,
+                results.stop_searching); use)
+            {
+                SCAN_COUNT(scan_counter::findings, 1);
+                out << class_name << ": " << get_api_use_name(*use) << std::endl;
+                results.found_use = true;
+            }
+        }
+        else if (args.count("count"))
+        {
+            const size_t uses = count_api_uses(clazz, rules, results.counts);
+            SCAN_COUNT(scan_counter::findings, uses);
+        }
+        else if (args.count("scan") || args.count("rules"))
+        {
+            do_scan(clazz, class_name, rules, args.count("arg-origins") > 0, out);
         }
     }
-    catch (const std::ios::failure& io_failure)
+    catch (const invalid_class_format& icf)
     {
-        std::cerr << io_failure.what() << std::endl;
+        err << class_name << ": " << icf.what() << std::endl;
+        processed = false;
     }
-    catch (const invalid_class_format& icf)
+    // Thrown by the symbol table once it can hold no more names, which only fails this class.
+    catch (const std::length_error& e)
+    {
+        err << class_name << ": " << e.what() << std::endl;
+        processed = false;
+    }
+
+    if (allocations.is_enabled())
+    {
+        allocations.end_class(class_name);
+    }
+
+    return processed;
+}
+
+struct class_output
+{
+    std::string out;
+    std::string err;
+};
+
+// Processes the classes on `jobs` threads. Each class's output is buffered and printed once every
+// class before it has been, so the output is the same as that of a single-threaded run. Once
+// `--exists` finds a use, the other workers stop at the next method of the class they are searching
+// and take no more classes.
+void do_parallel_command(const cxxopts::ParseResult& args, const std::vector<std::string>& inputs,
+    const api_rule_set& rules, const string_pattern_set& string_patterns, size_t jobs,
+    command_results& results, size_t& failed_classes)
+{
+    const bool stop_at_first_use = args.count("exists") > 0;
+    std::atomic<size_t> next_input{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<bool> found_use{false};
+    std::mutex output_lock;
+    std::vector<std::optional<class_output>> outputs(inputs.size());
+    size_t next_output = 0;
+
+    const auto worker = [&]()
+    {
+        // Counted per thread and merged once the thread is done.
+        command_results worker_results;
+        worker_results.stop_searching = &found_use;
+        for (size_t input_idx = next_input++; input_idx < inputs.size(); input_idx = next_input++)
+        {
+            std::ostringstream out, err;
+            if (!do_class_command(args, inputs[input_idx], rules, string_patterns, worker_results,
+                out, err))
+            {
+                failed++;
+            }
+
+            if (worker_results.found_use)
+            {
+                found_use.store(true, std::memory_order_relaxed);
+            }
+
+            std::lock_guard<std::mutex> guard {output_lock};
+            outputs[input_idx].emplace(class_output{out.str(), err.str()});
+            for (; next_output < outputs.size() && outputs[next_output]; next_output++)
+            {
+                std::cout << outputs[next_output]->out << std::flush;
+                std::cerr << outputs[next_output]->err;
+                outputs[next_output].reset();
+            }
+
+            if (stop_at_first_use && found_use.load(std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> guard {output_lock};
+        for (const auto& [key, count] : worker_results.counts)
+        {
+            results.counts[key] += count;
+        }
+
+        results.found_use = results.found_use || worker_results.found_use;
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(jobs, inputs.size()); i++)
+    {
+        workers.emplace_back(worker);
+    }
+
+    worker();
+    for (auto& worker_thread : workers)
+    {
+        worker_thread.join();
+    }
+
+    failed_classes += failed;
+}
+
+// Runs the command given on the inputs. Sets `error` if the options don't make up a command, and
+// returns false if the rule pack or string patterns given could not be loaded, having said why.
+bool do_command(const cxxopts::ParseResult& args, size_t jobs, bool& error,
+    size_t& failed_classes, bool& found_use)
+{
+    const bool has_rules = args.count("scan") || args.count("rules");
+    if ((!args.count("dump-cp") && !args.count("dump-class") && !args.count("refs") &&
+        !args.count("strings") && !has_rules) ||
+        ((args.count("count") || args.count("exists")) && !has_rules))
+    {
+        error = true;
+        return true;
+    }
+
+    api_rule_set rules;
+    if (args.count("rules"))
+    {
+        const auto& pack_path = args["rules"].as<std::string>();
+        std::string pack_error;
+        auto pack = rule_pack::load(pack_path, pack_error);
+        if (!pack)
+        {
+            std::cerr << pack_path << ": " << pack_error << std::endl;
+            return false;
+        }
+
+        rules.set_rule_pack(std::move(pack));
+    }
+
+    if (args.count("scan"))
+    {
+        // The constant pool stores APIs as, for example, "java/io/PrintStream" instead of the
+        // common convention of "java.io.PrintStream".
+        const auto& given_api_names = args["scan"].as<std::vector<std::string>>();
+        auto api_names = given_api_names;
+        denormalize_api_names(api_names);
+        for (size_t i = 0; i < api_names.size(); i++)
+        {
+            if (!rules.add_rule(api_names[i]))
+            {
+                std::cerr << "Invalid API rule: " << given_api_names[i] << std::endl;
+                error = true;
+                return true;
+            }
+        }
+    }
+
+    // Scans also report what reflective lookups resolve to, so classes making them can't be ruled
+    // out by the names of the APIs alone.
+    const bool is_scan = !args.count("refs") && !args.count("exists") && !args.count("count");
+    rules.build_prefilter(is_scan ? get_reflective_lookup_names()
+        : std::vector<std::string_view>{});
+
+    string_pattern_set string_patterns;
+    if (args.count("strings"))
+    {
+        const auto& patterns_path = args["strings"].as<std::string>();
+        std::ifstream patterns_file {patterns_path};
+        std::string patterns_error;
+        if (!patterns_file || !string_patterns.load(patterns_file, patterns_error))
+        {
+            std::cerr << patterns_path << ": "
+                << (patterns_file ? patterns_error : "failed to open string patterns.")
+                << std::endl;
+            return false;
+        }
+    }
+
+    command_results results;
+    const auto& inputs = args["input"].as<std::vector<std::string>>();
+    if (jobs > 1)
+    {
+        do_parallel_command(args, inputs, rules, string_patterns, jobs, results, failed_classes);
+    }
+    else
+    {
+        for (const auto& class_name : inputs)
+        {
+            if (!do_class_command(args, class_name, rules, string_patterns, results, std::cout,
+                std::cerr))
+            {
+                failed_classes++;
+            }
+
+            if (results.found_use)
+            {
+                break;
+            }
+        }
+    }
+
+    if (args.count("count"))
     {
-        std::cerr << icf.what() << std::endl;
+        SCAN_PHASE(scan_phase::output);
+        print_api_use_counts(results.counts, std::cout);
     }
+
+    found_use = results.found_use;
+    return true;
+}
+
+bool do_compile_rules(const cxxopts::ParseResult& args)
+{
+    if (!args.count("output"))
+    {
+        std::cerr << "--compile-rules needs an output file given with -o." << std::endl;
+        return false;
+    }
+
+    const auto& source_path = args["compile-rules"].as<std::string>();
+    const auto& pack_path = args["output"].as<std::string>();
+    std::ifstream source {source_path};
+    if (!source)
+    {
+        std::cerr << source_path << ": failed to open rule pack source." << std::endl;
+        return false;
+    }
+
+    std::ofstream pack {pack_path, std::ios::binary | std::ios::trunc};
+    std::string compile_error;
+    if (!pack || !compile_rule_pack(source, pack, compile_error))
+    {
+        std::cerr << source_path << ": "
+            << (pack ? compile_error : "failed to create " + pack_path + ".") << std::endl;
+        return false;
+    }
+
+    return true;
 }
 
 int main(int argc, char** argv)
@@ -264,24 +818,110 @@ int main(int argc, char** argv)
     options
         .allow_unrecognised_options()
         .add_options()
-            ("input", "Input class file", cxxopts::value<std::string>())
+            ("input", "Input class files", cxxopts::value<std::vector<std::string>>())
             ("c,dump-cp", "Dump constant pool")
             ("d,dump-class", "Dump given class")
-            ("s,scan", "Scan for a CSV list of APIs", cxxopts::value<std::vector<std::string>>());
+            ("s,scan", "Scan for a CSV list of classes and methods, e.g. "
+                "java.io.File.<init>(Ljava/lang/String;)V",
+                cxxopts::value<std::vector<std::string>>())
+            ("stats", "Print per-phase timing and throughput statistics")
+            ("perf", "Also sample hardware performance counters per phase (implies --stats)")
+            ("alloc-stats", "Count allocations per phase and per class (implies --stats)")
+            ("alloc-sites", "Also break allocations down by call site (implies --alloc-stats)")
+            ("rules", "Scan for the APIs of a rule pack compiled with --compile-rules",
+                cxxopts::value<std::string>())
+            ("refs", "List the classes and members each class refers to, or those matching -s or "
+                "--rules, from the constant pool alone")
+            ("strings", "Report the string constants matching the patterns of a file",
+                cxxopts::value<std::string>())
+            ("count", "Only count the uses of each API across all the classes")
+            ("exists", "Stop at the first use of any API, exiting with status 3 if there is one")
+            ("arg-origins", "Label each argument of the calls found by a scan as a constant, a "
+                "parameter of the calling method or the result of another call")
+            ("compile-rules", "Compile a rule pack source file into the rule pack given by -o",
+                cxxopts::value<std::string>())
+            ("o,output", "Output file of --compile-rules", cxxopts::value<std::string>())
+            ("j,jobs", "Number of classes to process in parallel (0 for one per hardware thread)",
+                cxxopts::value<unsigned int>()->default_value("1"));
     options.parse_positional({ "input" });
 
     bool error = false;
+    bool failed_to_load = false;
+    size_t failed_classes = 0;
+    bool found_use = false;
     try
     {
         cxxopts::ParseResult args = options.parse(argc, argv);
+        if (args.count("compile-rules"))
+        {
+            return do_compile_rules(args) ? 0 : 1;
+        }
+
         if (!args.count("input"))
         {
             error = true;
         }
 
+        const bool print_alloc_stats = args.count("alloc-stats") || args.count("alloc-sites");
+        const bool print_stats = args.count("stats") || args.count("perf") || print_alloc_stats;
+#ifdef BYTECODE_SCANNER_STATS
+        if (print_stats)
+        {
+            scan_stats::instance().enable();
+        }
+
+        const char* perf_failure_reason = nullptr;
+        if (args.count("perf") && !scan_stats::instance().enable_perf_counters(perf_failure_reason))
+        {
+            std::cerr << "Hardware counters unavailable: " << perf_failure_reason << std::endl;
+        }
+#endif
+
+        size_t jobs = args["jobs"].as<unsigned int>();
+        if (jobs == 0)
+        {
+            jobs = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // The statistics are gathered by whichever thread is running, so they're only meaningful
+        // for a single-threaded run.
+        if (print_stats && jobs > 1)
+        {
+            std::cerr << "Statistics are collected from a single thread: ignoring --jobs."
+                << std::endl;
+            jobs = 1;
+        }
+
+        if (print_alloc_stats)
+        {
+            if (alloc_stats::is_available())
+            {
+                alloc_stats::instance().enable(args.count("alloc-sites") > 0);
+            }
+            else
+            {
+                std::cerr << "Allocation statistics are not available: build with ALLOC_STATS=1."
+                    << std::endl;
+            }
+        }
+
         if (!error)
         {
-            do_command(std::move(args), error);
+            failed_to_load = !do_command(args, jobs, error, failed_classes, found_use);
+        }
+
+        if (print_stats)
+        {
+#ifdef BYTECODE_SCANNER_STATS
+            scan_stats::instance().print_summary(std::cerr);
+#else
+            std::cerr << "Statistics are not available: built with STATS=0." << std::endl;
+#endif
+        }
+
+        if (alloc_stats::instance().is_enabled())
+        {
+            alloc_stats::instance().print_summary(std::cerr);
         }
     }
     catch (const cxxopts::OptionException& e)
@@ -295,5 +935,16 @@ int main(int argc, char** argv)
         return 1;
     }
 
-    return 0;
+    if (failed_to_load)
+    {
+        return 1;
+    }
+
+    // A use is found for certain even if some other class couldn't be looked at.
+    if (found_use)
+    {
+        return 3;
+    }
+
+    return failed_classes ? 2 : 0;
 }
@@ -0,0 +1,76 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <iterator>
+
+#include "constant_pool.hh"
+#include "member_ref_table.hh"
+#include "scan_stats.hh"
+
+member_ref_table::member_ref_table(const constant_pool& cp)
+{
+    SCAN_PHASE(scan_phase::constant_pool);
+    if (!cp.size())
+    {
+        return;
+    }
+
+    // Entries are ordered by index, so the last one bounds the table.
+    const size_t table_size = static_cast<size_t>(std::prev(cp.end())->first) + 1;
+    slots.resize(table_size);
+    for (const auto& [entry_id, entry_data] : cp)
+    {
+        if (entry_data.type != constant_pool_type::FieldRef &&
+            entry_data.type != constant_pool_type::MethodRef &&
+            entry_data.type != constant_pool_type::InterfaceMethodRef)
+        {
+            continue;
+        }
+
+        // Malformed classes can point anywhere, so every link in the chain is checked.
+        const auto* member_ref = std::get_if<cp_double_index_entry>(&entry_data.entry);
+        const auto* class_ref = member_ref
+            ? cp.find_entry_as<cp_class_info_entry>(member_ref->cp_index, constant_pool_type::Class)
+            : nullptr;
+        const auto* name_and_type_ref = member_ref
+            ? cp.find_entry_as<cp_name_and_type_index_entry>(member_ref->cp_index2,
+                constant_pool_type::NameAndType)
+            : nullptr;
+        if (!class_ref || !name_and_type_ref)
+        {
+            continue;
+        }
+
+        const auto* owner = cp.find_entry_as<cp_utf8_entry>(class_ref->cp_index,
+            constant_pool_type::Utf8);
+        const auto* name = cp.find_entry_as<cp_utf8_entry>(name_and_type_ref->cp_index,
+            constant_pool_type::Utf8);
+        const auto* descriptor = cp.find_entry_as<cp_utf8_entry>(name_and_type_ref->cp_index2,
+            constant_pool_type::Utf8);
+        if (!owner || !name || !descriptor)
+        {
+            continue;
+        }
+
+        slots[entry_id] = slot{true, resolved_member_ref{
+            entry_data.type, class_ref->cp_index, name_and_type_ref->cp_index,
+            name_and_type_ref->cp_index2, owner->symbol, name->symbol, descriptor->symbol,
+            owner->value, name->value, descriptor->value
+        }};
+    }
+}
@@ -0,0 +1,115 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "method_descriptor.hh"
+#include "symbol_table.hh"
+
+// The JVM limits arrays to 255 dimensions.
+static constexpr size_t MAX_ARRAY_DIMENSIONS = 255;
+
+// Advances `pos` past the field descriptor that starts there. Returns false if there isn't one.
+static bool skip_field_type(std::string_view descriptor, size_t& pos)
+{
+    const size_t start = pos;
+    while (pos < descriptor.size() && descriptor[pos] == '[')
+    {
+        pos++;
+    }
+
+    if (pos - start > MAX_ARRAY_DIMENSIONS || pos >= descriptor.size())
+    {
+        return false;
+    }
+
+    switch (descriptor[pos])
+    {
+        case 'B': case 'C': case 'D': case 'F': case 'I': case 'J': case 'S': case 'Z':
+            pos++;
+            return true;
+        case 'L':
+        {
+            const size_t class_name_end = descriptor.find(';', pos);
+            if (class_name_end == std::string_view::npos || class_name_end == pos + 1)
+            {
+                return false;
+            }
+
+            pos = class_name_end + 1;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool is_valid_field_descriptor(std::string_view descriptor)
+{
+    size_t pos = 0;
+    return skip_field_type(descriptor, pos) && pos == descriptor.size();
+}
+
+std::optional<method_descriptor> parse_method_descriptor(std::string_view descriptor)
+{
+    if (descriptor.empty() || descriptor[0] != '(')
+    {
+        return std::nullopt;
+    }
+
+    symbol_table& symbols = symbol_table::instance();
+    method_descriptor parsed;
+    size_t pos = 1;
+    while (pos < descriptor.size() && descriptor[pos] != ')')
+    {
+        const size_t type_start = pos;
+        if (!skip_field_type(descriptor, pos))
+        {
+            return std::nullopt;
+        }
+
+        parsed.parameter_types.push_back(
+            symbols.intern(descriptor.substr(type_start, pos - type_start)));
+    }
+
+    // Skip the closing parenthesis; what follows is the return type.
+    if (++pos >= descriptor.size())
+    {
+        return std::nullopt;
+    }
+
+    const size_t return_type_start = pos;
+    if (descriptor[pos] == 'V')
+    {
+        pos++;
+    }
+    else if (!skip_field_type(descriptor, pos))
+    {
+        return std::nullopt;
+    }
+
+    if (pos != descriptor.size())
+    {
+        return std::nullopt;
+    }
+
+    parsed.return_type = symbols.intern(descriptor.substr(return_type_start));
+    return parsed;
+}
@@ -17,19 +17,22 @@
 * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
-#include <fstream>
 #include <vector>
 
 #include "attribute_info.hh"
+#include "class_reader.hh"
 #include "constant_pool.hh"
 #include "method_info.hh"
+#include "scan_stats.hh"
 #include "util.hh"
 
-std::vector<method_info> parse_methods(std::ifstream& file, const constant_pool& cp)
+std::vector<method_info> parse_methods(class_reader& file, const constant_pool& cp)
 {
     std::vector<method_info> methods;
     READ_U2_FIELD(methods_count, "Failed to parse methods count of class file.");
-    for (uint16_t curr_method_idx = 0; curr_method_idx < methods_count; curr_method_idx++)
+    SCAN_COUNT(scan_counter::methods, methods_count);
+    for (uint16_t curr_method_idx = 0; curr_method_idx < methods_count && !file.failed();
+        curr_method_idx++)
     {
         methods.emplace_back(method_info::parse_method_info(file, cp));
     }
@@ -37,7 +40,7 @@ std::vector<method_info> parse_methods(std::ifstream& file, const constant_pool&
     return methods;
 }
 
-method_info method_info::parse_method_info(std::ifstream& file, const constant_pool& cp)
+method_info method_info::parse_method_info(class_reader& file, const constant_pool& cp)
 {
     READ_U2_FIELD(access_flag_bytes, "Failed to parse access flags of method.");
     auto access_flags = method_access_flags{access_flag_bytes};
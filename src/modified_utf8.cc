@@ -0,0 +1,270 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MODIFIED_UTF8_HAVE_X86_SIMD
+#endif
+
+#include "modified_utf8.hh"
+
+using find_special_byte_fn = size_t (*)(const uint8_t*, size_t);
+
+constexpr uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+// A byte is special if it can't be copied through as a one byte sequence: either it starts or
+// continues a multi-byte sequence (high bit set) or it is a zero byte, which is never valid.
+static bool is_special_byte(uint8_t byte)
+{
+    return byte == 0 || byte >= 0x80;
+}
+
+static size_t find_special_byte_scalar(const uint8_t* data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (is_special_byte(data[i]))
+        {
+            return i;
+        }
+    }
+
+    return length;
+}
+
+#ifdef MODIFIED_UTF8_HAVE_X86_SIMD
+__attribute__((target("sse2")))
+static size_t find_special_byte_sse2(const uint8_t* data, size_t length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        // The sign bits pick out bytes >= 0x80; the comparison picks out zero bytes.
+        const uint32_t special = static_cast<uint32_t>(
+            _mm_movemask_epi8(block) | _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)));
+        if (special)
+        {
+            return i + __builtin_ctz(special);
+        }
+    }
+
+    return i + find_special_byte_scalar(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+static size_t find_special_byte_avx2(const uint8_t* data, size_t length)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t special = static_cast<uint32_t>(
+            _mm256_movemask_epi8(block) | _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, zero)));
+        if (special)
+        {
+            return i + __builtin_ctz(special);
+        }
+    }
+
+    return i + find_special_byte_sse2(data + i, length - i);
+}
+#endif
+
+static find_special_byte_fn select_find_special_byte()
+{
+#ifdef MODIFIED_UTF8_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return find_special_byte_avx2;
+    }
+
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return find_special_byte_sse2;
+    }
+#endif
+    return find_special_byte_scalar;
+}
+
+// Returns the offset of the first byte in `data` that needs the slow path, or `length` if there is
+// none.
+static size_t find_special_byte(const uint8_t* data, size_t length)
+{
+    static const find_special_byte_fn find = select_find_special_byte();
+    return find(data, length);
+}
+
+static bool is_continuation_byte(uint8_t byte)
+{
+    return (byte & 0xC0) == 0x80;
+}
+
+// Decodes the sequence starting at `data` into the UTF-16 code unit it encodes. Returns the length
+// of the sequence, or 0 if it is malformed.
+static size_t decode_sequence(const uint8_t* data, size_t length, uint16_t& unit)
+{
+    const uint8_t lead = data[0];
+    if (lead != 0 && lead < 0x80)
+    {
+        unit = lead;
+        return 1;
+    }
+
+    if ((lead & 0xE0) == 0xC0)
+    {
+        if (length < 2 || !is_continuation_byte(data[1]))
+        {
+            return 0;
+        }
+
+        unit = static_cast<uint16_t>((lead & 0x1F) << 6 | (data[1] & 0x3F));
+        // Only NUL may use a longer form than necessary.
+        return unit >= 0x80 || unit == 0 ? 2 : 0;
+    }
+
+    if ((lead & 0xF0) == 0xE0)
+    {
+        if (length < 3 || !is_continuation_byte(data[1]) || !is_continuation_byte(data[2]))
+        {
+            return 0;
+        }
+
+        unit = static_cast<uint16_t>((lead & 0x0F) << 12 | (data[1] & 0x3F) << 6 |
+            (data[2] & 0x3F));
+        return unit >= 0x800 ? 3 : 0;
+    }
+
+    // Zero bytes, stray continuation bytes and the four byte forms of standard UTF-8.
+    return 0;
+}
+
+bool is_valid_modified_utf8(const uint8_t* data, size_t length)
+{
+    size_t position = 0;
+    while (true)
+    {
+        position += find_special_byte(data + position, length - position);
+        if (position == length)
+        {
+            return true;
+        }
+
+        uint16_t unit;
+        const size_t sequence_length = decode_sequence(data + position, length - position, unit);
+        if (!sequence_length)
+        {
+            return false;
+        }
+
+        position += sequence_length;
+    }
+}
+
+static void append_utf8(std::string& out, uint32_t code_point)
+{
+    if (code_point < 0x80)
+    {
+        out += static_cast<char>(code_point);
+    }
+    else if (code_point < 0x800)
+    {
+        out += static_cast<char>(0xC0 | code_point >> 6);
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+    else if (code_point < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | code_point >> 12);
+        out += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | code_point >> 18);
+        out += static_cast<char>(0x80 | (code_point >> 12 & 0x3F));
+        out += static_cast<char>(0x80 | (code_point >> 6 & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+static bool is_high_surrogate(uint16_t unit)
+{
+    return unit >= 0xD800 && unit <= 0xDBFF;
+}
+
+static bool is_low_surrogate(uint16_t unit)
+{
+    return unit >= 0xDC00 && unit <= 0xDFFF;
+}
+
+std::string modified_utf8_to_utf8(std::string_view input)
+{
+    const auto* data = reinterpret_cast<const uint8_t*>(input.data());
+    const size_t length = input.size();
+    size_t position = find_special_byte(data, length);
+    if (position == length)
+    {
+        return std::string{input};
+    }
+
+    std::string out{input.substr(0, position)};
+    out.reserve(length);
+    while (position < length)
+    {
+        const size_t ascii_run = find_special_byte(data + position, length - position);
+        out.append(input.substr(position, ascii_run));
+        position += ascii_run;
+        if (position == length)
+        {
+            break;
+        }
+
+        uint16_t unit;
+        const size_t sequence_length = decode_sequence(data + position, length - position, unit);
+        if (!sequence_length)
+        {
+            append_utf8(out, REPLACEMENT_CHARACTER);
+            position++;
+            continue;
+        }
+
+        position += sequence_length;
+        if (is_high_surrogate(unit))
+        {
+            uint16_t low_unit;
+            const size_t low_length = position < length
+                ? decode_sequence(data + position, length - position, low_unit)
+                : 0;
+            if (low_length && is_low_surrogate(low_unit))
+            {
+                position += low_length;
+                append_utf8(out, 0x10000 + ((unit - 0xD800) << 10) + (low_unit - 0xDC00));
+                continue;
+            }
+        }
+
+        append_utf8(out, is_high_surrogate(unit) || is_low_surrogate(unit)
+            ? REPLACEMENT_CHARACTER
+            : unit);
+    }
+
+    return out;
+}
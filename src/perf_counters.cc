@@ -0,0 +1,158 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cerrno>
+#include <cstring>
+
+#include "perf_counters.hh"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct perf_event_config
+{
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+
+constexpr std::array<perf_event_config, TOTAL_PERF_EVENTS> perf_event_configs =
+{{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+        PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+        PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+}};
+
+static int open_perf_event(const perf_event_config& config, int group_fd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = config.type;
+    attr.config = config.config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+        PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Only the leader starts disabled; members follow the leader's state.
+    attr.disabled = group_fd == -1;
+    // pid = 0 and cpu = -1 counts the calling thread on whichever CPU it runs.
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+#endif
+
+perf_counter_group::perf_counter_group()
+{
+    fds.fill(-1);
+    slots.fill(-1);
+}
+
+perf_counter_group::~perf_counter_group()
+{
+#ifdef __linux__
+    for (int fd : fds)
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool perf_counter_group::open(const char*& reason)
+{
+#ifdef __linux__
+    int leader = -1;
+    for (size_t event = 0; event < TOTAL_PERF_EVENTS; event++)
+    {
+        const int fd = open_perf_event(perf_event_configs[event], leader);
+        if (fd == -1)
+        {
+            // Without a leader there is no group to add the remaining events to.
+            if (leader == -1)
+            {
+                reason = errno == EACCES || errno == EPERM
+                    ? "not permitted (see /proc/sys/kernel/perf_event_paranoid)"
+                    : std::strerror(errno);
+                return false;
+            }
+
+            continue;
+        }
+
+        if (leader == -1)
+        {
+            leader = fd;
+        }
+
+        fds[event] = fd;
+        slots[event] = static_cast<int>(opened_events++);
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    reason = "hardware counters are only supported on Linux";
+    return false;
+#endif
+}
+
+perf_reading perf_counter_group::read() const
+{
+    perf_reading reading;
+#ifdef __linux__
+    if (!is_open())
+    {
+        return reading;
+    }
+
+    // With `PERF_FORMAT_GROUP` a single read returns the number of events, the time the group was
+    // enabled and running, then each value.
+    std::array<uint64_t, TOTAL_PERF_EVENTS + 3> buffer{};
+    if (::read(fds[static_cast<size_t>(perf_event_kind::cycles)], buffer.data(),
+        sizeof(buffer)) <= 0)
+    {
+        return reading;
+    }
+
+    reading.time_enabled = buffer[1];
+    reading.time_running = buffer[2];
+    for (size_t event = 0; event < TOTAL_PERF_EVENTS; event++)
+    {
+        if (slots[event] >= 0)
+        {
+            reading.values[event] = buffer[3 + slots[event]];
+        }
+    }
+#endif
+    return reading;
+}
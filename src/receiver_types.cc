@@ -0,0 +1,521 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "attribute_info.hh"
+#include "bytecode.hh"
+#include "bytecode_analysis.hh"
+#include "code_attribute.hh"
+#include "constant_pool.hh"
+#include "java_class.hh"
+#include "member_ref_table.hh"
+#include "method_info.hh"
+#include "receiver_types.hh"
+#include "stack_map_table_attribute.hh"
+
+// The static type of a stack slot or local: a class in internal form or an array descriptor, or
+// empty when it's a primitive, null or not known.
+struct static_type
+{
+    std::string_view name;
+};
+
+// Returns the type of a value with the field descriptor `descriptor`.
+static static_type get_descriptor_type(std::string_view descriptor)
+{
+    if (descriptor.size() > 2 && descriptor.front() == 'L' && descriptor.back() == ';')
+    {
+        return {descriptor.substr(1, descriptor.size() - 2)};
+    }
+
+    return {descriptor.size() > 1 && descriptor.front() == '[' ? descriptor : std::string_view{}};
+}
+
+// The stack effect of an invoke, and the type of its result.
+struct typed_invoke
+{
+    method_slots slots;
+    const resolved_member_ref* member_ref;
+    static_type result;
+};
+
+// Steps through one method in pc order, keeping the static type of each stack slot and local. At
+// each frame of the StackMapTable they are replaced by the frame's, so branches never have to be
+// followed and each instruction is stepped through once.
+class receiver_type_pass
+{
+    const java_class& clazz;
+    const method_info& method;
+    const code_attribute& code;
+    const uint8_t* bytecode;
+    const stack_map_table_attribute* stack_map = nullptr;
+    abstract_stack<static_type> stack;
+    std::vector<static_type> locals;
+    // The locals as of the last frame, and the slots taken by each of them, which chop frames
+    // remove from the end.
+    std::vector<static_type> frame_locals;
+    std::vector<uint8_t> frame_local_slots;
+    // The locals stored to since the last frame, which are set back to its types at the next one.
+    std::vector<uint32_t> stored_locals;
+    // Cleared past an instruction that can't fall through until the next frame, as nothing is
+    // known of the code in between, which only a backward branch can reach.
+    bool known = true;
+    // The invokes decoded so far by constant pool index, doubled and set apart by whether they are
+    // `invokedynamic`.
+    std::unordered_map<uint32_t, typed_invoke> invokes;
+    std::vector<receiver_type> receivers;
+    bool malformed = false;
+
+    static_type get_class_type(constant_pool_entry_id cp_index) const
+    {
+        const constant_pool& cp = clazz.get_class_constant_pool();
+        const auto* class_ref = cp.find_entry_as<cp_class_info_entry>(cp_index,
+            constant_pool_type::Class);
+        const auto* class_name = class_ref
+            ? cp.find_entry_as<cp_utf8_entry>(class_ref->cp_index, constant_pool_type::Utf8)
+            : nullptr;
+        return {class_name ? class_name->value : std::string_view{}};
+    }
+
+    static_type get_verification_type(const verification_type& type) const
+    {
+        switch (type.tag)
+        {
+            case verification_type_tag::Object:
+                return get_class_type(type.data);
+            case verification_type_tag::Uninitialized:
+                // The object created by the `new` at the given offset.
+                if (code.get_instruction_index().is_instruction_start(type.data) &&
+                    bytecode[type.data] == static_cast<uint8_t>(bytecode_tag::NEW))
+                {
+                    return get_class_type(read_u2_operand(&bytecode[type.data + 1]));
+                }
+
+                return {};
+            case verification_type_tag::UninitializedThis:
+                return get_class_type(clazz.get_class_this_index());
+            default:
+                return {};
+        }
+    }
+
+    static_type get_local(uint32_t local) const
+    {
+        return local < locals.size() ? locals[local] : static_type{};
+    }
+
+    void set_local(uint32_t local, static_type type)
+    {
+        if (locals.size() <= local)
+        {
+            locals.resize(local + 1);
+        }
+
+        locals[local] = type;
+    }
+
+    void store_local(uint32_t local, static_type type, bool is_wide_value)
+    {
+        set_local(local, type);
+        stored_locals.push_back(local);
+        if (is_wide_value)
+        {
+            set_local(local + 1, {});
+            stored_locals.push_back(local + 1);
+        }
+    }
+
+    void append_frame_local(static_type type, uint8_t slots)
+    {
+        frame_local_slots.push_back(slots);
+        for (uint8_t slot = 0; slot < slots; slot++)
+        {
+            set_local(static_cast<uint32_t>(frame_locals.size()), slot ? static_type{} : type);
+            frame_locals.push_back(slot ? static_type{} : type);
+        }
+    }
+
+    void chop_frame_local()
+    {
+        if (frame_local_slots.empty())
+        {
+            return;
+        }
+
+        for (uint8_t slot = 0; slot < frame_local_slots.back(); slot++)
+        {
+            frame_locals.pop_back();
+            set_local(static_cast<uint32_t>(frame_locals.size()), {});
+        }
+
+        frame_local_slots.pop_back();
+    }
+
+    // Sets the locals and stack to those of `frame`, which only gives how its locals differ from
+    // the previous frame's unless it is a full frame.
+    void apply_frame(const stack_map_frame& frame)
+    {
+        for (const uint32_t local : stored_locals)
+        {
+            locals[local] = local < frame_locals.size() ? frame_locals[local] : static_type{};
+        }
+
+        stored_locals.clear();
+        const verification_type* frame_types = stack_map->get_locals(frame);
+        switch (frame.kind)
+        {
+            case stack_map_frame_kind::chop:
+                for (uint8_t idx = 0; idx < frame.chopped_locals; idx++)
+                {
+                    chop_frame_local();
+                }
+
+                break;
+            case stack_map_frame_kind::full:
+                while (!frame_local_slots.empty())
+                {
+                    chop_frame_local();
+                }
+
+                [[fallthrough]];
+            case stack_map_frame_kind::append:
+                for (uint16_t idx = 0; idx < frame.local_count; idx++)
+                {
+                    append_frame_local(get_verification_type(frame_types[idx]),
+                        get_verification_slots(frame_types[idx]));
+                }
+
+                break;
+            default:
+                break;
+        }
+
+        stack.forget(0);
+        const verification_type* stack_types = stack_map->get_stack(frame);
+        for (uint16_t idx = 0; idx < frame.stack_count; idx++)
+        {
+            stack.push(get_verification_type(stack_types[idx]));
+            stack.push_unknown(get_verification_slots(stack_types[idx]) - 1);
+        }
+    }
+
+    static uint8_t get_verification_slots(const verification_type& type)
+    {
+        return type.tag == verification_type_tag::Long || type.tag == verification_type_tag::Double
+            ? 2 : 1;
+    }
+
+    // Sets the locals to the parameters, as the implicit frame at the start of the method does.
+    bool enter_method()
+    {
+        const bool is_static = (static_cast<uint16_t>(method.get_access_flags()) &
+            static_cast<uint16_t>(method_access_flags::Static)) != 0;
+        if (!is_static)
+        {
+            // The receiver of a constructor is uninitialized, but of the class all the same.
+            append_frame_local(get_class_type(clazz.get_class_this_index()), 1);
+        }
+
+        const std::string_view descriptor = method.get_descriptor();
+        if (!get_method_slots(descriptor, nullptr))
+        {
+            return false;
+        }
+
+        size_t idx = 1;
+        while (descriptor[idx] != ')')
+        {
+            const size_t type_start = idx;
+            idx = descriptor.find_first_not_of('[', idx);
+            if (descriptor[idx] == 'L')
+            {
+                idx = descriptor.find(';', idx);
+            }
+
+            idx++;
+            const std::string_view type = descriptor.substr(type_start, idx - type_start);
+            append_frame_local(get_descriptor_type(type),
+                static_cast<uint8_t>(get_type_slots(type.front())));
+        }
+
+        return true;
+    }
+
+    // Returns the stack effect of an invoke, or nullptr if it doesn't refer to a method.
+    const typed_invoke* get_invoke_info(bytecode_tag instr, constant_pool_entry_id cp_index)
+    {
+        const bool is_dynamic = instr == bytecode_tag::INVOKEDYNAMIC;
+        const uint32_t key = static_cast<uint32_t>(cp_index) * 2 + (is_dynamic ? 1 : 0);
+        if (const auto cached = invokes.find(key); cached != invokes.end())
+        {
+            return &cached->second;
+        }
+
+        const auto target = resolve_invoke(clazz, instr, cp_index);
+        const auto slots = target ? get_method_slots(target->descriptor, nullptr) : std::nullopt;
+        if (!slots)
+        {
+            return nullptr;
+        }
+
+        const std::string_view result =
+            target->descriptor.substr(target->descriptor.rfind(')') + 1);
+        return &invokes.emplace(key, typed_invoke{*slots, target->member_ref,
+            get_descriptor_type(result)}).first->second;
+    }
+
+    void step_invoke(uint16_t pc, bytecode_tag instr)
+    {
+        const typed_invoke* info = get_invoke_info(instr, read_u2_operand(&bytecode[pc + 1]));
+        if (!info)
+        {
+            malformed = true;
+            return;
+        }
+
+        const bool has_receiver = instr != bytecode_tag::INVOKESTATIC &&
+            instr != bytecode_tag::INVOKEDYNAMIC;
+        const size_t argument_slots = info->slots.arguments + (has_receiver ? 1 : 0);
+        const static_type* arguments = stack.top(argument_slots);
+        // Every class is an `Object`, so a receiver typed as one says nothing more, and frames use
+        // it for values of interface types.
+        if (known && arguments && (instr == bytecode_tag::INVOKEVIRTUAL ||
+            instr == bytecode_tag::INVOKEINTERFACE))
+        {
+            const std::string_view type = arguments[0].name;
+            if (!type.empty() && type.front() != '[' && type != "java/lang/Object" &&
+                type != info->member_ref->owner)
+            {
+                receivers.push_back(receiver_type{pc, type});
+            }
+        }
+
+        stack.pop(argument_slots);
+        if (info->slots.result)
+        {
+            stack.push(info->result);
+            stack.push_unknown(info->slots.result - 1);
+        }
+    }
+
+    void step_field_access(uint16_t pc, bytecode_tag instr)
+    {
+        const resolved_member_ref* member_ref =
+            clazz.get_class_member_refs().find(read_u2_operand(&bytecode[pc + 1]));
+        if (!member_ref || member_ref->type != constant_pool_type::FieldRef ||
+            member_ref->descriptor.empty())
+        {
+            malformed = true;
+            return;
+        }
+
+        const uint32_t value_slots = get_type_slots(member_ref->descriptor.front());
+        const bool is_static = instr == bytecode_tag::GETSTATIC ||
+            instr == bytecode_tag::PUTSTATIC;
+        const bool is_get = instr == bytecode_tag::GETSTATIC || instr == bytecode_tag::GETFIELD;
+        stack.pop((is_static ? 0 : 1) + (is_get ? 0 : value_slots));
+        if (is_get)
+        {
+            stack.push(get_descriptor_type(member_ref->descriptor));
+            stack.push_unknown(value_slots - 1);
+        }
+    }
+
+    void step_local_access(const local_access& access)
+    {
+        switch (access.instruction)
+        {
+            case bytecode_tag::ALOAD:
+                stack.push(get_local(access.local));
+                break;
+            case bytecode_tag::ASTORE:
+                store_local(access.local, stack.pop_value(), false);
+                break;
+            case bytecode_tag::ISTORE:
+            case bytecode_tag::FSTORE:
+            case bytecode_tag::LSTORE:
+            case bytecode_tag::DSTORE:
+                stack.pop(access.is_wide_value() ? 2 : 1);
+                store_local(access.local, {}, access.is_wide_value());
+                break;
+            case bytecode_tag::IINC:
+                break;
+            default:
+                stack.push_unknown(access.is_wide_value() ? 2 : 1);
+                break;
+        }
+    }
+
+    void step(uint16_t pc)
+    {
+        if (const auto access = decode_local_access(bytecode, pc))
+        {
+            step_local_access(*access);
+            return;
+        }
+
+        const auto instr = static_cast<bytecode_tag>(bytecode[pc]);
+        if (step_stack_permutation(stack, instr))
+        {
+            return;
+        }
+
+        switch (instr)
+        {
+            case bytecode_tag::NEW:
+                stack.push(get_class_type(read_u2_operand(&bytecode[pc + 1])));
+                return;
+            case bytecode_tag::CHECKCAST:
+                stack.pop(1);
+                stack.push(get_class_type(read_u2_operand(&bytecode[pc + 1])));
+                return;
+            case bytecode_tag::AALOAD:
+            {
+                stack.pop(1);
+                const std::string_view array = stack.pop_value().name;
+                stack.push(array.empty() ? static_type{} : get_descriptor_type(array.substr(1)));
+                return;
+            }
+            case bytecode_tag::WIDE:
+                // Only `wide ret` is left.
+                return;
+            case bytecode_tag::GETSTATIC:
+            case bytecode_tag::PUTSTATIC:
+            case bytecode_tag::GETFIELD:
+            case bytecode_tag::PUTFIELD:
+                step_field_access(pc, instr);
+                return;
+            case bytecode_tag::INVOKEVIRTUAL:
+            case bytecode_tag::INVOKESPECIAL:
+            case bytecode_tag::INVOKESTATIC:
+            case bytecode_tag::INVOKEINTERFACE:
+            case bytecode_tag::INVOKEDYNAMIC:
+                step_invoke(pc, instr);
+                return;
+            case bytecode_tag::MULTIANEWARRAY:
+                stack.pop(bytecode[pc + 3]);
+                stack.push(get_class_type(read_u2_operand(&bytecode[pc + 1])));
+                return;
+            default:
+                break;
+        }
+
+        // Everything else, constants included, only pushes values of no known class.
+        const opcode_descriptor& descriptor = get_opcode_descriptor(instr);
+        stack.pop(descriptor.stack_pops);
+        stack.push_unknown(descriptor.stack_pushes);
+    }
+
+    // Without a StackMapTable, the types are only known in methods that never branch.
+    bool is_straight_line() const
+    {
+        if (!code.get_exception_table().empty())
+        {
+            return false;
+        }
+
+        for (const uint16_t pc : code.get_instruction_index())
+        {
+            bool branches = false;
+            for_each_branch_target(bytecode, pc, [&](int64_t)
+            {
+                branches = true;
+            });
+            if (branches)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+public:
+    receiver_type_pass(const java_class& clazz, const method_info& method,
+        const code_attribute& code) :
+            clazz{clazz},
+            method{method},
+            code{code},
+            bytecode{code.get_bytecode()}
+    {
+        for (const auto& attr : code.get_code_attributes())
+        {
+            if (attr->get_type() == attribute_info_type::stack_map_table)
+            {
+                stack_map = &dynamic_cast<const stack_map_table_attribute&>(*attr);
+                break;
+            }
+        }
+    }
+
+    std::vector<receiver_type> run()
+    {
+        if ((!stack_map && !is_straight_line()) || !enter_method())
+        {
+            return {};
+        }
+
+        const std::vector<stack_map_frame> no_frames;
+        const std::vector<stack_map_frame>& frames =
+            stack_map ? stack_map->get_frames() : no_frames;
+        size_t next_frame = 0;
+        bool falls_through = true;
+        for (const uint16_t pc : code.get_instruction_index())
+        {
+            // Each frame is relative to the previous one, so even those at no instruction, which
+            // only malformed classes have, are applied in turn.
+            bool at_frame = false;
+            for (; next_frame < frames.size() && frames[next_frame].pc <= pc; next_frame++)
+            {
+                apply_frame(frames[next_frame]);
+                at_frame = frames[next_frame].pc == pc;
+            }
+
+            if (at_frame)
+            {
+                known = true;
+            }
+            else if (!falls_through)
+            {
+                known = false;
+            }
+
+            step(pc);
+            // Nothing past an instruction referring to the wrong kind of entry can be trusted.
+            if (malformed)
+            {
+                break;
+            }
+
+            falls_through = can_fall_through(bytecode, pc);
+        }
+
+        return std::move(receivers);
+    }
+};
+
+std::vector<receiver_type> find_receiver_types(const java_class& clazz, const method_info& method,
+    const code_attribute& code)
+{
+    return receiver_type_pass{clazz, method, code}.run();
+}
@@ -0,0 +1,443 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bytecode.hh"
+#include "bytecode_analysis.hh"
+#include "code_attribute.hh"
+#include "constant_pool.hh"
+#include "find_api_calls.hh"
+#include "java_class.hh"
+#include "member_ref_table.hh"
+#include "reflection.hh"
+
+static constexpr std::string_view CLASS_CLASS = "java/lang/Class";
+static constexpr std::string_view LOOKUP_CLASS = "java/lang/invoke/MethodHandles$Lookup";
+
+// Parameter positions of a lookup that aren't parameters.
+static constexpr int8_t RECEIVER = -1;
+static constexpr int8_t NO_PARAMETER = -2;
+
+// A lookup whose arguments name what it resolves to.
+struct reflective_lookup
+{
+    std::string_view owner;
+    std::string_view name;
+    // The descriptor the call must have, or empty for any. `loadClass` is matched whatever its
+    // owner since it's usually called on a subclass of `ClassLoader`.
+    std::string_view descriptor;
+    api_use_kind kind;
+    // The parameter holding the class a member is looked up in, or `RECEIVER`.
+    int8_t class_parameter;
+    // The parameter holding the name of the class or member, or `NO_PARAMETER` for constructors.
+    int8_t name_parameter;
+};
+
+static constexpr reflective_lookup reflective_lookups[] =
+{
+    {CLASS_CLASS, "forName", {}, api_use_kind::type_use, NO_PARAMETER, 0},
+    {{}, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;", api_use_kind::type_use,
+        NO_PARAMETER, 0},
+    {CLASS_CLASS, "getMethod", {}, api_use_kind::method_call, RECEIVER, 0},
+    {CLASS_CLASS, "getDeclaredMethod", {}, api_use_kind::method_call, RECEIVER, 0},
+    {CLASS_CLASS, "getConstructor", {}, api_use_kind::method_call, RECEIVER, NO_PARAMETER},
+    {CLASS_CLASS, "getDeclaredConstructor", {}, api_use_kind::method_call, RECEIVER, NO_PARAMETER},
+    {CLASS_CLASS, "getField", {}, api_use_kind::field_access, RECEIVER, 0},
+    {CLASS_CLASS, "getDeclaredField", {}, api_use_kind::field_access, RECEIVER, 0},
+    {LOOKUP_CLASS, "findVirtual", {}, api_use_kind::method_call, 0, 1},
+    {LOOKUP_CLASS, "findStatic", {}, api_use_kind::method_call, 0, 1},
+    {LOOKUP_CLASS, "findSpecial", {}, api_use_kind::method_call, 0, 1},
+    {LOOKUP_CLASS, "findConstructor", {}, api_use_kind::method_call, 0, NO_PARAMETER},
+    {LOOKUP_CLASS, "findGetter", {}, api_use_kind::field_access, 0, 1},
+    {LOOKUP_CLASS, "findSetter", {}, api_use_kind::field_access, 0, 1},
+    {LOOKUP_CLASS, "findStaticGetter", {}, api_use_kind::field_access, 0, 1},
+    {LOOKUP_CLASS, "findStaticSetter", {}, api_use_kind::field_access, 0, 1},
+    {LOOKUP_CLASS, "findVarHandle", {}, api_use_kind::field_access, 0, 1},
+    {LOOKUP_CLASS, "findStaticVarHandle", {}, api_use_kind::field_access, 0, 1},
+};
+
+static const reflective_lookup* find_reflective_lookup(const resolved_member_ref& member_ref)
+{
+    if (member_ref.type == constant_pool_type::FieldRef)
+    {
+        return nullptr;
+    }
+
+    for (const reflective_lookup& lookup : reflective_lookups)
+    {
+        if (lookup.name == member_ref.name &&
+            (lookup.owner.empty() || lookup.owner == member_ref.owner) &&
+            (lookup.descriptor.empty() || lookup.descriptor == member_ref.descriptor))
+        {
+            return &lookup;
+        }
+    }
+
+    return nullptr;
+}
+
+bool may_use_reflection(const java_class& clazz)
+{
+    const member_ref_table& member_refs = clazz.get_class_member_refs();
+    for (size_t index = 0; index < member_refs.size(); index++)
+    {
+        const resolved_member_ref* member_ref =
+            member_refs.find(static_cast<constant_pool_entry_id>(index));
+        if (member_ref && find_reflective_lookup(*member_ref))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::vector<std::string_view> get_reflective_lookup_names()
+{
+    return {CLASS_CLASS, LOOKUP_CLASS};
+}
+
+// What is known of a stack slot or local: nothing, or that it holds a String constant or a Class.
+struct abstract_value
+{
+    enum class kind : uint8_t
+    {
+        unknown, string, class_ref
+    };
+
+    kind type = kind::unknown;
+    // The string's modified UTF-8 value, or the class's name in internal form.
+    std::string_view value;
+};
+
+// The stack effect of an invoke, and the lookup it makes, if any.
+struct invoke_info
+{
+    method_slots slots;
+    const reflective_lookup* lookup;
+    // Only filled in for lookups.
+    std::vector<uint32_t> parameter_offsets;
+};
+
+// Interprets one method in pc order, keeping track of the String constants and Classes held by each
+// stack slot and local. Each instruction is stepped through once and only ever touches a bounded
+// number of slots, and each descriptor is only read once, so the whole method takes time linear in
+// its length.
+class reflection_interpreter
+{
+    const java_class& clazz;
+    const code_attribute& code;
+    const uint8_t* bytecode;
+    abstract_frame<abstract_value> frame;
+    // Class names converted from the dotted form `Class.forName` takes.
+    std::deque<std::string> class_names;
+    // The invokes decoded so far by constant pool index, doubled and set apart by whether they are
+    // `invokedynamic`. Nothing is cached for malformed ones, which end the interpretation.
+    std::unordered_map<uint32_t, invoke_info> invokes;
+    std::vector<reflective_target> targets;
+    bool malformed = false;
+
+    abstract_value load_constant(constant_pool_entry_id cp_index) const
+    {
+        const constant_pool& cp = clazz.get_class_constant_pool();
+        const auto* string = cp.find_entry_as<cp_string_info_entry>(cp_index,
+            constant_pool_type::String);
+        const auto* class_ref = string ? nullptr
+            : cp.find_entry_as<cp_class_info_entry>(cp_index, constant_pool_type::Class);
+        const auto* value = string || class_ref
+            ? cp.find_entry_as<cp_utf8_entry>(string ? string->cp_index : class_ref->cp_index,
+                constant_pool_type::Utf8)
+            : nullptr;
+        if (!value)
+        {
+            return {};
+        }
+
+        return {string ? abstract_value::kind::string : abstract_value::kind::class_ref,
+            value->value};
+    }
+
+    // Records the target of a lookup given the arguments `arguments`, starting with the receiver
+    // if it has one, and returns the Class it loads, if any.
+    abstract_value follow_lookup(uint16_t pc, const invoke_info& info,
+        const abstract_value* arguments, bool has_receiver)
+    {
+        const reflective_lookup& lookup = *info.lookup;
+        const auto get_argument = [&](int8_t parameter)
+        {
+            if (parameter == RECEIVER)
+            {
+                return has_receiver ? arguments[0] : abstract_value{};
+            }
+
+            if (parameter == NO_PARAMETER ||
+                static_cast<size_t>(parameter) >= info.parameter_offsets.size())
+            {
+                return abstract_value{};
+            }
+
+            return arguments[(has_receiver ? 1 : 0) + info.parameter_offsets[parameter]];
+        };
+
+        const abstract_value name = get_argument(lookup.name_parameter);
+        if (lookup.kind == api_use_kind::type_use)
+        {
+            if (name.type != abstract_value::kind::string)
+            {
+                return {};
+            }
+
+            std::string class_name{name.value};
+            std::replace(class_name.begin(), class_name.end(), '.', '/');
+            targets.push_back(reflective_target{pc, lookup.kind, class_name, {}});
+            class_names.push_back(std::move(class_name));
+            return {abstract_value::kind::class_ref, class_names.back()};
+        }
+
+        const abstract_value owner = get_argument(lookup.class_parameter);
+        if (owner.type != abstract_value::kind::class_ref)
+        {
+            return {};
+        }
+
+        if (lookup.name_parameter == NO_PARAMETER)
+        {
+            targets.push_back(reflective_target{pc, lookup.kind, std::string{owner.value},
+                "<init>"});
+        }
+        else if (name.type == abstract_value::kind::string)
+        {
+            targets.push_back(reflective_target{pc, lookup.kind, std::string{owner.value},
+                std::string{name.value}});
+        }
+
+        return {};
+    }
+
+    // Returns the stack effect of an invoke, or nullptr if it doesn't refer to a method.
+    const invoke_info* get_invoke_info(bytecode_tag instr, constant_pool_entry_id cp_index)
+    {
+        const bool is_dynamic = instr == bytecode_tag::INVOKEDYNAMIC;
+        const uint32_t key = static_cast<uint32_t>(cp_index) * 2 + (is_dynamic ? 1 : 0);
+        if (const auto cached = invokes.find(key); cached != invokes.end())
+        {
+            return &cached->second;
+        }
+
+        const auto target = resolve_invoke(clazz, instr, cp_index);
+        if (!target)
+        {
+            return nullptr;
+        }
+
+        invoke_info info{{},
+            target->member_ref ? find_reflective_lookup(*target->member_ref) : nullptr, {}};
+        const auto slots = get_method_slots(target->descriptor,
+            info.lookup ? &info.parameter_offsets : nullptr);
+        if (!slots)
+        {
+            return nullptr;
+        }
+
+        info.slots = *slots;
+        return &invokes.emplace(key, std::move(info)).first->second;
+    }
+
+    void step_invoke(uint16_t pc, bytecode_tag instr)
+    {
+        const invoke_info* info = get_invoke_info(instr, read_u2_operand(&bytecode[pc + 1]));
+        if (!info)
+        {
+            malformed = true;
+            return;
+        }
+
+        const bool has_receiver = instr != bytecode_tag::INVOKESTATIC &&
+            instr != bytecode_tag::INVOKEDYNAMIC;
+        const size_t argument_slots = info->slots.arguments + (has_receiver ? 1 : 0);
+        abstract_value result;
+        // Arguments pushed before the last join are unknown, and so is what the lookup resolves to.
+        const abstract_value* arguments = frame.stack.top(argument_slots);
+        if (info->lookup && arguments)
+        {
+            result = follow_lookup(pc, *info, arguments, has_receiver);
+        }
+
+        frame.stack.pop(argument_slots);
+        if (info->slots.result)
+        {
+            frame.stack.push(result);
+            frame.stack.push_unknown(info->slots.result - 1);
+        }
+    }
+
+    void step_field_access(uint16_t pc, bytecode_tag instr)
+    {
+        const resolved_member_ref* member_ref =
+            clazz.get_class_member_refs().find(read_u2_operand(&bytecode[pc + 1]));
+        if (!member_ref || member_ref->type != constant_pool_type::FieldRef ||
+            member_ref->descriptor.empty())
+        {
+            malformed = true;
+            return;
+        }
+
+        const uint32_t value_slots = get_type_slots(member_ref->descriptor.front());
+        const bool is_static = instr == bytecode_tag::GETSTATIC ||
+            instr == bytecode_tag::PUTSTATIC;
+        const bool is_get = instr == bytecode_tag::GETSTATIC || instr == bytecode_tag::GETFIELD;
+        frame.stack.pop((is_static ? 0 : 1) + (is_get ? 0 : value_slots));
+        frame.stack.push_unknown(is_get ? value_slots : 0);
+    }
+
+    void step_local_access(const local_access& access)
+    {
+        switch (access.instruction)
+        {
+            case bytecode_tag::ALOAD:
+                frame.stack.push(frame.get_local(access.local));
+                break;
+            case bytecode_tag::ASTORE:
+                frame.store_local(access.local, frame.stack.pop_value(), false);
+                break;
+            case bytecode_tag::ISTORE:
+            case bytecode_tag::FSTORE:
+            case bytecode_tag::LSTORE:
+            case bytecode_tag::DSTORE:
+                frame.stack.pop(access.is_wide_value() ? 2 : 1);
+                frame.store_local(access.local, {}, access.is_wide_value());
+                break;
+            case bytecode_tag::IINC:
+                frame.store_local(access.local, {}, false);
+                break;
+            default:
+                // Loads of anything but references push values of no interest.
+                frame.stack.push_unknown(access.is_wide_value() ? 2 : 1);
+                break;
+        }
+    }
+
+    // Interprets the instruction at `pc`.
+    void step(uint16_t pc)
+    {
+        if (const auto access = decode_local_access(bytecode, pc))
+        {
+            step_local_access(*access);
+            return;
+        }
+
+        const auto instr = static_cast<bytecode_tag>(bytecode[pc]);
+        if (step_stack_permutation(frame.stack, instr))
+        {
+            return;
+        }
+
+        switch (instr)
+        {
+            case bytecode_tag::LDC:
+                frame.stack.push(load_constant(bytecode[pc + 1]));
+                return;
+            case bytecode_tag::LDC_W:
+                frame.stack.push(load_constant(read_u2_operand(&bytecode[pc + 1])));
+                return;
+            case bytecode_tag::CHECKCAST:
+            case bytecode_tag::WIDE:
+                // The cast value is the same reference, and only `wide ret` is left.
+                return;
+            case bytecode_tag::GETSTATIC:
+            case bytecode_tag::PUTSTATIC:
+            case bytecode_tag::GETFIELD:
+            case bytecode_tag::PUTFIELD:
+                step_field_access(pc, instr);
+                return;
+            case bytecode_tag::INVOKEVIRTUAL:
+            case bytecode_tag::INVOKESPECIAL:
+            case bytecode_tag::INVOKESTATIC:
+            case bytecode_tag::INVOKEINTERFACE:
+            case bytecode_tag::INVOKEDYNAMIC:
+                step_invoke(pc, instr);
+                return;
+            case bytecode_tag::MULTIANEWARRAY:
+                frame.stack.pop(bytecode[pc + 3]);
+                frame.stack.push_unknown(1);
+                return;
+            default:
+                break;
+        }
+
+        const opcode_descriptor& descriptor = get_opcode_descriptor(instr);
+        frame.stack.pop(descriptor.stack_pops);
+        // A subroutine starts with the return address pushed, and pops it before returning past
+        // the `jsr`.
+        const bool is_jsr = instr == bytecode_tag::JSR || instr == bytecode_tag::JSR_W;
+        for_each_branch_target(bytecode, pc, [&](int64_t target)
+        {
+            frame.add_branch(pc, target, frame.stack.depth() + (is_jsr ? 1 : 0));
+        });
+
+        frame.stack.push_unknown(is_jsr ? 0 : descriptor.stack_pushes);
+    }
+
+public:
+    reflection_interpreter(const java_class& clazz, const method_info& method,
+        const code_attribute& code) :
+            clazz{clazz},
+            code{code},
+            bytecode{code.get_bytecode()},
+            frame{method, code}
+    {}
+
+    std::vector<reflective_target> run()
+    {
+        // Without the parameters, it isn't known which locals are defined once.
+        if (frame.has_malformed_descriptor())
+        {
+            return {};
+        }
+
+        bool falls_through = true;
+        for (const uint16_t pc : code.get_instruction_index())
+        {
+            frame.enter_instruction(pc, falls_through);
+            step(pc);
+            // Nothing past an instruction referring to the wrong kind of entry can be trusted.
+            if (malformed)
+            {
+                break;
+            }
+
+            falls_through = can_fall_through(bytecode, pc);
+        }
+
+        return std::move(targets);
+    }
+};
+
+std::vector<reflective_target> find_reflective_targets(const java_class& clazz,
+    const method_info& method, const code_attribute& code)
+{
+    return reflection_interpreter{clazz, method, code}.run();
+}
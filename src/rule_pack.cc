@@ -0,0 +1,459 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "api_rules.hh"
+#include "rule_pack.hh"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BYTECODE_SCANNER_MMAP
+#endif
+
+// Owners per bucket of the perfect hash, on average.
+static constexpr uint32_t OWNERS_PER_BUCKET = 4;
+// Bounds the search for a bucket's seed; only reached if the hash is badly broken.
+static constexpr uint32_t MAX_SEED = 1u << 24;
+
+// FNV-1a, mixed with a seed. The hash is part of the pack format, so unlike `std::hash` it must be
+// the same across builds.
+static uint32_t hash_owner(std::string_view name, uint32_t seed)
+{
+    uint64_t hash = 0xCBF29CE484222325ull ^ (seed * 0x9E3779B97F4A7C15ull);
+    for (const char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001B3ull;
+    }
+
+    hash ^= hash >> 32;
+    return static_cast<uint32_t>(hash);
+}
+
+struct source_rule
+{
+    std::string name;
+    bool is_field;
+    std::string descriptor;
+    uint16_t category;
+    rule_severity severity;
+};
+
+// Appends the bytes of `value` to `out`.
+template <typename T>
+static void append_pod(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+static void append_pods(std::string& out, const std::vector<T>& values)
+{
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+class string_pool
+{
+    std::string bytes;
+    std::unordered_map<std::string, rule_pack_string> offsets;
+
+public:
+    rule_pack_string add(const std::string& str)
+    {
+        auto [offsets_it, inserted] = offsets.emplace(str, rule_pack_string{
+            static_cast<uint32_t>(bytes.size()), static_cast<uint32_t>(str.size())});
+        if (inserted)
+        {
+            bytes += str;
+        }
+
+        return offsets_it->second;
+    }
+
+    const std::string& get_bytes() const
+    {
+        return bytes;
+    }
+};
+
+// Finds a seed per bucket so that no two owners share a slot, placing the fullest buckets first
+// while the table is still mostly empty ("hash, displace and compress" without the compression).
+static bool build_perfect_hash(const std::vector<std::string>& owner_names, uint32_t bucket_count,
+    std::vector<uint32_t>& seeds, std::vector<uint32_t>& slots)
+{
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    for (uint32_t owner_idx = 0; owner_idx < owner_names.size(); owner_idx++)
+    {
+        buckets[hash_owner(owner_names[owner_idx], 0) % bucket_count].push_back(owner_idx);
+    }
+
+    std::vector<uint32_t> bucket_order(bucket_count);
+    for (uint32_t bucket_idx = 0; bucket_idx < bucket_count; bucket_idx++)
+    {
+        bucket_order[bucket_idx] = bucket_idx;
+    }
+
+    std::stable_sort(bucket_order.begin(), bucket_order.end(), [&](uint32_t lhs, uint32_t rhs)
+    {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    seeds.assign(bucket_count, 0);
+    std::vector<uint32_t> bucket_slots;
+    for (const uint32_t bucket_idx : bucket_order)
+    {
+        const std::vector<uint32_t>& bucket = buckets[bucket_idx];
+        if (bucket.empty())
+        {
+            break;
+        }
+
+        uint32_t seed = 1;
+        for (; seed < MAX_SEED; seed++)
+        {
+            bucket_slots.clear();
+            for (const uint32_t owner_idx : bucket)
+            {
+                const uint32_t slot = hash_owner(owner_names[owner_idx], seed) % slots.size();
+                if (slots[slot] != RULE_PACK_EMPTY_SLOT ||
+                    std::find(bucket_slots.cbegin(), bucket_slots.cend(), slot) !=
+                        bucket_slots.cend())
+                {
+                    break;
+                }
+
+                bucket_slots.push_back(slot);
+            }
+
+            if (bucket_slots.size() == bucket.size())
+            {
+                break;
+            }
+        }
+
+        if (seed == MAX_SEED)
+        {
+            return false;
+        }
+
+        seeds[bucket_idx] = seed;
+        for (size_t i = 0; i < bucket.size(); i++)
+        {
+            slots[bucket_slots[i]] = bucket[i];
+        }
+    }
+
+    return true;
+}
+
+bool compile_rule_pack(std::istream& source, std::ostream& pack, std::string& error)
+{
+    // Ordered so that the output doesn't depend on hashing.
+    std::map<std::string, std::vector<source_rule>> rules_by_owner;
+    std::vector<std::string> category_names;
+    std::string line;
+    for (size_t line_number = 1; std::getline(source, line); line_number++)
+    {
+        const size_t comment_start = line.find('#');
+        if (comment_start != std::string::npos)
+        {
+            line.erase(comment_start);
+        }
+
+        std::istringstream fields{line};
+        std::string category, severity_name, rule;
+        if (!(fields >> category))
+        {
+            continue;
+        }
+
+        std::string extra;
+        const std::string line_prefix = "line " + std::to_string(line_number) + ": ";
+        if (!(fields >> severity_name >> rule) || fields >> extra)
+        {
+            error = line_prefix + "expected a category, a severity and a rule.";
+            return false;
+        }
+
+        const auto severity = parse_rule_severity(severity_name);
+        if (!severity || *severity == rule_severity::none)
+        {
+            error = line_prefix + "unknown severity `" + severity_name + "`.";
+            return false;
+        }
+
+        const std::string normalized_rule = normalize_api_rule(rule);
+        const auto parts = split_api_rule(normalized_rule);
+        if (!parts)
+        {
+            error = line_prefix + "invalid rule `" + rule + "`.";
+            return false;
+        }
+
+        auto category_it = std::find(category_names.cbegin(), category_names.cend(), category);
+        if (category_it == category_names.cend())
+        {
+            if (category_names.size() > UINT16_MAX)
+            {
+                error = line_prefix + "too many categories.";
+                return false;
+            }
+
+            category_it = category_names.insert(category_names.cend(), category);
+        }
+
+        rules_by_owner[std::string{parts->owner}].push_back(source_rule{
+            std::string{parts->name}, parts->is_field, std::string{parts->descriptor},
+            static_cast<uint16_t>(category_it - category_names.cbegin()), *severity
+        });
+    }
+
+    string_pool strings;
+    std::vector<std::string> owner_names;
+    std::vector<rule_pack_owner> owners;
+    std::vector<rule_pack_rule> rules;
+    for (const auto& [owner_name, owner_rules] : rules_by_owner)
+    {
+        owner_names.push_back(owner_name);
+        owners.push_back(rule_pack_owner{strings.add(owner_name),
+            static_cast<uint32_t>(rules.size()), static_cast<uint32_t>(owner_rules.size())});
+        for (const source_rule& rule : owner_rules)
+        {
+            rules.push_back(rule_pack_rule{strings.add(rule.name), strings.add(rule.descriptor),
+                rule.category, static_cast<uint8_t>(rule.severity),
+                rule.is_field ? RULE_PACK_FIELD_RULE : uint8_t{0}});
+        }
+    }
+
+    std::vector<rule_pack_string> categories;
+    for (const std::string& category : category_names)
+    {
+        categories.push_back(strings.add(category));
+    }
+
+    // A quarter of the slots are left empty so that seeds are quick to find.
+    const auto owner_count = static_cast<uint32_t>(owners.size());
+    const uint32_t bucket_count = owner_count / OWNERS_PER_BUCKET + 1;
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> slots(owner_count + owner_count / 4 + 1, RULE_PACK_EMPTY_SLOT);
+    if (!build_perfect_hash(owner_names, bucket_count, seeds, slots))
+    {
+        error = "failed to build a perfect hash of the rule owners.";
+        return false;
+    }
+
+    const rule_pack_header header{RULE_PACK_MAGIC, RULE_PACK_VERSION, bucket_count,
+        static_cast<uint32_t>(slots.size()), owner_count, static_cast<uint32_t>(rules.size()),
+        static_cast<uint32_t>(categories.size()),
+        static_cast<uint32_t>(strings.get_bytes().size())};
+    std::string contents;
+    append_pod(contents, header);
+    append_pods(contents, seeds);
+    append_pods(contents, slots);
+    append_pods(contents, owners);
+    append_pods(contents, rules);
+    append_pods(contents, categories);
+    contents += strings.get_bytes();
+    if (!pack.write(contents.data(), contents.size()))
+    {
+        error = "failed to write the rule pack.";
+        return false;
+    }
+
+    return true;
+}
+
+struct rule_pack::mapping
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef BYTECODE_SCANNER_MMAP
+    ~mapping()
+    {
+        if (data)
+        {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+    }
+#else
+    std::vector<uint8_t> contents;
+#endif
+};
+
+rule_pack::rule_pack() = default;
+rule_pack::~rule_pack() = default;
+
+// Reads `count` records of type `T` from `data` at `offset`, advancing it. Returns false if they
+// would run past `size`.
+template <typename T>
+static bool take_records(const uint8_t* data, size_t size, size_t& offset, size_t count,
+    const T*& out)
+{
+    if (count > (size - offset) / sizeof(T))
+    {
+        return false;
+    }
+
+    out = reinterpret_cast<const T*>(data + offset);
+    offset += count * sizeof(T);
+    return true;
+}
+
+bool rule_pack::validate(size_t size, std::string& error)
+{
+    const uint8_t* data = file->data;
+    size_t offset = 0;
+    if (!take_records(data, size, offset, 1, header) || header->magic != RULE_PACK_MAGIC)
+    {
+        error = "not a rule pack.";
+        return false;
+    }
+
+    if (header->version != RULE_PACK_VERSION)
+    {
+        error = "unsupported rule pack version " + std::to_string(header->version) + ".";
+        return false;
+    }
+
+    if (!header->bucket_count || !header->slot_count ||
+        !take_records(data, size, offset, header->bucket_count, seeds) ||
+        !take_records(data, size, offset, header->slot_count, slots) ||
+        !take_records(data, size, offset, header->owner_count, owners) ||
+        !take_records(data, size, offset, header->rule_count, rules) ||
+        !take_records(data, size, offset, header->category_count, categories) ||
+        !take_records(data, size, offset, header->string_bytes, strings))
+    {
+        error = "rule pack is truncated.";
+        return false;
+    }
+
+    const auto is_valid_string = [&](rule_pack_string str)
+    {
+        return str.offset <= header->string_bytes && str.length <= header->string_bytes - str.offset;
+    };
+
+    bool valid = std::all_of(slots, slots + header->slot_count, [&](uint32_t slot)
+    {
+        return slot == RULE_PACK_EMPTY_SLOT || slot < header->owner_count;
+    });
+    valid = valid && std::all_of(owners, owners + header->owner_count,
+        [&](const rule_pack_owner& owner)
+    {
+        return is_valid_string(owner.name) && owner.first_rule <= header->rule_count &&
+            owner.rule_count <= header->rule_count - owner.first_rule;
+    });
+    valid = valid && std::all_of(rules, rules + header->rule_count, [&](const rule_pack_rule& rule)
+    {
+        return is_valid_string(rule.name) && is_valid_string(rule.descriptor) &&
+            rule.category < header->category_count &&
+            rule.severity <= static_cast<uint8_t>(rule_severity::critical) &&
+            (rule.flags & ~RULE_PACK_FIELD_RULE) == 0;
+    });
+    valid = valid && std::all_of(categories, categories + header->category_count,
+        is_valid_string);
+    if (!valid)
+    {
+        error = "rule pack is corrupt.";
+        return false;
+    }
+
+    return true;
+}
+
+std::unique_ptr<const rule_pack> rule_pack::load(const std::string& path, std::string& error)
+{
+    std::unique_ptr<rule_pack> pack{new rule_pack};
+    pack->file = std::make_unique<mapping>();
+#ifdef BYTECODE_SCANNER_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "failed to open rule pack.";
+        return nullptr;
+    }
+
+    struct stat file_info;
+    if (fstat(fd, &file_info) == 0 && file_info.st_size > 0)
+    {
+        void* data = mmap(nullptr, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            pack->file->data = static_cast<const uint8_t*>(data);
+            pack->file->size = file_info.st_size;
+        }
+    }
+
+    close(fd);
+#else
+    std::ifstream file {path, std::ios::binary | std::ios::ate};
+    if (!file)
+    {
+        error = "failed to open rule pack.";
+        return nullptr;
+    }
+
+    pack->file->contents.resize(file.tellg());
+    file.seekg(0);
+    if (file.read(reinterpret_cast<char*>(pack->file->contents.data()),
+        pack->file->contents.size()))
+    {
+        pack->file->data = pack->file->contents.data();
+        pack->file->size = pack->file->contents.size();
+    }
+#endif
+
+    if (!pack->file->data)
+    {
+        error = "failed to read rule pack.";
+        return nullptr;
+    }
+
+    if (!pack->validate(pack->file->size, error))
+    {
+        return nullptr;
+    }
+
+    return pack;
+}
+
+const rule_pack_owner* rule_pack::find_owner(std::string_view name) const
+{
+    const uint32_t seed = seeds[hash_owner(name, 0) % header->bucket_count];
+    const uint32_t slot = slots[hash_owner(name, seed) % header->slot_count];
+    if (slot == RULE_PACK_EMPTY_SLOT || get_string(owners[slot].name) != name)
+    {
+        return nullptr;
+    }
+
+    return &owners[slot];
+}
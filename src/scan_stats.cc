@@ -0,0 +1,248 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <ctime>
+#include <iomanip>
+#include <ostream>
+
+#include "scan_stats.hh"
+
+constexpr std::array<const char* const, TOTAL_SCAN_PHASES> phase_names =
+{
+    "io", "prefilter", "constant pool", "attributes", "bytecode", "strings",
+    "line resolution", "output"
+};
+
+constexpr std::array<const char* const, TOTAL_SCAN_COUNTERS> counter_names =
+{
+    "input bytes", "classes", "pool entries", "methods", "bytecode bytes", "methods skipped",
+    "classes prefiltered", "findings"
+};
+
+const char* get_scan_phase_name(scan_phase phase)
+{
+    return phase_names[static_cast<size_t>(phase)];
+}
+
+static uint64_t read_clock_ns(clockid_t clock)
+{
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+static phase_times now()
+{
+    // `CLOCK_MONOTONIC` is serviced by the vDSO so this stays cheap enough to call on every phase
+    // transition.
+    return phase_times{read_clock_ns(CLOCK_MONOTONIC), read_clock_ns(CLOCK_THREAD_CPUTIME_ID)};
+}
+
+scan_stats& scan_stats::instance()
+{
+    static scan_stats stats;
+    return stats;
+}
+
+void scan_stats::enable()
+{
+    enabled = true;
+    run_start = last_mark = now();
+}
+
+bool scan_stats::enable_perf_counters(const char*& reason)
+{
+    if (!perf.open(reason))
+    {
+        return false;
+    }
+
+    last_reading = perf.read();
+    return true;
+}
+
+void scan_stats::charge_current_phase()
+{
+    const phase_times mark = now();
+    if (current_phase != TOTAL_SCAN_PHASES)
+    {
+        phases[current_phase].wall_ns += mark.wall_ns - last_mark.wall_ns;
+        phases[current_phase].cpu_ns += mark.cpu_ns - last_mark.cpu_ns;
+    }
+
+    last_mark = mark;
+    if (perf.is_open())
+    {
+        const perf_reading reading = perf.read();
+        if (current_phase != TOTAL_SCAN_PHASES)
+        {
+            // The events of the group are only counted for `running` out of the `enabled`
+            // nanoseconds, so scale them up to estimate the whole phase.
+            const uint64_t enabled = reading.time_enabled - last_reading.time_enabled;
+            const uint64_t running = reading.time_running - last_reading.time_running;
+            const double scale = running > 0 ? static_cast<double>(enabled) / running : 0.;
+            perf_multiplexed = perf_multiplexed || running < enabled;
+            for (size_t event = 0; event < TOTAL_PERF_EVENTS; event++)
+            {
+                const uint64_t counted = reading.values[event] - last_reading.values[event];
+                phase_events[current_phase][event] += running < enabled
+                    ? static_cast<uint64_t>(counted * scale) : counted;
+            }
+        }
+
+        last_reading = reading;
+    }
+}
+
+void scan_stats::print_perf_summary(std::ostream& out)
+{
+    const auto ratio = [](uint64_t numerator, double denominator)
+    {
+        return denominator > 0 ? numerator / denominator : 0.;
+    };
+    const auto event_at = [](const perf_event_values& values, perf_event_kind kind)
+    {
+        return values[static_cast<size_t>(kind)];
+    };
+
+    out << "Hardware counters:" << std::endl;
+    out << '\t' << std::left << std::setw(16) << "phase" << std::right
+        << std::setw(14) << "cycles" << std::setw(14) << "instructions" << std::setw(8) << "IPC"
+        << std::setw(12) << "L1d miss" << std::setw(12) << "LLC miss" << std::setw(12)
+        << "br miss" << std::endl;
+
+    perf_event_values total{};
+    for (size_t phase = 0; phase <= TOTAL_SCAN_PHASES; phase++)
+    {
+        const bool is_total = phase == TOTAL_SCAN_PHASES;
+        const perf_event_values& values = is_total ? total : phase_events[phase];
+        if (!is_total)
+        {
+            for (size_t event = 0; event < TOTAL_PERF_EVENTS; event++)
+            {
+                total[event] += values[event];
+            }
+        }
+
+        out << '\t' << std::left << std::setw(16) << (is_total ? "total" : phase_names[phase])
+            << std::right
+            << std::setw(14) << event_at(values, perf_event_kind::cycles)
+            << std::setw(14) << event_at(values, perf_event_kind::instructions)
+            << std::setw(8) << std::setprecision(2)
+            << ratio(event_at(values, perf_event_kind::instructions),
+                event_at(values, perf_event_kind::cycles))
+            << std::setw(12) << event_at(values, perf_event_kind::l1d_misses)
+            << std::setw(12) << event_at(values, perf_event_kind::llc_misses)
+            << std::setw(12) << event_at(values, perf_event_kind::branch_misses) << std::endl;
+    }
+
+    const double classes = counters[static_cast<size_t>(scan_counter::classes)];
+    const double bytecode_kb = counters[static_cast<size_t>(scan_counter::bytecode_bytes)] / 1024.;
+    out << std::setprecision(1);
+    for (const auto& [label, denominator] : {std::make_pair("per class", classes),
+        std::make_pair("per KB bytecode", bytecode_kb)})
+    {
+        out << '\t' << std::left << std::setw(16) << label << std::right
+            << std::setw(14) << ratio(event_at(total, perf_event_kind::cycles), denominator)
+            << std::setw(14) << ratio(event_at(total, perf_event_kind::instructions), denominator)
+            << std::setw(8) << ""
+            << std::setw(12) << ratio(event_at(total, perf_event_kind::l1d_misses), denominator)
+            << std::setw(12) << ratio(event_at(total, perf_event_kind::llc_misses), denominator)
+            << std::setw(12) << ratio(event_at(total, perf_event_kind::branch_misses), denominator)
+            << std::endl;
+    }
+
+    for (size_t event = 0; event < TOTAL_PERF_EVENTS; event++)
+    {
+        if (!perf.has_event(static_cast<perf_event_kind>(event)))
+        {
+            out << "\t(some events are not supported here and read as 0)" << std::endl;
+            break;
+        }
+    }
+
+    if (perf_multiplexed)
+    {
+        out << "\t(the counters were shared with other events, so the counts are scaled estimates)"
+            << std::endl;
+    }
+}
+
+void scan_stats::print_summary(std::ostream& out)
+{
+    charge_current_phase();
+    const double total_wall_s = (last_mark.wall_ns - run_start.wall_ns) / 1e9;
+    const double total_cpu_s = (last_mark.cpu_ns - run_start.cpu_ns) / 1e9;
+
+    out << "Statistics:" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for (size_t phase = 0; phase < TOTAL_SCAN_PHASES; phase++)
+    {
+        out << '\t' << std::left << std::setw(16) << phase_names[phase]
+            << std::right << std::setw(10) << phases[phase].wall_ns / 1e6 << " ms wall"
+            << std::setw(10) << phases[phase].cpu_ns / 1e6 << " ms cpu" << std::endl;
+    }
+
+    out << '\t' << std::left << std::setw(16) << "total"
+        << std::right << std::setw(10) << total_wall_s * 1e3 << " ms wall"
+        << std::setw(10) << total_cpu_s * 1e3 << " ms cpu" << std::endl;
+
+    for (size_t counter = 0; counter < TOTAL_SCAN_COUNTERS; counter++)
+    {
+        out << '\t' << std::left << std::setw(16) << counter_names[counter]
+            << std::right << std::setw(10) << counters[counter] << std::endl;
+    }
+
+    if (total_wall_s > 0)
+    {
+        const auto classes = counters[static_cast<size_t>(scan_counter::classes)];
+        const auto input_bytes = counters[static_cast<size_t>(scan_counter::input_bytes)];
+        out << '\t' << std::left << std::setw(16) << "classes/s"
+            << std::right << std::setw(10) << classes / total_wall_s << std::endl;
+        out << '\t' << std::left << std::setw(16) << "MB/s"
+            << std::right << std::setw(10) << input_bytes / total_wall_s / (1024 * 1024)
+            << std::endl;
+    }
+
+    if (perf.is_open())
+    {
+        print_perf_summary(out);
+    }
+}
+
+scoped_scan_phase::scoped_scan_phase(scan_phase phase)
+{
+    scan_stats& stats = scan_stats::instance();
+    previous_phase = stats.current_phase;
+    if (stats.enabled)
+    {
+        stats.charge_current_phase();
+        stats.current_phase = static_cast<size_t>(phase);
+    }
+}
+
+scoped_scan_phase::~scoped_scan_phase()
+{
+    scan_stats& stats = scan_stats::instance();
+    if (stats.enabled)
+    {
+        stats.charge_current_phase();
+        stats.current_phase = previous_phase;
+    }
+}
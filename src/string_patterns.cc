@@ -0,0 +1,762 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_patterns.hh"
+
+static constexpr uint32_t UNBOUNDED = UINT32_MAX;
+static constexpr uint32_t MAX_REPEAT_COUNT = 1000;
+// Bounds the NFA a single pattern may compile to, e.g. `(a{1000}){1000}`.
+static constexpr uint64_t MAX_PATTERN_STATES = 1 << 20;
+
+struct regex_node
+{
+    enum class kind : uint8_t
+    {
+        bytes, concat, alternation, repeat
+    };
+
+    kind type;
+    std::bitset<256> bytes;
+    std::vector<regex_node> children;
+    uint32_t min_count = 0;
+    uint32_t max_count = 0;
+};
+
+static regex_node make_bytes_node(std::bitset<256> bytes)
+{
+    return regex_node{regex_node::kind::bytes, bytes, {}};
+}
+
+static void fold_case(std::bitset<256>& bytes)
+{
+    for (int c = 'a'; c <= 'z'; c++)
+    {
+        if (bytes[c] || bytes[std::toupper(c)])
+        {
+            bytes.set(c);
+            bytes.set(std::toupper(c));
+        }
+    }
+}
+
+// Parses the regular expression syntax described in string_patterns.hh into a tree.
+class regex_parser
+{
+    std::string_view source;
+    size_t pos = 0;
+    bool ignore_case;
+    std::string& error;
+
+    bool at_end() const
+    {
+        return pos == source.size();
+    }
+
+    bool fail(const std::string& message)
+    {
+        error = message + " at offset " + std::to_string(pos) + ".";
+        return false;
+    }
+
+    bool parse_escape(std::bitset<256>& bytes)
+    {
+        if (at_end())
+        {
+            return fail("trailing `\\`");
+        }
+
+        const char c = source[pos++];
+        std::bitset<256> set;
+        switch (std::tolower(static_cast<unsigned char>(c)))
+        {
+        case 'd':
+            for (int digit = '0'; digit <= '9'; digit++)
+            {
+                set.set(digit);
+            }
+            break;
+        case 'w':
+            for (int byte = 0; byte < 256; byte++)
+            {
+                set[byte] = std::isalnum(byte) || byte == '_';
+            }
+            break;
+        case 's':
+            for (const char space : {' ', '\t', '\n', '\r', '\f', '\v'})
+            {
+                set.set(static_cast<uint8_t>(space));
+            }
+            break;
+        default:
+            if (std::isalnum(static_cast<unsigned char>(c)) && c != 'n' && c != 't' && c != 'r')
+            {
+                return fail(std::string{"unknown escape `\\"} + c + "`");
+            }
+
+            set.set(static_cast<uint8_t>(c == 'n' ? '\n' : c == 't' ? '\t' : c == 'r' ? '\r' : c));
+            bytes |= set;
+            return true;
+        }
+
+        // `\D`, `\W` and `\S` are the complements of `\d`, `\w` and `\s`.
+        bytes |= std::isupper(static_cast<unsigned char>(c)) ? ~set : set;
+        return true;
+    }
+
+    bool parse_class(std::bitset<256>& bytes)
+    {
+        const bool negated = !at_end() && source[pos] == '^';
+        pos += negated;
+        std::bitset<256> set;
+        // A `]` right after the opening bracket is taken literally.
+        for (bool first = true; first || at_end() || source[pos] != ']'; first = false)
+        {
+            if (at_end())
+            {
+                return fail("unterminated `[`");
+            }
+
+            const char c = source[pos++];
+            if (c == '\\')
+            {
+                if (!parse_escape(set))
+                {
+                    return false;
+                }
+
+                continue;
+            }
+
+            uint8_t last = static_cast<uint8_t>(c);
+            if (pos + 1 < source.size() && source[pos] == '-' && source[pos + 1] != ']')
+            {
+                last = static_cast<uint8_t>(source[pos + 1]);
+                pos += 2;
+                if (last < static_cast<uint8_t>(c))
+                {
+                    return fail("reversed range in `[`");
+                }
+            }
+
+            for (int byte = static_cast<uint8_t>(c); byte <= last; byte++)
+            {
+                set.set(byte);
+            }
+        }
+
+        pos++;
+        if (ignore_case)
+        {
+            fold_case(set);
+        }
+
+        bytes = negated ? ~set : set;
+        return true;
+    }
+
+    bool parse_count(uint32_t& count)
+    {
+        const size_t start = pos;
+        count = 0;
+        for (; !at_end() && std::isdigit(static_cast<unsigned char>(source[pos])) &&
+            count <= MAX_REPEAT_COUNT; pos++)
+        {
+            count = count * 10 + (source[pos] - '0');
+        }
+
+        if (pos == start)
+        {
+            return fail("expected a repeat count");
+        }
+
+        return count <= MAX_REPEAT_COUNT || fail("repeat count too large");
+    }
+
+    bool parse_quantifier(regex_node& node)
+    {
+        uint32_t min_count = 0;
+        uint32_t max_count = UNBOUNDED;
+        const char c = source[pos++];
+        if (c == '+')
+        {
+            min_count = 1;
+        }
+        else if (c == '?')
+        {
+            max_count = 1;
+        }
+        else if (c == '{')
+        {
+            if (!parse_count(min_count))
+            {
+                return false;
+            }
+
+            max_count = min_count;
+            if (!at_end() && source[pos] == ',')
+            {
+                pos++;
+                max_count = UNBOUNDED;
+                if (!at_end() && source[pos] != '}' && !parse_count(max_count))
+                {
+                    return false;
+                }
+            }
+
+            if (at_end() || source[pos++] != '}' || max_count < min_count)
+            {
+                return fail("malformed `{m,n}`");
+            }
+        }
+
+        node = regex_node{regex_node::kind::repeat, {}, {std::move(node)}, min_count, max_count};
+        return true;
+    }
+
+    bool parse_atom(regex_node& node)
+    {
+        const char c = source[pos++];
+        if (c == '(')
+        {
+            if (source.substr(pos, 2) == "?:")
+            {
+                pos += 2;
+            }
+
+            if (!parse_alternation(node))
+            {
+                return false;
+            }
+
+            if (at_end() || source[pos] != ')')
+            {
+                return fail("unterminated `(`");
+            }
+
+            pos++;
+            return true;
+        }
+
+        std::bitset<256> bytes;
+        if (c == '[')
+        {
+            if (!parse_class(bytes))
+            {
+                return false;
+            }
+        }
+        else if (c == '.')
+        {
+            bytes.set();
+            bytes.reset('\n');
+        }
+        else if (c == '\\')
+        {
+            if (!parse_escape(bytes))
+            {
+                return false;
+            }
+        }
+        else if (c == '^' || c == '$')
+        {
+            return fail("anchors are only supported at the start and end of a pattern");
+        }
+        else if (c == '*' || c == '+' || c == '?' || c == '{' || c == ')')
+        {
+            pos--;
+            return fail(std::string{"unexpected `"} + c + "`");
+        }
+        else
+        {
+            bytes.set(static_cast<uint8_t>(c));
+        }
+
+        if (ignore_case)
+        {
+            fold_case(bytes);
+        }
+
+        node = make_bytes_node(bytes);
+        return true;
+    }
+
+    bool parse_concat(regex_node& node)
+    {
+        node = regex_node{regex_node::kind::concat, {}, {}};
+        while (!at_end() && source[pos] != '|' && source[pos] != ')')
+        {
+            regex_node atom;
+            if (!parse_atom(atom))
+            {
+                return false;
+            }
+
+            while (!at_end() && (source[pos] == '*' || source[pos] == '+' || source[pos] == '?' ||
+                source[pos] == '{'))
+            {
+                if (!parse_quantifier(atom))
+                {
+                    return false;
+                }
+            }
+
+            node.children.push_back(std::move(atom));
+        }
+
+        return true;
+    }
+
+    bool parse_alternation(regex_node& node)
+    {
+        node = regex_node{regex_node::kind::alternation, {}, {}};
+        do
+        {
+            regex_node branch;
+            if (!parse_concat(branch))
+            {
+                return false;
+            }
+
+            node.children.push_back(std::move(branch));
+        }
+        while (!at_end() && source[pos] == '|' && ++pos);
+
+        return true;
+    }
+
+public:
+    regex_parser(std::string_view source, bool ignore_case, std::string& error) :
+        source{source},
+        ignore_case{ignore_case},
+        error{error}
+    {}
+
+    std::optional<regex_node> parse()
+    {
+        regex_node root;
+        if (!parse_alternation(root))
+        {
+            return std::nullopt;
+        }
+
+        if (!at_end())
+        {
+            fail("unmatched `)`");
+            return std::nullopt;
+        }
+
+        return root;
+    }
+};
+
+// Returns how many NFA states `node` compiles to, saturating at `MAX_PATTERN_STATES + 1`.
+static uint64_t count_states(const regex_node& node)
+{
+    uint64_t count = 0;
+    switch (node.type)
+    {
+    case regex_node::kind::bytes:
+        return 1;
+    case regex_node::kind::concat:
+    case regex_node::kind::alternation:
+        for (const regex_node& child : node.children)
+        {
+            count += count_states(child) + 1;
+        }
+        break;
+    case regex_node::kind::repeat:
+        count = (count_states(node.children.front()) + 1) *
+            (static_cast<uint64_t>(std::max(node.min_count, node.max_count == UNBOUNDED ? 1u :
+                node.max_count)) + 1);
+        break;
+    }
+
+    return std::min(count, MAX_PATTERN_STATES + 1);
+}
+
+static uint32_t add_state(std::vector<string_pattern_set::nfa_state>& states,
+    string_pattern_set::nfa_state::kind type, uint32_t out, uint32_t out2 = 0)
+{
+    states.push_back(string_pattern_set::nfa_state{type, false, out, out2, 0, {}});
+    return static_cast<uint32_t>(states.size() - 1);
+}
+
+// Compiles `node` into states continuing to `next` once it has matched, and returns the state it
+// starts from. Building back to front means every state's successors already exist.
+static uint32_t compile_node(const regex_node& node, uint32_t next,
+    std::vector<string_pattern_set::nfa_state>& states)
+{
+    using nfa_kind = string_pattern_set::nfa_state::kind;
+    switch (node.type)
+    {
+    case regex_node::kind::bytes:
+    {
+        const uint32_t state = add_state(states, nfa_kind::bytes, next);
+        states[state].bytes = node.bytes;
+        return state;
+    }
+    case regex_node::kind::concat:
+        for (auto child = node.children.rbegin(); child != node.children.rend(); ++child)
+        {
+            next = compile_node(*child, next, states);
+        }
+        return next;
+    case regex_node::kind::alternation:
+    {
+        uint32_t start = compile_node(node.children.back(), next, states);
+        for (auto child = node.children.rbegin() + 1; child != node.children.rend(); ++child)
+        {
+            start = add_state(states, nfa_kind::split, compile_node(*child, next, states), start);
+        }
+        return start;
+    }
+    case regex_node::kind::repeat:
+    {
+        const regex_node& child = node.children.front();
+        uint32_t start = next;
+        if (node.max_count == UNBOUNDED)
+        {
+            // A loop back to a split that either goes round again or leaves.
+            const uint32_t loop = add_state(states, nfa_kind::split, 0, next);
+            states[loop].out = compile_node(child, loop, states);
+            start = loop;
+        }
+        else
+        {
+            // Each optional repetition may skip straight past all the remaining ones.
+            for (uint32_t i = node.min_count; i < node.max_count; i++)
+            {
+                start = add_state(states, nfa_kind::split, compile_node(child, start, states),
+                    next);
+            }
+        }
+
+        for (uint32_t i = 0; i < node.min_count; i++)
+        {
+            start = compile_node(child, start, states);
+        }
+        return start;
+    }
+    }
+
+    return next;
+}
+
+bool string_pattern_set::add_pattern(std::string_view name, bool is_regex,
+    std::string_view source, std::string& error)
+{
+    if (source.empty())
+    {
+        error = "empty pattern.";
+        return false;
+    }
+
+    bool anchored_start = false;
+    bool anchored_end = false;
+    regex_node root{regex_node::kind::concat, {}, {}};
+    if (is_regex)
+    {
+        constexpr std::string_view IGNORE_CASE_FLAG = "(?i)";
+        const bool ignore_case = source.substr(0, IGNORE_CASE_FLAG.size()) == IGNORE_CASE_FLAG;
+        if (ignore_case)
+        {
+            source.remove_prefix(IGNORE_CASE_FLAG.size());
+        }
+
+        anchored_start = !source.empty() && source.front() == '^';
+        if (anchored_start)
+        {
+            source.remove_prefix(1);
+        }
+
+        // A `$` ends the pattern unless it is escaped by an odd number of backslashes.
+        if (!source.empty() && source.back() == '$')
+        {
+            size_t backslashes = 0;
+            while (backslashes + 1 < source.size() &&
+                source[source.size() - 2 - backslashes] == '\\')
+            {
+                backslashes++;
+            }
+
+            anchored_end = backslashes % 2 == 0;
+            if (anchored_end)
+            {
+                source.remove_suffix(1);
+            }
+        }
+
+        auto parsed = regex_parser{source, ignore_case, error}.parse();
+        if (!parsed)
+        {
+            return false;
+        }
+
+        root = std::move(*parsed);
+    }
+    else
+    {
+        for (const char c : source)
+        {
+            std::bitset<256> byte;
+            byte.set(static_cast<uint8_t>(c));
+            root.children.push_back(make_bytes_node(byte));
+        }
+    }
+
+    if (count_states(root) > MAX_PATTERN_STATES)
+    {
+        error = "pattern is too large.";
+        return false;
+    }
+
+    const uint32_t match = add_state(states, nfa_state::kind::match, 0);
+    states[match].at_end = anchored_end;
+    states[match].pattern = static_cast<uint32_t>(names.size());
+    const uint32_t start = compile_node(root, match, states);
+    (anchored_start ? anchored_starts : unanchored_starts).push_back(start);
+    names.emplace_back(name);
+    return true;
+}
+
+bool string_pattern_set::load(std::istream& source, std::string& error)
+{
+    constexpr std::string_view WHITESPACE = " \t\r";
+    std::string line;
+    for (size_t line_number = 1; std::getline(source, line); line_number++)
+    {
+        std::string_view rest{line};
+        const auto skip_whitespace = [&]()
+        {
+            rest.remove_prefix(std::min(rest.find_first_not_of(WHITESPACE), rest.size()));
+        };
+
+        const auto next_word = [&]()
+        {
+            skip_whitespace();
+            const std::string_view word = rest.substr(0, rest.find_first_of(WHITESPACE));
+            rest.remove_prefix(word.size());
+            return word;
+        };
+
+        // `#` only starts a comment at the start of a line, as patterns often contain one.
+        skip_whitespace();
+        if (rest.empty() || rest.front() == '#')
+        {
+            continue;
+        }
+
+        const std::string_view name = next_word();
+        const std::string_view kind = next_word();
+        skip_whitespace();
+        rest = rest.substr(0, rest.find_last_not_of(WHITESPACE) + 1);
+
+        std::string pattern_error;
+        const std::string line_prefix = "line " + std::to_string(line_number) + ": ";
+        if ((kind != "literal" && kind != "regex") || rest.empty())
+        {
+            error = line_prefix + "expected a name, `literal` or `regex` and a pattern.";
+            return false;
+        }
+
+        if (!add_pattern(name, kind == "regex", rest, pattern_error))
+        {
+            error = line_prefix + pattern_error;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+string_matcher::string_matcher(const string_pattern_set& patterns) :
+    patterns{patterns},
+    in_base(patterns.get_states().size(), false),
+    visited(patterns.get_states().size(), false)
+{
+    const auto& nfa = patterns.get_states();
+    for (const uint32_t base_state : get_closure(patterns.get_unanchored_starts()))
+    {
+        in_base[base_state] = true;
+        const auto& info = nfa[base_state];
+        if (info.type == string_pattern_set::nfa_state::kind::match)
+        {
+            (info.at_end ? base_end_matches : base_matches).push_back(info.pattern);
+        }
+        else
+        {
+            for (size_t byte = 0; byte < base_moves.size(); byte++)
+            {
+                if (info.bytes[byte])
+                {
+                    base_moves[byte].push_back(info.out);
+                }
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> string_matcher::get_closure(const std::vector<uint32_t>& seeds)
+{
+    const auto& nfa = patterns.get_states();
+    std::vector<uint32_t> closure;
+    work_stack.assign(seeds.rbegin(), seeds.rend());
+    while (!work_stack.empty())
+    {
+        const uint32_t state = work_stack.back();
+        work_stack.pop_back();
+        // Everything reachable from the base set is in it too.
+        if (visited[state] || in_base[state])
+        {
+            continue;
+        }
+
+        visited[state] = true;
+        touched.push_back(state);
+        if (nfa[state].type == string_pattern_set::nfa_state::kind::split)
+        {
+            work_stack.push_back(nfa[state].out2);
+            work_stack.push_back(nfa[state].out);
+        }
+        else
+        {
+            // Only states that consume a byte or match matter once the splits are followed.
+            closure.push_back(state);
+        }
+    }
+
+    for (const uint32_t state : touched)
+    {
+        visited[state] = false;
+    }
+
+    touched.clear();
+    std::sort(closure.begin(), closure.end());
+    return closure;
+}
+
+uint32_t string_matcher::get_state(std::vector<uint32_t> nfa_states)
+{
+    if (const auto state_it = state_ids.find(nfa_states); state_it != state_ids.end())
+    {
+        return state_it->second;
+    }
+
+    if (states.size() >= MAX_DFA_STATES)
+    {
+        states.clear();
+        state_ids.clear();
+        transitions.clear();
+        start_state = UNKNOWN_STATE;
+        generation++;
+    }
+
+    dfa_state state{std::move(nfa_states), base_matches, base_end_matches};
+    for (const uint32_t nfa_state : state.nfa_states)
+    {
+        const auto& info = patterns.get_states()[nfa_state];
+        if (info.type == string_pattern_set::nfa_state::kind::match)
+        {
+            (info.at_end ? state.end_matches : state.matches).push_back(info.pattern);
+        }
+    }
+
+    const auto id = static_cast<uint32_t>(states.size());
+    state_ids.emplace(state.nfa_states, id);
+    states.push_back(std::move(state));
+    transitions.resize(transitions.size() + 256, UNKNOWN_STATE);
+    return id;
+}
+
+uint32_t string_matcher::get_start_state()
+{
+    if (start_state == UNKNOWN_STATE)
+    {
+        start_state = get_state(get_closure(patterns.get_anchored_starts()));
+    }
+
+    return start_state;
+}
+
+uint32_t string_matcher::step(uint32_t state, uint8_t byte)
+{
+    const size_t transition = static_cast<size_t>(state) * 256 + byte;
+    if (transitions[transition] != UNKNOWN_STATE)
+    {
+        return transitions[transition];
+    }
+
+    std::vector<uint32_t> seeds = base_moves[byte];
+    const auto& nfa = patterns.get_states();
+    for (const uint32_t nfa_state : states[state].nfa_states)
+    {
+        if (nfa[nfa_state].type == string_pattern_set::nfa_state::kind::bytes &&
+            nfa[nfa_state].bytes[byte])
+        {
+            seeds.push_back(nfa[nfa_state].out);
+        }
+    }
+
+    // Only cache the transition if making its target didn't drop the cache `state` is from.
+    const uint64_t state_generation = generation;
+    const uint32_t next = get_state(get_closure(seeds));
+    if (generation == state_generation)
+    {
+        transitions[transition] = next;
+    }
+
+    return next;
+}
+
+void string_matcher::match(std::string_view value, std::vector<uint32_t>& matched)
+{
+    matched.clear();
+    if (patterns.empty())
+    {
+        return;
+    }
+
+    uint32_t state = get_start_state();
+    matched.insert(matched.end(), states[state].matches.begin(), states[state].matches.end());
+    for (const char c : value)
+    {
+        state = step(state, static_cast<uint8_t>(c));
+        const auto& state_matches = states[state].matches;
+        if (!state_matches.empty())
+        {
+            matched.insert(matched.end(), state_matches.begin(), state_matches.end());
+        }
+    }
+
+    const auto& end_matches = states[state].end_matches;
+    matched.insert(matched.end(), end_matches.begin(), end_matches.end());
+    std::sort(matched.begin(), matched.end());
+    matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+}
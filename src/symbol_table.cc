@@ -0,0 +1,308 @@
+/**
+* Copyright 2019 Anthony Calandra
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+* and associated documentation files (the "Software"), to deal in the Software without
+* restriction, including without limitation the rights to use, copy, modify, merge, publish,
+* distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all copies or
+* substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+* BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+* DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#include "symbol_table.hh"
+
+// A slot holds the upper half of the string's hash (the tag) above its id. Tags always have their
+// low bit set, so an empty slot (all zero bits) or a forwarding marker (all one bits) can never be
+// mistaken for a claimed slot.
+static constexpr uint64_t EMPTY_SLOT = 0;
+static constexpr uint64_t FORWARD_SLOT = UINT64_MAX;
+// Stands in for the id while the thread that claimed the slot is still storing the name.
+static constexpr symbol_id PENDING_ID = NO_SYMBOL;
+static constexpr size_t NAME_SEGMENT_MASK = (size_t{1} << symbol_table::NAME_SEGMENT_SIZE_LOG2) - 1;
+static constexpr size_t ARENA_CHUNK_SIZE = 64 * 1024;
+static constexpr size_t LOOKASIDE_CACHE_SIZE = 1024;
+
+struct lookaside_entry
+{
+    uint64_t hash;
+    // Zero means the entry is unused.
+    symbol_id id_plus_one;
+};
+
+// The symbols this thread interned or found recently. Parsing a class interns the same handful of
+// names over and over, so this avoids most probes into the shared tables.
+static thread_local lookaside_entry lookaside_cache[LOOKASIDE_CACHE_SIZE];
+
+// Names are copied into per-thread chunks rather than allocated one by one. The chunks belong to
+// the table, since the views handed out by `get_name` must stay valid after the thread that stored
+// them has exited.
+static thread_local char* arena_cursor = nullptr;
+static thread_local size_t arena_remaining = 0;
+
+// Allocates a chunk, preceded by a link to the previously allocated one so the table can free them.
+static char* allocate_chunk(std::atomic<char*>& chunks, size_t size)
+{
+    char* chunk = new char[sizeof(char*) + size];
+    char* next = chunks.load(std::memory_order_relaxed);
+    do
+    {
+        std::memcpy(chunk, &next, sizeof(next));
+    } while (!chunks.compare_exchange_weak(next, chunk, std::memory_order_release,
+        std::memory_order_relaxed));
+
+    return chunk + sizeof(char*);
+}
+
+static std::string_view store_name(std::atomic<char*>& chunks, std::string_view name)
+{
+    if (name.empty())
+    {
+        return {};
+    }
+
+    char* storage;
+    if (name.size() > ARENA_CHUNK_SIZE / 4)
+    {
+        storage = allocate_chunk(chunks, name.size());
+    }
+    else
+    {
+        if (name.size() > arena_remaining)
+        {
+            arena_cursor = allocate_chunk(chunks, ARENA_CHUNK_SIZE);
+            arena_remaining = ARENA_CHUNK_SIZE;
+        }
+
+        storage = arena_cursor;
+        arena_cursor += name.size();
+        arena_remaining -= name.size();
+    }
+
+    std::memcpy(storage, name.data(), name.size());
+    return {storage, name.size()};
+}
+
+static uint64_t make_slot(uint64_t hash, symbol_id id)
+{
+    uint32_t tag = static_cast<uint32_t>(hash >> 32) | 1;
+    if (tag == UINT32_MAX)
+    {
+        tag -= 2;
+    }
+
+    return (static_cast<uint64_t>(tag) << 32) | id;
+}
+
+static uint64_t get_slot_tag(uint64_t slot)
+{
+    return slot >> 32;
+}
+
+static symbol_id get_slot_id(uint64_t slot)
+{
+    return static_cast<symbol_id>(slot);
+}
+
+symbol_table::level::level(size_t slots_log2) :
+    slots{new std::atomic<uint64_t>[size_t{1} << slots_log2]()},
+    mask{(size_t{1} << slots_log2) - 1}
+{}
+
+symbol_table::~symbol_table()
+{
+    for (std::atomic<level*>& table_level : levels)
+    {
+        delete table_level.load();
+    }
+
+    for (std::atomic<std::string_view*>& segment : name_segments)
+    {
+        delete[] segment.load();
+    }
+
+    for (char* chunk = name_chunks.load(); chunk != nullptr;)
+    {
+        char* next;
+        std::memcpy(&next, chunk, sizeof(next));
+        delete[] chunk;
+        chunk = next;
+    }
+}
+
+symbol_table& symbol_table::instance()
+{
+    static symbol_table table;
+    return table;
+}
+
+symbol_table::level& symbol_table::get_level(size_t level_idx)
+{
+    if (level_idx >= MAX_LEVELS)
+    {
+        throw std::length_error{"Symbol table is full."};
+    }
+
+    level* table_level = levels[level_idx].load(std::memory_order_acquire);
+    if (table_level != nullptr)
+    {
+        return *table_level;
+    }
+
+    auto* new_level = new level{FIRST_LEVEL_SLOTS_LOG2 + level_idx};
+    if (levels[level_idx].compare_exchange_strong(table_level, new_level,
+        std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        return *new_level;
+    }
+
+    // Another thread added the level first.
+    delete new_level;
+    return *table_level;
+}
+
+std::string_view* symbol_table::get_name_segment(symbol_id id)
+{
+    std::atomic<std::string_view*>& segment = name_segments[id >> NAME_SEGMENT_SIZE_LOG2];
+    std::string_view* names = segment.load(std::memory_order_acquire);
+    if (names != nullptr)
+    {
+        return names;
+    }
+
+    auto* new_names = new std::string_view[size_t{1} << NAME_SEGMENT_SIZE_LOG2];
+    if (segment.compare_exchange_strong(names, new_names, std::memory_order_acq_rel,
+        std::memory_order_acquire))
+    {
+        return new_names;
+    }
+
+    delete[] new_names;
+    return names;
+}
+
+symbol_id symbol_table::publish(std::string_view name)
+{
+    const symbol_id id = next_id.fetch_add(1, std::memory_order_acq_rel);
+    if (id >= PENDING_ID)
+    {
+        throw std::length_error{"Symbol table is full."};
+    }
+
+    get_name_segment(id)[id & NAME_SEGMENT_MASK] = store_name(name_chunks, name);
+    return id;
+}
+
+std::optional<symbol_id> symbol_table::lookup(std::string_view name, uint64_t hash, bool insert)
+{
+    const uint64_t pending_slot = make_slot(hash, PENDING_ID);
+    for (size_t level_idx = 0; level_idx < MAX_LEVELS; level_idx++)
+    {
+        if (!insert && levels[level_idx].load(std::memory_order_acquire) == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        level& table_level = get_level(level_idx);
+        const size_t max_used = table_level.mask - table_level.mask / 4;
+        bool forwarded = false;
+        for (size_t slot_idx = hash & table_level.mask; !forwarded;
+            slot_idx = (slot_idx + 1) & table_level.mask)
+        {
+            std::atomic<uint64_t>& slot = table_level.slots[slot_idx];
+            uint64_t slot_value = slot.load(std::memory_order_acquire);
+            while (slot_value == EMPTY_SLOT)
+            {
+                // The first empty slot on the probe sequence is where `name` would have been
+                // added, so it isn't in this level or any later one.
+                if (!insert)
+                {
+                    return std::nullopt;
+                }
+
+                const bool level_full =
+                    table_level.used.load(std::memory_order_relaxed) >= max_used;
+                if (slot.compare_exchange_weak(slot_value,
+                    level_full ? FORWARD_SLOT : pending_slot, std::memory_order_acq_rel,
+                    std::memory_order_acquire))
+                {
+                    if (level_full)
+                    {
+                        slot_value = FORWARD_SLOT;
+                        break;
+                    }
+
+                    table_level.used.fetch_add(1, std::memory_order_relaxed);
+                    const symbol_id id = publish(name);
+                    slot.store(make_slot(hash, id), std::memory_order_release);
+                    return id;
+                }
+            }
+
+            if (slot_value == FORWARD_SLOT)
+            {
+                forwarded = true;
+                continue;
+            }
+
+            if (get_slot_tag(slot_value) != get_slot_tag(pending_slot))
+            {
+                continue;
+            }
+
+            // The tag matches, so this may be `name` being added by another thread. Its name
+            // isn't readable until the id is published.
+            while (get_slot_id(slot_value) == PENDING_ID)
+            {
+                std::this_thread::yield();
+                slot_value = slot.load(std::memory_order_acquire);
+            }
+
+            const symbol_id id = get_slot_id(slot_value);
+            if (get_name(id) == name)
+            {
+                return id;
+            }
+        }
+    }
+
+    throw std::length_error{"Symbol table is full."};
+}
+
+symbol_id symbol_table::intern(std::string_view name)
+{
+    const uint64_t hash = std::hash<std::string_view>{}(name);
+    lookaside_entry& cached = lookaside_cache[hash % LOOKASIDE_CACHE_SIZE];
+    if (cached.id_plus_one != 0 && cached.hash == hash && get_name(cached.id_plus_one - 1) == name)
+    {
+        return cached.id_plus_one - 1;
+    }
+
+    const symbol_id id = lookup(name, hash, true).value();
+    cached = lookaside_entry{hash, id + 1};
+    return id;
+}
+
+std::optional<symbol_id> symbol_table::find(std::string_view name)
+{
+    return lookup(name, std::hash<std::string_view>{}(name), false);
+}
+
+std::string_view symbol_table::get_name(symbol_id id) const
+{
+    const std::string_view* names =
+        name_segments[id >> NAME_SEGMENT_SIZE_LOG2].load(std::memory_order_acquire);
+    return names[id & NAME_SEGMENT_MASK];
+}
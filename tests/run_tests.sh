@@ -0,0 +1,187 @@
+#!/bin/sh
+# Scans the classes in tests/classes and checks what is reported. Run from the repository root,
+# with the scanner to test as the only argument; `make check` builds and runs it.
+
+SCANNER=${1:-./bytecode-scanner}
+CLASSES=tests/classes
+failures=0
+
+# expect_line <line> <scanner arguments...>: the output contains the line.
+expect_line()
+{
+    line=$1
+    shift
+    if ! "$SCANNER" "$@" | grep -qxF "$line"; then
+        echo "FAIL: \`$*\` does not report: $line"
+        failures=$((failures + 1))
+    fi
+}
+
+# expect_no_line <line> <scanner arguments...>: the output doesn't contain the line.
+expect_no_line()
+{
+    line=$1
+    shift
+    if "$SCANNER" "$@" | grep -qxF "$line"; then
+        echo "FAIL: \`$*\` reports: $line"
+        failures=$((failures + 1))
+    fi
+}
+
+# expect_status <status> <scanner arguments...>: the scanner exits with the status.
+expect_status()
+{
+    expected=$1
+    shift
+    "$SCANNER" "$@" > /dev/null 2>&1
+    status=$?
+    if [ "$status" -ne "$expected" ]; then
+        echo "FAIL: \`$*\` exits with $status instead of $expected"
+        failures=$((failures + 1))
+    fi
+}
+
+# expect_output <output> <scanner arguments...>: the output is exactly the given text.
+expect_output()
+{
+    expected=$1
+    shift
+    output=$("$SCANNER" "$@")
+    if [ "$output" != "$expected" ]; then
+        echo "FAIL: \`$*\` reports:"
+        echo "$output"
+        failures=$((failures + 1))
+    fi
+}
+
+# expect_error <line> <scanner arguments...>: the scanner fails, printing only the line to stderr.
+expect_error()
+{
+    line=$1
+    shift
+    errors=$("$SCANNER" "$@" 2>&1 > /dev/null)
+    status=$?
+    if [ "$status" -eq 0 ] || [ "$errors" != "$line" ]; then
+        echo "FAIL: \`$*\` does not fail with only: $line"
+        failures=$((failures + 1))
+    fi
+}
+
+# Test.class calls `Arrays.asList` and `Runtime.getRuntime` through `invokestatic`.
+expect_line "	java/util/Arrays.asList([Ljava/lang/Object;)Ljava/util/List; in method main([Ljava/lang/String;)V on line 3" \
+    -s java.util.Arrays $CLASSES/Test.class
+expect_line "	java/lang/Runtime.getRuntime()Ljava/lang/Runtime; in method main([Ljava/lang/String;)V on line 7" \
+    -s java.lang.Runtime $CLASSES/Test.class
+
+# Recv.class calls `List.add` and `List.clear` through `invokeinterface`.
+expect_line "	java/util/List.add(Ljava/lang/Object;)Z in method m(Ljava/util/List;)V on line 1" \
+    -s java.util.List $CLASSES/Recv.class
+expect_line "	java/util/List.clear()V in method m(Ljava/util/List;)V on line 1" \
+    -s java.util.List $CLASSES/Recv.class
+
+# Loop.class looks up a class named by a local stored to once before a loop, and by one reassigned
+# in the loop, which holds another name from its second iteration on.
+expect_line "	reflection java/lang/Runtime in method storedOnce(Z)V on line 3" \
+    -s java.lang.Runtime $CLASSES/Loop.class
+expect_no_line "	reflection java/lang/Runtime in method reassigned(Z)V on line 2" \
+    -s java.lang.Runtime $CLASSES/Loop.class
+
+# Loop.class also passes a parameter to `Runtime.exec` through a local it reassigns later in the
+# loop, so the argument is only the parameter on the first iteration.
+expect_line "	java/lang/Runtime.exec(Ljava/lang/String;)Ljava/lang/Process; in method run(Ljava/lang/String;Z)V on line 1 (arguments: unknown)" \
+    --arg-origins -s java.lang.Runtime $CLASSES/Loop.class
+
+# Params.class passes a parameter to `Runtime.exec` after a branch that may reassign it, and one
+# after a branch reassigning another parameter.
+expect_line "	java/lang/Runtime.exec(Ljava/lang/String;)Ljava/lang/Process; in method reassigned(Ljava/lang/String;I)V on line 1 (arguments: unknown)" \
+    --arg-origins -s java.lang.Runtime $CLASSES/Params.class
+expect_line "	java/lang/Runtime.exec(Ljava/lang/String;)Ljava/lang/Process; in method passed(Ljava/lang/String;I)V on line 2 (arguments: parameter)" \
+    --arg-origins -s java.lang.Runtime $CLASSES/Params.class
+
+# It also looks up a class named by a parameter it may reassign, which isn't known on every path.
+expect_no_line "	reflection java/lang/Runtime in method lookup(Ljava/lang/String;Z)V on line 3" \
+    -s java.lang.Runtime $CLASSES/Params.class
+
+# `--exists` exits with 3 when there is a use, whichever instruction it's made through, and 0
+# otherwise.
+expect_status 3 --exists -s java.util.Arrays $CLASSES/Test.class
+expect_status 3 --exists -s java.util.List $CLASSES/Recv.class
+expect_status 0 --exists -s java.util.Arrays $CLASSES/Recv.class
+
+# EmptyClassName.class has a Class entry naming the empty string, which matches no rule.
+expect_status 0 -s java.lang.Object $CLASSES/EmptyClassName.class
+expect_status 0 --exists -s java.lang.Object $CLASSES/EmptyClassName.class
+
+# Recv.class also calls `ArrayList` methods through `List` and `Collection`, matching by the class of
+# the receiver in every mode.
+expect_line "	java/util/ArrayList.size()I through java/util/List in method m(Ljava/util/List;)V on line 1" \
+    -s "java.util.ArrayList.size()I" $CLASSES/Recv.class
+expect_status 3 --exists -s "java.util.ArrayList.size()I" $CLASSES/Recv.class
+expect_line "         3  java/util/ArrayList.size()I" --count -s java.util.ArrayList $CLASSES/Recv.class
+
+# Reflective lookups are counted too.
+expect_line "         1  reflection java/lang/Runtime" --count -s java.lang.Runtime $CLASSES/Loop.class
+
+# `--count` adds up the uses of every class given, here each class twice, and the workers of a
+# parallel run add up to the same table.
+COUNTS="Found the following API use counts:
+        10  java/lang/Runtime.exec(Ljava/lang/String;)Ljava/lang/Process;
+        10  java/lang/Runtime.getRuntime()Ljava/lang/Runtime;
+         4  reflection java/lang/Runtime
+         2  java/util/Arrays.asList([Ljava/lang/Object;)Ljava/util/List;
+         2  java/util/List.add(Ljava/lang/Object;)Z
+         2  java/util/List.clear()V
+         2  java/util/List.isEmpty()Z
+         2  java/util/List.size()I
+         2  reflection java/lang/Runtime.exec"
+for jobs in 1 2 4; do
+    expect_output "$COUNTS" --count -j $jobs -s java.lang.Runtime,java.util.List,java.util.Arrays \
+        $CLASSES/*.class $CLASSES/*.class
+done
+
+# A member rule needs its descriptor; without one it would be taken for a class that never matches.
+expect_status 1 -s java.lang.Runtime.exec $CLASSES/Test.class
+expect_status 1 -s "java.io.File.<init>" $CLASSES/Test.class
+expect_status 0 -s java.lang.Runtime,java.net.* $CLASSES/Test.class
+
+# Strings.class loads string constants matched by the patterns of tests/patterns/indicators.txt.
+PATTERNS=tests/patterns
+expect_line "	#1 \"rm -rf /tmp/x http://1.2.3.4/evil\" [url, ip] loaded in method main()V on line 1" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+expect_line "	#3 \"HTTPS://Example.com/x\" [url] loaded in method main()V on line 2" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+
+# `^` and `$` anchor a pattern to the start and end of the string, while literals match anywhere.
+expect_line "	#5 \"/bin/sh -c id\" [shell, starts] loaded in method main()V on line 3" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+expect_line "	#7 \"run /bin/sh\" [shell, ends] loaded in method main()V on line 4" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+
+# `^\d{2,3}$` matches three digits but not four.
+expect_line "	#9 \"123\" [number] loaded in method main()V on line 5" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+expect_no_line "	#11 \"1234\" [number] loaded in method main()V on line 6" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+
+# The last two constants are 40000 random `a` and `b` followed by 15 bytes and an `x`, so the
+# DFA cache is dropped several times while matching them. Only the first has an `a` 15 bytes before
+# the `x`.
+NOISE=babbbbbbabaaabbabbaabbaabbbaaaababbbaabababbbabbabbbbaaabbbabaaaabbbbabbbaaabbaabaaaabbabbaabababaaa
+expect_line "	#13 \"$NOISE\"... [window] loaded in method main()V on line 7" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+expect_no_line "	#15 \"$NOISE\"... [window] loaded in method main()V on line 8" \
+    --strings $PATTERNS/indicators.txt $CLASSES/Strings.class
+
+# A malformed pattern file is reported with the line at fault, without the usage text.
+expect_error "$PATTERNS/bad_repeat.txt: line 3: malformed \`{m,n}\` at offset 6." \
+    --strings $PATTERNS/bad_repeat.txt $CLASSES/Strings.class
+expect_error "$PATTERNS/bad_kind.txt: line 2: expected a name, \`literal\` or \`regex\` and a pattern." \
+    --strings $PATTERNS/bad_kind.txt $CLASSES/Strings.class
+expect_error "$PATTERNS/missing.txt: failed to open string patterns." \
+    --strings $PATTERNS/missing.txt $CLASSES/Strings.class
+
+if [ "$failures" -ne 0 ]; then
+    echo "$failures test(s) failed."
+    exit 1
+fi
+echo "All tests passed."